@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#include <tnt/byterange.h>
+#include <tnt/httpmessage.h>
+#include <cxxtools/log.h>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <cctype>
+#include <strings.h>
+
+log_define("tntnet.byterange")
+
+namespace tnt
+{
+  namespace
+  {
+    void skipSpace(const char*& p)
+    {
+      while (*p == ' ' || *p == '\t')
+        ++p;
+    }
+
+    // Reads a decimal number; too large values saturate.
+    bool parseNumber(const char*& p, off_t& value)
+    {
+      if (!std::isdigit(*p))
+        return false;
+
+      const off_t max = std::numeric_limits<off_t>::max();
+
+      value = 0;
+      for ( ; std::isdigit(*p); ++p)
+      {
+        off_t digit = *p - '0';
+        value = value > (max - digit) / 10 ? max : value * 10 + digit;
+      }
+
+      return true;
+    }
+
+    bool parseSpecs(const char* header, off_t size, ByteRangesType& ranges)
+    {
+      ranges.clear();
+
+      const char* p = header;
+      skipSpace(p);
+      if (strncasecmp(p, "bytes", 5) != 0)
+        return false;
+      p += 5;
+      skipSpace(p);
+      if (*p++ != '=')
+        return false;
+
+      unsigned specs = 0;
+      while (true)
+      {
+        skipSpace(p);
+        if (*p == '\0')
+          break;
+
+        if (*p == ',')
+        {
+          // empty list elements are allowed
+          ++p;
+          continue;
+        }
+
+        if (++specs > maxByteRanges)
+        {
+          log_debug("too many ranges");
+          return false;
+        }
+
+        off_t first;
+        off_t last;
+        if (*p == '-')
+        {
+          // suffix range: the last bytes of the file
+          ++p;
+          off_t suffix;
+          if (!parseNumber(p, suffix))
+            return false;
+
+          if (suffix > 0 && size > 0)
+          {
+            off_t count = std::min(suffix, size);
+            ranges.push_back(ByteRange(size - count, count));
+          }
+        }
+        else if (parseNumber(p, first))
+        {
+          skipSpace(p);
+          if (*p++ != '-')
+            return false;
+          skipSpace(p);
+
+          if (parseNumber(p, last))
+          {
+            if (last < first)
+              return false;
+          }
+          else
+            last = std::numeric_limits<off_t>::max();
+
+          if (first < size)
+            ranges.push_back(ByteRange(first, std::min(last, size - 1) - first + 1));
+        }
+        else
+          return false;
+
+        skipSpace(p);
+        if (*p == ',')
+          ++p;
+        else if (*p != '\0')
+          return false;
+      }
+
+      if (specs == 0)
+        return false;
+
+      // overlapping ranges are coalesced
+      ByteRangesType sorted(ranges);
+      std::sort(sorted.begin(), sorted.end());
+      bool overlaps = false;
+      for (unsigned n = 1; n < sorted.size(); ++n)
+        if (sorted[n].offset <= sorted[n - 1].offset + sorted[n - 1].count)
+          overlaps = true;
+
+      if (overlaps)
+      {
+        ranges.clear();
+        for (ByteRangesType::const_iterator it = sorted.begin(); it != sorted.end(); ++it)
+        {
+          if (!ranges.empty() && it->offset <= ranges.back().offset + ranges.back().count)
+            ranges.back().count = std::max(ranges.back().offset + ranges.back().count, it->offset + it->count)
+                                - ranges.back().offset;
+          else
+            ranges.push_back(*it);
+        }
+      }
+
+      return true;
+    }
+  }
+
+  bool parseByteRanges(const char* header, off_t size, ByteRangesType& ranges)
+  {
+    if (parseSpecs(header, size, ranges))
+      return true;
+
+    // a partially parsed header must not be used
+    ranges.clear();
+    return false;
+  }
+
+  bool ifRangeMatches(const char* ifRange, const std::string& etag, time_t mtime)
+  {
+    while (*ifRange == ' ')
+      ++ifRange;
+
+    // entity tags are compared strongly, so a weak tag never matches
+    if (*ifRange == '"')
+      return etag == ifRange;
+    if (ifRange[0] == 'W' && ifRange[1] == '/')
+      return false;
+
+    time_t t;
+    return HttpMessage::parseHtdate(ifRange, t) && t == mtime;
+  }
+
+  std::string contentRange(const ByteRange& range, off_t size)
+  {
+    std::ostringstream s;
+    s << "bytes " << range.offset << '-' << (range.offset + range.count - 1) << '/' << size;
+    return s.str();
+  }
+}
@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#include <tnt/cache.h>
+#include <cxxtools/mutex.h>
+#include <cxxtools/log.h>
+#include <list>
+#include <map>
+#include <time.h>
+
+log_define("tntnet.cache")
+
+namespace tnt
+{
+  namespace
+  {
+    long long currentMillis()
+    {
+      struct timespec ts;
+      ::clock_gettime(CLOCK_MONOTONIC, &ts);
+      return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+    }
+
+    // FNV-1a
+    unsigned long hashKey(const std::string& key)
+    {
+      unsigned long h = 2166136261ul;
+      for (std::string::const_iterator it = key.begin(); it != key.end(); ++it)
+      {
+        h ^= static_cast<unsigned char>(*it);
+        h *= 16777619ul;
+      }
+      return h;
+    }
+  }
+
+  class CacheBase::Shard
+  {
+      struct Node
+      {
+        std::string key;
+        ValuePtr value;
+        std::size_t size;
+        long long expires;   // 0 = never
+      };
+
+      // most recently used first
+      typedef std::list<Node> LruType;
+      typedef std::map<std::string, LruType::iterator> IndexType;
+
+      void remove(IndexType::iterator it);
+
+    public:
+      explicit Shard(std::size_t maxBytes_)
+        : maxBytes(maxBytes_)
+        { }
+
+      cxxtools::Mutex mutex;
+      LruType lru;
+      IndexType index;
+      std::size_t maxBytes;
+      CacheStatistics statistics;
+
+      ValuePtr get(const std::string& key);
+      void put(const std::string& key, ValuePtr value, std::size_t size, long long expires);
+      bool erase(const std::string& key);
+      unsigned erasePrefix(const std::string& prefix);
+      void clear();
+  };
+
+  void CacheBase::Shard::remove(IndexType::iterator it)
+  {
+    statistics.bytes -= it->second->size;
+    --statistics.entries;
+    lru.erase(it->second);
+    index.erase(it);
+  }
+
+  CacheBase::ValuePtr CacheBase::Shard::get(const std::string& key)
+  {
+    cxxtools::MutexLock lock(mutex);
+
+    IndexType::iterator it = index.find(key);
+    if (it == index.end())
+    {
+      ++statistics.misses;
+      return ValuePtr();
+    }
+
+    if (it->second->expires != 0 && it->second->expires <= currentMillis())
+    {
+      ++statistics.expirations;
+      ++statistics.misses;
+      remove(it);
+      return ValuePtr();
+    }
+
+    ++statistics.hits;
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->value;
+  }
+
+  void CacheBase::Shard::put(const std::string& key, ValuePtr value, std::size_t size, long long expires)
+  {
+    cxxtools::MutexLock lock(mutex);
+
+    IndexType::iterator it = index.find(key);
+    if (it != index.end())
+      remove(it);
+
+    if (size > maxBytes)
+    {
+      log_debug("value of " << size << " bytes for key \"" << key << "\" exceeds cache size");
+      return;
+    }
+
+    // drop expired entries from the tail, then least recently used ones
+    long long now = currentMillis();
+    while (!lru.empty() && statistics.bytes + size > maxBytes)
+    {
+      const Node& last = lru.back();
+      if (last.expires != 0 && last.expires <= now)
+        ++statistics.expirations;
+      else
+        ++statistics.evictions;
+      remove(index.find(last.key));
+    }
+
+    Node node;
+    node.key = key;
+    node.value = value;
+    node.size = size;
+    node.expires = expires;
+    lru.push_front(node);
+    index[key] = lru.begin();
+
+    statistics.bytes += size;
+    ++statistics.entries;
+    ++statistics.insertions;
+  }
+
+  bool CacheBase::Shard::erase(const std::string& key)
+  {
+    cxxtools::MutexLock lock(mutex);
+
+    IndexType::iterator it = index.find(key);
+    if (it == index.end())
+      return false;
+
+    remove(it);
+    return true;
+  }
+
+  unsigned CacheBase::Shard::erasePrefix(const std::string& prefix)
+  {
+    cxxtools::MutexLock lock(mutex);
+
+    unsigned count = 0;
+    IndexType::iterator it = index.lower_bound(prefix);
+    while (it != index.end() && it->first.compare(0, prefix.size(), prefix) == 0)
+    {
+      remove(it++);
+      ++count;
+    }
+
+    return count;
+  }
+
+  void CacheBase::Shard::clear()
+  {
+    cxxtools::MutexLock lock(mutex);
+    index.clear();
+    lru.clear();
+    statistics.entries = 0;
+    statistics.bytes = 0;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // CacheBase
+  //
+  CacheBase::CacheBase(std::size_t maxBytes, unsigned shards)
+    : _maxBytes(maxBytes)
+  {
+    if (shards == 0)
+      shards = 1;
+
+    _shards.reserve(shards);
+    for (unsigned n = 0; n < shards; ++n)
+      _shards.push_back(new Shard(maxBytes / shards));
+  }
+
+  CacheBase::~CacheBase()
+  {
+    for (unsigned n = 0; n < _shards.size(); ++n)
+      delete _shards[n];
+  }
+
+  CacheBase::Shard& CacheBase::shard(const std::string& key) const
+  {
+    return *_shards[hashKey(key) % _shards.size()];
+  }
+
+  CacheBase::ValuePtr CacheBase::getValue(const std::string& key)
+  {
+    return shard(key).get(key);
+  }
+
+  void CacheBase::putValue(const std::string& key, ValuePtr value, std::size_t size, cxxtools::Milliseconds ttl)
+  {
+    long long expires = ttl.totalMSecs() > 0
+                      ? currentMillis() + static_cast<long long>(ttl.totalMSecs())
+                      : 0;
+    shard(key).put(key, value, size, expires);
+  }
+
+  bool CacheBase::erase(const std::string& key)
+  {
+    return shard(key).erase(key);
+  }
+
+  unsigned CacheBase::erasePrefix(const std::string& prefix)
+  {
+    unsigned count = 0;
+    for (unsigned n = 0; n < _shards.size(); ++n)
+      count += _shards[n]->erasePrefix(prefix);
+    return count;
+  }
+
+  void CacheBase::clear()
+  {
+    for (unsigned n = 0; n < _shards.size(); ++n)
+      _shards[n]->clear();
+  }
+
+  CacheStatistics CacheBase::getStatistics() const
+  {
+    CacheStatistics result;
+    for (unsigned n = 0; n < _shards.size(); ++n)
+    {
+      Shard& s = *_shards[n];
+      cxxtools::MutexLock lock(s.mutex);
+      result.hits += s.statistics.hits;
+      result.misses += s.statistics.misses;
+      result.insertions += s.statistics.insertions;
+      result.evictions += s.statistics.evictions;
+      result.expirations += s.statistics.expirations;
+      result.entries += s.statistics.entries;
+      result.bytes += s.statistics.bytes;
+    }
+    return result;
+  }
+}
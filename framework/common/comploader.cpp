@@ -39,6 +39,20 @@
 namespace
 {
   cxxtools::ReadWriteMutex mutex;
+
+  // components not found are looked up again after that many seconds,
+  // so that a library installed later is found
+  const time_t notFoundTtl = 10;
+
+  // expired entries are removed from the list of components not found,
+  // when it reaches that many entries; it is cleared, if they are all valid
+  const unsigned maxNotFound = 1000;
+
+  // strip the flag for loading a library locally
+  std::string plainLibname(const std::string& libname)
+  {
+    return !libname.empty() && libname[0] == '!' ? libname.substr(1) : libname;
+  }
 }
 
 namespace tnt
@@ -108,7 +122,10 @@ namespace tnt
     // look for factory in my map
     factoryMapType::const_iterator i = _factoryMap.find(component_name);
     if (i == _factoryMap.end())
-      throw NotFoundException(component_name);
+    {
+      log_debug("component \"" << component_name << "\" not found in library \"" << _libname << '"');
+      return 0;
+    }
 
     factory = i->second;
 
@@ -154,31 +171,105 @@ namespace tnt
 
   ComponentLibrary::factoryMapType* Comploader::currentFactoryMap = 0;
 
-  Component& Comploader::fetchComp(const Compident& ci, const Urlmapper& rootmapper)
+  Component* Comploader::lookupComp(const Compident& ci, const Urlmapper& rootmapper, bool& libraryMissing)
   {
-    log_debug("fetchComp \"" << ci << '"');
+    log_debug("lookupComp \"" << ci << '"');
 
     cxxtools::ReadLock rlock(mutex);
     cxxtools::WriteLock wlock(mutex, false);
 
     // lookup Component
     componentmap_type::iterator it = componentmap.find(ci);
-    if (it == componentmap.end())
+    if (it != componentmap.end())
+      return it->second;
+
+    // lookup list of components, we already failed to load
+    time_t now = ::time(0);
+    notfoundmap_type::iterator nf = notfoundmap.find(ci);
+    if (nf != notfoundmap.end() && nf->second.expires > now)
+    {
+      log_debug("component \"" << ci << "\" not found (cached)");
+      libraryMissing = nf->second.libraryMissing;
+      return 0;
+    }
+
+    rlock.unlock();
+    wlock.lock();
+
+    it = componentmap.find(ci);
+    if (it != componentmap.end())
+      return it->second;
+
+    nf = notfoundmap.find(ci);
+    bool known = nf != notfoundmap.end();
+    if (known && nf->second.expires > now)
+    {
+      libraryMissing = nf->second.libraryMissing;
+      return 0;
+    }
+
+    Component* comp = 0;
+    ComponentLibrary* lib = findLib(ci.libname);
+    if (lib)
+      comp = lib->create(ci.compname, *this, rootmapper);
+
+    if (comp)
+    {
+      if (known)
+        notfoundmap.erase(nf);
+      componentmap[ci] = comp;
+      return comp;
+    }
+
+    if (!known && notfoundmap.size() >= maxNotFound)
     {
-      rlock.unlock();
-      wlock.lock();
-      it = componentmap.find(ci);
-      if (it == componentmap.end())
+      for (notfoundmap_type::iterator n = notfoundmap.begin(); n != notfoundmap.end(); )
       {
-        ComponentLibrary& lib = fetchLib(ci.libname);
-        Component* comp = lib.create(ci.compname, *this, rootmapper);
+        if (n->second.expires <= now)
+          notfoundmap.erase(n++);
+        else
+          ++n;
+      }
 
-        componentmap[ci] = comp;
-        return *comp;
+      if (notfoundmap.size() >= maxNotFound)
+      {
+        log_debug("clear list of components not found");
+        notfoundmap.clear();
       }
     }
 
-    return *(it->second);
+    // Later lookups are answered from the map. A library, which is still
+    // missing after the entry expired, is not reported again.
+    libraryMissing = (lib == 0);
+    if (libraryMissing && !known)
+      log_warn("library " << plainLibname(ci.libname) << " not found");
+
+    NotFound& entry = notfoundmap[ci];
+    entry.libraryMissing = libraryMissing;
+    entry.expires = now + notFoundTtl;
+    return 0;
+  }
+
+  Component* Comploader::findComp(const Compident& ci, const Urlmapper& rootmapper)
+  {
+    bool libraryMissing = false;
+    return lookupComp(ci, rootmapper, libraryMissing);
+  }
+
+  Component& Comploader::fetchComp(const Compident& ci, const Urlmapper& rootmapper)
+  {
+    log_debug("fetchComp \"" << ci << '"');
+
+    bool libraryMissing = false;
+    Component* comp = lookupComp(ci, rootmapper, libraryMissing);
+    if (comp == 0)
+    {
+      if (libraryMissing)
+        throw LibraryNotFound(plainLibname(ci.libname));
+      throw NotFoundException(ci.compname);
+    }
+
+    return *comp;
   }
 
   Component* Comploader::createComp(const Compident& ci, const Urlmapper& rootmapper)
@@ -187,6 +278,8 @@ namespace tnt
 
     ComponentLibrary& lib = fetchLib(ci.libname);
     Component* comp = lib.create(ci.compname, *this, rootmapper);
+    if (comp == 0)
+      throw NotFoundException(ci.compname);
     return comp;
   }
 
@@ -224,6 +317,17 @@ namespace tnt
   {
     log_debug("fetchLib \"" << libname << '"');
 
+    ComponentLibrary* lib = findLib(libname);
+    if (lib == 0)
+      throw LibraryNotFound(plainLibname(libname));
+
+    return *lib;
+  }
+
+  ComponentLibrary* Comploader::findLib(const std::string& libname)
+  {
+    log_debug("findLib \"" << libname << '"');
+
     std::string n = libname;
     bool local = false;
     if (!n.empty() && n[0] == '!')
@@ -272,7 +376,7 @@ namespace tnt
       }
 
       if (!lib)
-        throw LibraryNotFound(n);
+        return 0;
 
       lib._factoryMap = factoryMap;
       log_debug("insert new library " << n);
@@ -281,7 +385,7 @@ namespace tnt
     else
       log_debug("library " << n << " found");
 
-    return it->second;
+    return &it->second;
   }
 
   void Comploader::registerFactory(const std::string& component_name, ComponentFactory* factory)
@@ -47,9 +47,15 @@ namespace tnt
   unsigned Component::endTag(HttpRequest&, HttpReply&, tnt::QueryParams&)
     { return DECLINED; }
 
+  unsigned Component::expectContinue(HttpRequest&, HttpReply&)
+    { return HTTP_CONTINUE; }
+
   std::string Component::getAttribute(const std::string& /* name */, const std::string& def) const
     { return def; }
 
+  bool Component::lazyQueryParams() const
+    { return false; }
+
   unsigned Component::call(HttpRequest& request, HttpReply& reply)
   {
     tnt::QueryParams qparam;
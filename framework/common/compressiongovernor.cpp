@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <tnt/compressiongovernor.h>
+#include <tnt/tntconfig.h>
+#include <cxxtools/atomicity.h>
+#include <cxxtools/log.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+log_define("tntnet.compressiongovernor")
+
+namespace tnt
+{
+  namespace
+  {
+    cxxtools::atomic_t decisionCounters[CompressionGovernor::decisionCount];
+    cxxtools::atomic_t cpuLoad = 0;
+    cxxtools::atomic_t queueDepth = 0;
+
+    // the fastest level is 1 for all supported codecs
+    const int fastestLevel = 1;
+
+    // Returns the smoothed round trip time of the connection in
+    // microseconds or 0, if it is not known.
+    unsigned roundTripTime(int socketFd)
+    {
+#ifdef TCP_INFO
+      if (socketFd >= 0)
+      {
+        struct tcp_info info;
+        socklen_t len = sizeof(info);
+        if (::getsockopt(socketFd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0)
+          return info.tcpi_rtt;
+      }
+#endif
+      return 0;
+    }
+
+    CompressionGovernor::Decision count(CompressionGovernor::Decision decision)
+    {
+      cxxtools::atomicIncrement(decisionCounters[decision]);
+      return decision;
+    }
+  }
+
+  const char* CompressionGovernor::decisionName(Decision decision)
+  {
+    switch (decision)
+    {
+      case decisionDefault:         return "default";
+      case decisionReduced:         return "reduced";
+      case decisionSkipCpu:         return "skip-cpu";
+      case decisionSkipLink:        return "skip-link";
+      case decisionSkipContentType: return "skip-contenttype";
+      default:                      return "unknown";
+    }
+  }
+
+  CompressionGovernor::Statistics CompressionGovernor::getStatistics()
+  {
+    Statistics statistics;
+    for (unsigned n = 0; n < decisionCount; ++n)
+      statistics.decisions[n] = cxxtools::atomicGet(decisionCounters[n]);
+    statistics.cpuLoad = cxxtools::atomicGet(cpuLoad);
+    statistics.queueDepth = cxxtools::atomicGet(queueDepth);
+    return statistics;
+  }
+
+  void CompressionGovernor::sample(unsigned queueDepth_)
+  {
+    static long ncpus = 0;
+    static long long lastCpu = -1;
+    static long long lastWall = 0;
+
+    if (ncpus == 0)
+    {
+      ncpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+      if (ncpus <= 0)
+        ncpus = 1;
+    }
+
+    struct rusage usage;
+    struct timespec now;
+    if (::getrusage(RUSAGE_SELF, &usage) != 0
+      || ::clock_gettime(CLOCK_MONOTONIC, &now) != 0)
+      return;
+
+    long long cpu = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000LL
+                  + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+    long long wall = now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+
+    if (lastCpu >= 0 && wall > lastWall)
+    {
+      long long load = (cpu - lastCpu) * 1000 / ((wall - lastWall) * ncpus);
+      cxxtools::atomicSet(cpuLoad, static_cast<cxxtools::atomic_t>(load > 1000 ? 1000 : load));
+    }
+
+    lastCpu = cpu;
+    lastWall = wall;
+
+    cxxtools::atomicSet(queueDepth, static_cast<cxxtools::atomic_t>(queueDepth_));
+  }
+
+  // Compressing these content types again costs cpu time and saves nothing.
+  bool CompressionGovernor::isCompressedContentType(const char* contentType)
+  {
+    static const char* prefixes[] = {
+      "image/",
+      "audio/",
+      "video/",
+      "font/woff",
+      "application/zip",
+      "application/gzip",
+      "application/x-gzip",
+      "application/zstd",
+      "application/x-bzip2",
+      "application/x-xz",
+      "application/x-7z-compressed",
+      "application/x-rar-compressed",
+      0
+    };
+
+    // svg is text
+    if (strncasecmp(contentType, "image/svg", 9) == 0)
+      return false;
+
+    for (const char** p = prefixes; *p; ++p)
+      if (strncasecmp(contentType, *p, strlen(*p)) == 0)
+        return true;
+
+    return false;
+  }
+
+  CompressionGovernor::Decision CompressionGovernor::decide(const char* contentType, int socketFd, int& level)
+  {
+    const TntConfig& config = TntConfig::it();
+
+    if (isCompressedContentType(contentType))
+      return count(decisionSkipContentType);
+
+    unsigned load = cxxtools::atomicGet(cpuLoad);
+    if (load >= config.compressionCpuLimit * 10)
+    {
+      log_debug("cpu load " << load << "; skip compression");
+      return count(decisionSkipCpu);
+    }
+
+    // the round trip time is measured to the last hop, which is a proxy
+    // in front of tntnet, so the check is enabled explicitly
+    unsigned rtt = config.compressionLanRtt > 0 ? roundTripTime(socketFd) : 0;
+    if (rtt > 0 && rtt < config.compressionLanRtt)
+    {
+      log_debug("round trip time " << rtt << "us; skip compression");
+      return count(decisionSkipLink);
+    }
+
+    if (load >= config.compressionCpuLimit * 5 || cxxtools::atomicGet(queueDepth) > 0)
+    {
+      log_debug("cpu load " << load << ", queue depth " << cxxtools::atomicGet(queueDepth) << "; use fastest compression level");
+      level = fastestLevel;
+      return count(decisionReduced);
+    }
+
+    return count(decisionDefault);
+  }
+}
@@ -0,0 +1,476 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <tnt/compressor.h>
+#include <tnt/util.h>
+#include <cxxtools/log.h>
+#include "config.h"
+
+#ifdef WITH_BROTLI
+#include <brotli/encode.h>
+#endif
+
+#ifdef WITH_ZSTD
+#include <zstd.h>
+#endif
+
+log_define("tntnet.compressor")
+
+namespace tnt
+{
+  namespace
+  {
+    // brotli quality and zstd level used, when no level is configured;
+    // both are tuned for dynamic content rather than maximal compression
+    const int defaultBrotliLevel = 5;
+    const int defaultZstdLevel = 3;
+  }
+
+#ifdef WITH_BROTLI
+
+  struct Compressor::BrotliState
+  {
+    BrotliEncoderState* state;
+
+    BrotliState()
+      : state(0)
+      { }
+
+    ~BrotliState()
+    {
+      if (state)
+        BrotliEncoderDestroyInstance(state);
+    }
+
+    void init(int level)
+    {
+      if (state)
+        BrotliEncoderDestroyInstance(state);
+
+      state = BrotliEncoderCreateInstance(0, 0, 0);
+      if (state == 0)
+        throwRuntimeError("failed to create brotli encoder");
+
+      BrotliEncoderSetParameter(state, BROTLI_PARAM_QUALITY,
+        static_cast<uint32_t>(level < 0 ? defaultBrotliLevel : level));
+    }
+
+    void process(BrotliEncoderOperation op, const char* d, unsigned s, std::ostream& out)
+    {
+      size_t availIn = s;
+      const uint8_t* nextIn = reinterpret_cast<const uint8_t*>(d);
+
+      while (true)
+      {
+        uint8_t zbuffer[8192];
+        size_t availOut = sizeof(zbuffer);
+        uint8_t* nextOut = zbuffer;
+
+        if (!BrotliEncoderCompressStream(state, op, &availIn, &nextIn, &availOut, &nextOut, 0))
+          throwRuntimeError("brotli compression failed");
+
+        out.write(reinterpret_cast<const char*>(zbuffer), sizeof(zbuffer) - availOut);
+
+        if (op == BROTLI_OPERATION_FINISH)
+        {
+          if (BrotliEncoderIsFinished(state))
+            break;
+        }
+        else if (availIn == 0 && !BrotliEncoderHasMoreOutput(state))
+          break;
+      }
+    }
+  };
+
+#else
+
+  struct Compressor::BrotliState
+  { };
+
+#endif
+
+#ifdef WITH_ZSTD
+
+  struct Compressor::ZstdState
+  {
+    ZSTD_CCtx* ctx;
+
+    ZstdState()
+      : ctx(ZSTD_createCCtx())
+    {
+      if (ctx == 0)
+        throwRuntimeError("failed to create zstd context");
+    }
+
+    ~ZstdState()
+    { ZSTD_freeCCtx(ctx); }
+
+    void init(int level)
+    {
+      ZSTD_CCtx_reset(ctx, ZSTD_reset_session_only);
+      ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, level < 0 ? defaultZstdLevel : level);
+    }
+
+    void process(ZSTD_EndDirective op, const char* d, unsigned s, std::ostream& out)
+    {
+      ZSTD_inBuffer in = { d, s, 0 };
+
+      while (true)
+      {
+        char zbuffer[8192];
+        ZSTD_outBuffer zout = { zbuffer, sizeof(zbuffer), 0 };
+
+        size_t ret = ZSTD_compressStream2(ctx, &zout, &in, op);
+        if (ZSTD_isError(ret))
+          throwRuntimeError(std::string("zstd compression failed: ") + ZSTD_getErrorName(ret));
+
+        out.write(zbuffer, zout.pos);
+
+        // with ZSTD_e_continue all input is consumed when the call returns,
+        // otherwise ret is the number of bytes still to be flushed
+        if (op == ZSTD_e_continue ? in.pos == in.size : ret == 0)
+          break;
+      }
+    }
+  };
+
+#else
+
+  struct Compressor::ZstdState
+  { };
+
+#endif
+
+  bool Compressor::isSupported(Codec codec)
+  {
+    switch (codec)
+    {
+      case codecGzip:
+        return true;
+
+#ifdef WITH_BROTLI
+      case codecBrotli:
+        return true;
+#endif
+
+#ifdef WITH_ZSTD
+      case codecZstd:
+        return true;
+#endif
+
+      default:
+        return false;
+    }
+  }
+
+  Compressor::Codec Compressor::parseCodec(const std::string& encoding)
+  {
+    if (encoding == "gzip")
+      return codecGzip;
+    else if (encoding == "br")
+      return codecBrotli;
+    else if (encoding == "zstd")
+      return codecZstd;
+    else
+      return codecNone;
+  }
+
+  const char* Compressor::encodingName(Codec codec)
+  {
+    switch (codec)
+    {
+      case codecGzip:   return "gzip";
+      case codecBrotli: return "br";
+      case codecZstd:   return "zstd";
+      default:          return "identity";
+    }
+  }
+
+  Compressor::Compressor()
+    : _deflator(_zbody),
+      _brotli(0),
+      _zstd(0),
+      _codec(codecNone),
+      _crc(0),
+      _size(0)
+  {
+  }
+
+  Compressor::~Compressor()
+  {
+    delete _brotli;
+    delete _zstd;
+  }
+
+  void Compressor::init(Codec codec, int level)
+  {
+    log_debug("init " << encodingName(codec) << " level " << level);
+
+    _codec = codec;
+
+    switch (codec)
+    {
+      case codecGzip:
+      {
+        _deflator.setLevel(level < 0 ? Z_DEFAULT_COMPRESSION : level);
+
+        static const char f[] =
+             "\x1f\x8b\x08\x00"
+             "\x00\x00\x00\x00"
+             "\x04\x03";
+        _zbody.write(f, sizeof(f) - 1);
+        break;
+      }
+
+#ifdef WITH_BROTLI
+      case codecBrotli:
+        if (_brotli == 0)
+          _brotli = new BrotliState();
+        _brotli->init(level);
+        break;
+#endif
+
+#ifdef WITH_ZSTD
+      case codecZstd:
+        if (_zstd == 0)
+          _zstd = new ZstdState();
+        _zstd->init(level);
+        break;
+#endif
+
+      default:
+        throwRuntimeError(std::string("unsupported content coding \"") + encodingName(codec) + '"');
+    }
+  }
+
+  void Compressor::compress(const char* d, unsigned s)
+  {
+    _size += s;
+
+    switch (_codec)
+    {
+      case codecGzip:
+        _deflator.write(d, s);
+        _crc = crc32(_crc, reinterpret_cast<const Bytef*>(d), s);
+        break;
+
+#ifdef WITH_BROTLI
+      case codecBrotli:
+        _brotli->process(BROTLI_OPERATION_PROCESS, d, s, _zbody);
+        break;
+#endif
+
+#ifdef WITH_ZSTD
+      case codecZstd:
+        _zstd->process(ZSTD_e_continue, d, s, _zbody);
+        break;
+#endif
+
+      default:
+        break;
+    }
+  }
+
+  void Compressor::flush()
+  {
+    switch (_codec)
+    {
+      case codecGzip:
+        _deflator.flush();
+        break;
+
+#ifdef WITH_BROTLI
+      case codecBrotli:
+        _brotli->process(BROTLI_OPERATION_FLUSH, 0, 0, _zbody);
+        break;
+#endif
+
+#ifdef WITH_ZSTD
+      case codecZstd:
+        _zstd->process(ZSTD_e_flush, 0, 0, _zbody);
+        break;
+#endif
+
+      default:
+        break;
+    }
+  }
+
+  void Compressor::finalize()
+  {
+    switch (_codec)
+    {
+      case codecGzip:
+      {
+        _deflator.end();
+
+        uint32_t u = _crc;
+        _zbody.put(static_cast<char>(u & 0xFF));
+        _zbody.put(static_cast<char>((u >>= 8) & 0xFF));
+        _zbody.put(static_cast<char>((u >>= 8) & 0xFF));
+        _zbody.put(static_cast<char>((u >>= 8) & 0xFF));
+
+        u = _size;
+        _zbody.put(static_cast<char>(u & 0xFF));
+        _zbody.put(static_cast<char>((u >>= 8) & 0xFF));
+        _zbody.put(static_cast<char>((u >>= 8) & 0xFF));
+        _zbody.put(static_cast<char>((u >>= 8) & 0xFF));
+        break;
+      }
+
+#ifdef WITH_BROTLI
+      case codecBrotli:
+        _brotli->process(BROTLI_OPERATION_FINISH, 0, 0, _zbody);
+        break;
+#endif
+
+#ifdef WITH_ZSTD
+      case codecZstd:
+        _zstd->process(ZSTD_e_end, 0, 0, _zbody);
+        break;
+#endif
+
+      default:
+        break;
+    }
+  }
+
+  void Compressor::clear()
+  {
+    _zbody.makeEmpty();
+    if (_codec == codecGzip)
+      _deflator.reinitialize();
+    _codec = codecNone;
+    _crc = 0;
+    _size = 0;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // CompressStreamBuf
+  //
+  void CompressStreamBuf::begin(std::streambuf* sink, Compressor::Codec codec, int level)
+  {
+    _compressor.clear();
+    _compressor.init(codec, level);
+    _sink = sink;
+
+    if (_buffer.empty())
+      _buffer.resize(8192);
+    setp(&_buffer[0], &_buffer[0] + _buffer.size());
+  }
+
+  bool CompressStreamBuf::compressBuffer()
+  {
+    if (pptr() > pbase())
+    {
+      _compressor.compress(pbase(), pptr() - pbase());
+      setp(&_buffer[0], &_buffer[0] + _buffer.size());
+    }
+
+    return passOutput();
+  }
+
+  bool CompressStreamBuf::passOutput()
+  {
+    const ocstream& zbody = _compressor.zbody();
+    for (ocstream::size_type n = 0; n < zbody.chunkcount(); ++n)
+    {
+      std::streamsize size = zbody.chunksize(n);
+      if (_sink->sputn(zbody.chunk(n), size) < size)
+        return false;
+    }
+
+    _compressor.discardOutput();
+    return true;
+  }
+
+  CompressStreamBuf::int_type CompressStreamBuf::overflow(int_type ch)
+  {
+    if (_sink == 0 || !compressBuffer())
+      return traits_type::eof();
+
+    if (ch != traits_type::eof())
+      sputc(traits_type::to_char_type(ch));
+
+    return 0;
+  }
+
+  CompressStreamBuf::int_type CompressStreamBuf::underflow()
+  {
+    return traits_type::eof();
+  }
+
+  int CompressStreamBuf::sync()
+  {
+    if (_sink == 0)
+      return 0;
+
+    if (pptr() > pbase())
+    {
+      _compressor.compress(pbase(), pptr() - pbase());
+      setp(&_buffer[0], &_buffer[0] + _buffer.size());
+    }
+
+    _compressor.flush();
+
+    log_debug("flush " << _compressor.zsize() << " compressed bytes");
+    if (!passOutput())
+      return -1;
+
+    return _sink->pubsync();
+  }
+
+  bool CompressStreamBuf::finish()
+  {
+    if (_sink == 0)
+      return true;
+
+    if (pptr() > pbase())
+      _compressor.compress(pbase(), pptr() - pbase());
+
+    _compressor.finalize();
+
+    log_debug(Compressor::encodingName(_compressor.codec()) << " stream " << _compressor.uncompressedSize() << " bytes");
+
+    bool ret = passOutput();
+    clear();
+    return ret;
+  }
+
+  void CompressStreamBuf::clear()
+  {
+    if (_sink)
+    {
+      _compressor.clear();
+      _sink = 0;
+    }
+
+    setp(0, 0);
+  }
+}
@@ -26,6 +26,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 #include <tnt/cstream.h>
+#include <tnt/threadlocal.h>
+#include <tnt/tntconfig.h>
 #include <cxxtools/log.h>
 
 log_define("tntnet.cstream")
@@ -33,11 +35,69 @@ log_define("tntnet.cstream")
 namespace tnt
 {
 
+namespace
+{
+  // Chunks of the default size are recycled per thread, so that the
+  // allocation does not need to lock the heap.
+  class ChunkCache
+  {
+      std::vector<char*> _chunks;
+
+    public:
+      ~ChunkCache()
+      {
+        for (unsigned n = 0; n < _chunks.size(); ++n)
+          delete[] _chunks[n];
+      }
+
+      char* get()
+      {
+        if (_chunks.empty())
+          return 0;
+        char* chunk = _chunks.back();
+        _chunks.pop_back();
+        return chunk;
+      }
+
+      bool put(char* chunk)
+      {
+        if (_chunks.size() >= TntConfig::it().maxCachedChunks)
+          return false;
+        _chunks.push_back(chunk);
+        return true;
+      }
+  };
+
+  // The cache is never destroyed, since chunks may be released by the
+  // destructors of other static objects.
+  ChunkCache& chunkCache()
+  {
+    static ThreadLocal<ChunkCache>* cache = new ThreadLocal<ChunkCache>();
+    return cache->get();
+  }
+
+  const unsigned defaultChunksize = 32768;
+}
+
+char* cstreambuf::allocChunk()
+{
+  char* chunk = 0;
+  if (_chunksize == defaultChunksize)
+    chunk = chunkCache().get();
+  return chunk ? chunk : new char[_chunksize];
+}
+
+void cstreambuf::releaseChunk(char* chunk)
+{
+  if (_chunksize != defaultChunksize || !chunkCache().put(chunk))
+    delete[] chunk;
+}
+
 cstreambuf::~cstreambuf()
 {
   log_debug(static_cast<const void*>(this) << " delete " << _chunks.size() << " chunks (dtor)");
   for (size_type n = 0; n < _chunks.size(); ++n)
-    delete[] _chunks[n];
+    releaseChunk(_chunks[n]);
 }
 
 void cstreambuf::makeEmpty()
@@ -51,7 +111,7 @@ void cstreambuf::makeEmpty()
       for (size_type n = 1; n < _chunks.size(); ++n)
       {
         log_debug(static_cast<const void*>(this) << " delete chunk " << n);
-        delete[] _chunks[n];
+        releaseChunk(_chunks[n]);
       }
       _chunks.resize(1);
     }
@@ -62,7 +122,19 @@ void cstreambuf::makeEmpty()
 
 std::streambuf::int_type cstreambuf::overflow(std::streambuf::int_type ch)
 {
-  char* chunk = new char[_chunksize];
+  if (_drain && _chunks.size() > 0 && size() >= _drainLimit)
+  {
+    log_debug(static_cast<const void*>(this) << " drain " << size() << " bytes");
+    _drain->drain(*this);
+    if (pptr() < epptr())
+    {
+      if (ch != traits_type::eof())
+        sputc(traits_type::to_char_type(ch));
+      return 0;
+    }
+  }
+
+  char* chunk = allocChunk();
   log_debug(static_cast<const void*>(this) << " new chunk " << static_cast<const void*>(chunk));
   _chunks.push_back(chunk);
   setp(_chunks.back(), _chunks.back() + _chunksize);
@@ -96,7 +168,7 @@ void cstreambuf::rollback(size_type n)
     for (size_type cc = c + 1; cc < _chunks.size(); ++cc)
     {
       log_debug(static_cast<const void*>(this) << " delete chunk " << cc);
-      delete[] _chunks[cc];
+      releaseChunk(_chunks[cc]);
     }
 
     _chunks.resize(c + 1);
@@ -55,7 +55,8 @@ namespace tnt
 
   DeflateStreamBuf::DeflateStreamBuf(std::streambuf* sink, int level, unsigned bufsize)
     : _obuffer(bufsize),
-      _sink(sink)
+      _sink(sink),
+      _level(level)
   {
     memset(&_stream, 0, sizeof(z_stream));
     _stream.zalloc = Z_NULL;
@@ -128,14 +129,21 @@ namespace tnt
     _stream.next_in = reinterpret_cast<Bytef*>(&_obuffer[0]);
     _stream.avail_in = pptr() - pbase();
     char zbuffer[8192];
-    while (_stream.avail_in > 0)
+
+    // deflate may hold back data from previous calls even when the buffer
+    // is empty, so flush until it leaves space in the output buffer
+    do
     {
       // initialize zbuffer
       _stream.next_out = (Bytef*)zbuffer;
       _stream.avail_out = sizeof(zbuffer);
 
       log_debug("deflate(" << static_cast<const void*>(&_stream) << ", Z_SYNC_FLUSH)");
-      checkError(::deflate(&_stream, Z_SYNC_FLUSH), _stream);
+      int ret = ::deflate(&_stream, Z_SYNC_FLUSH);
+
+      // Z_BUF_ERROR just tells, that there was nothing to flush
+      if (ret != Z_BUF_ERROR)
+        checkError(ret, _stream);
 
       // copy zbuffer to sink
       std::streamsize count = sizeof(zbuffer) - _stream.avail_out;
@@ -145,7 +153,7 @@ namespace tnt
         if (n < count)
           return -1;
       }
-    };
+    } while (_stream.avail_out == 0);
 
     // reset outbuffer
     setp(&_obuffer[0], &_obuffer[0] + _obuffer.size());
@@ -190,6 +198,16 @@ namespace tnt
     checkError(::deflateReset(&_stream), _stream);
   }
 
+  void DeflateStreamBuf::setLevel(int level)
+  {
+    if (level != _level)
+    {
+      log_debug("deflateParams(" << static_cast<const void*>(&_stream) << ", " << level << ')');
+      checkError(::deflateParams(&_stream, level, Z_DEFAULT_STRATEGY), _stream);
+      _level = level;
+    }
+  }
+
   void DeflateStream::end()
   {
     if (_streambuf.end() != 0)
@@ -30,6 +30,7 @@
 #include "tnt/dispatcher.h"
 #include <tnt/httperror.h>
 #include <tnt/httprequest.h>
+#include <tnt/replycache.h>
 #include <tnt/tntconfig.h>
 #include <functional>
 #include <iterator>
@@ -120,6 +121,19 @@ namespace tnt
     return _pos < other._pos;
   }
 
+  Dispatcher::~Dispatcher()
+  {
+    for (unsigned n = 0; n < _replyCaches.size(); ++n)
+      delete _replyCaches[n];
+  }
+
+  ReplyCache* Dispatcher::addReplyCache(const TntConfig::Cache& config)
+  {
+    cxxtools::WriteLock lock(_mutex);
+    _replyCaches.push_back(new ReplyCache(config));
+    return _replyCaches.back();
+  }
+
   Mapping& Dispatcher::addUrlMapEntry(const std::string& vhost,
     const std::string& url, const std::string& method, int ssl, const Maptarget& ci)
   {
@@ -140,12 +154,9 @@ namespace tnt
     };
   }
 
-  Maptarget Dispatcher::mapCompNext(const HttpRequest& request,
-    Dispatcher::urlmap_type::size_type& pos) const
+  bool Dispatcher::mapCompNext(const HttpRequest& request,
+    Dispatcher::urlmap_type::size_type& pos, Maptarget& ci) const
   {
-    std::string vhost = request.getHost();
-    std::string compUrl = request.getUrl();
-
     if (pos < _urlmap.size())
     {
       // check cache
@@ -162,7 +173,8 @@ namespace tnt
         {
           pos = um->second.pos;
           log_debug("match <" << _urlmap[pos] << "> => " << um->second.ci << " (cached)");
-          return um->second.ci;
+          ci = um->second.ci;
+          return true;
         }
 
         log_debug("entry not found in cache");
@@ -179,10 +191,14 @@ namespace tnt
         {
           const Maptarget& src = _urlmap[pos].getTarget();
 
-          Maptarget ci;
+          ci = Maptarget();
           ci.libname = formatter(src.libname);
           ci.compname = formatter(src.compname);
           ci.setHttpReturn(src.getHttpReturn());
+          ci.setEtag(src.getEtag());
+          ci.setReplyBufferLimit(src.getReplyBufferLimit());
+          ci.setReplyCache(src.getReplyCache());
+          ci.setCoalesce(src.getCoalesce());
 
           if (src.hasPathInfo())
             ci.setPathInfo(formatter(src.getPathInfo()));
@@ -206,7 +222,7 @@ namespace tnt
           }
 
           log_debug("match <" << _urlmap[pos] << "> => " << ci);
-          return ci;
+          return true;
         }
         else
         {
@@ -215,16 +231,24 @@ namespace tnt
       }
     }
 
-    throw NotFoundException(compUrl, vhost);
+    return false;
   }
 
-  Maptarget Dispatcher::PosType::getNext()
+  bool Dispatcher::PosType::getNext(Maptarget& ci)
   {
     if (_first)
       _first = false;
     else
       ++_pos;
 
-    return _dis.mapCompNext(_request, _pos);
+    return _dis.mapCompNext(_request, _pos, ci);
+  }
+
+  Maptarget Dispatcher::PosType::getNext()
+  {
+    Maptarget ci;
+    if (!getNext(ci))
+      throw NotFoundException(_request.getUrl(), _request.getHost());
+    return ci;
   }
 }
@@ -48,114 +48,92 @@ namespace tnt
     if (header == 0)
       return;
 
-    enum {
-      state_0,
-      state_encoding,
-      state_quality,
-      state_qualityq,
-      state_qualityeq,
-      state_qualitypoint,
-      state_qualitytenth,
-      state_qualityign
-    } state = state_0;
-
-    std::string encoding;
-    unsigned quality = 0;
-    for (const char* p = header; *p; ++p)
+    // The header is a comma separated list of content codings with an
+    // optional quality value each, e.g. "br;q=1.0, gzip;q=0.8, *;q=0".
+    // Qualities are stored in tenths, so they are in the range 0..10.
+    const char* p = header;
+    while (*p)
     {
-      char ch = *p;
-      switch (state)
-      {
-        case state_0:
-          if (!std::isspace(ch))
-          {
-            encoding.clear();
-            encoding.reserve(16);
-            encoding += ch;
-            state = state_encoding;
-          }
-          break;
+      while (*p == ',' || std::isspace(*p))
+        ++p;
 
-        case state_encoding:
-          if (ch == ';')
-            state = state_qualityq;
-          else if (ch == ',')
-          {
-            _encodingMap.insert(encodingMapType::value_type(encoding, 1));
-            state = state_0;
-          }
-          else
-            encoding += ch;
-          break;
-
-        case state_qualityq:
-          if (ch == 'q')
-            state = state_qualityeq;
-          else if (!std::isspace(ch))
-            throwInvalidHeader(header);
-          break;
-
-        case state_qualityeq:
-          if (ch == '=')
-            state = state_quality;
-          else if (!std::isspace(ch))
-            throwInvalidHeader(header);
-          break;
-
-        case state_quality:
-          if (std::isdigit(ch))
+      if (*p == '\0')
+        break;
+
+      std::string encoding;
+      while (*p && *p != ',' && *p != ';' && !std::isspace(*p))
+        encoding += static_cast<char>(std::tolower(*p++));
+
+      while (std::isspace(*p))
+        ++p;
+
+      unsigned quality = 10;
+
+      while (*p == ';')
+      {
+        ++p;
+        while (std::isspace(*p))
+          ++p;
+
+        if (*p != 'q' && *p != 'Q')
+        {
+          // skip unknown parameter
+          while (*p && *p != ',' && *p != ';')
+            ++p;
+          continue;
+        }
+
+        ++p;
+        while (std::isspace(*p))
+          ++p;
+
+        if (*p++ != '=')
+          throwInvalidHeader(header);
+
+        while (std::isspace(*p))
+          ++p;
+
+        if (*p == '0')
+        {
+          ++p;
+          quality = 0;
+          if (*p == '.')
           {
-            quality = (ch - '0') * 10;
-            state = state_qualitypoint;
+            ++p;
+            if (std::isdigit(*p))
+              quality = *p++ - '0';
+
+            // do not drop a small but positive quality to 0
+            for (; std::isdigit(*p); ++p)
+              if (quality == 0 && *p != '0')
+                quality = 1;
           }
-          else
-            throwInvalidHeader(header);
-          break;
-
-        case state_qualitypoint:
-          if (ch == '.')
-            state = state_qualitytenth;
-          else if (ch == ';')
+        }
+        else if (*p == '1')
+        {
+          ++p;
+          if (*p == '.')
           {
-            _encodingMap.insert(encodingMapType::value_type(encoding, quality));
-            state = state_0;
+            ++p;
+            while (*p == '0')
+              ++p;
           }
-          else
-            throwInvalidHeader(header);
-          break;
+        }
+        else
+          throwInvalidHeader(header);
 
-        case state_qualitytenth:
-          if (std::isdigit(ch))
-          {
-            quality += ch - '0';
-            _encodingMap.insert(encodingMapType::value_type(encoding, quality));
-            state = state_qualityign;
-          }
-          else if (ch == ';')
-            state = state_0;
-          break;
-
-        case state_qualityign:
-          if (ch == ';')
-            state = state_0;
-          break;
-      }
-    }
+        while (std::isspace(*p))
+          ++p;
 
-    switch (state)
-    {
-      case state_encoding:
-        _encodingMap.insert(encodingMapType::value_type(encoding, 1));
-        break;
+        if (*p && *p != ',' && *p != ';')
+          throwInvalidHeader(header);
+      }
 
-      case state_quality:
-      case state_qualitypoint:
-      case state_qualitytenth:
-        _encodingMap.insert(encodingMapType::value_type(encoding, quality));
-        break;
+      if (*p && *p != ',')
+        throwInvalidHeader(header);
 
-      default:
-        break;
+      if (!encoding.empty())
+        _encodingMap[encoding] = quality;
     }
   }
 
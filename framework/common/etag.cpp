@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#include <tnt/etag.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <cctype>
+
+namespace tnt
+{
+  namespace
+  {
+    const uint64_t prime1 = 11400714785074694791ULL;
+    const uint64_t prime2 = 14029467366897019727ULL;
+    const uint64_t prime3 =  1609587929392839161ULL;
+    const uint64_t prime4 =  9650029242287828579ULL;
+    const uint64_t prime5 =  2870177450012600261ULL;
+
+    inline uint64_t rotl(uint64_t v, unsigned r)
+    { return (v << r) | (v >> (64 - r)); }
+
+    inline uint64_t read64(const unsigned char* p)
+    {
+      uint64_t v = 0;
+      for (unsigned n = 8; n > 0; --n)
+        v = (v << 8) | p[n - 1];
+      return v;
+    }
+
+    inline uint64_t read32(const unsigned char* p)
+    {
+      return static_cast<uint64_t>(p[0])
+          | (static_cast<uint64_t>(p[1]) << 8)
+          | (static_cast<uint64_t>(p[2]) << 16)
+          | (static_cast<uint64_t>(p[3]) << 24);
+    }
+
+    inline uint64_t round(uint64_t acc, uint64_t input)
+    {
+      acc += input * prime2;
+      acc = rotl(acc, 31);
+      return acc * prime1;
+    }
+
+    inline uint64_t mergeRound(uint64_t acc, uint64_t val)
+    {
+      acc ^= round(0, val);
+      return acc * prime1 + prime4;
+    }
+
+    void appendHex(std::string& s, uint64_t v)
+    {
+      static const char hex[] = "0123456789abcdef";
+      char buffer[16];
+      unsigned n = sizeof(buffer);
+      do
+      {
+        buffer[--n] = hex[v & 0xf];
+        v >>= 4;
+      } while (v != 0);
+      s.append(buffer + n, sizeof(buffer) - n);
+    }
+
+    // skips a "W/" prefix of a weak entity tag
+    const char* opaqueTag(const char* p)
+    { return p[0] == 'W' && p[1] == '/' ? p + 2 : p; }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // XxHash64
+  //
+  void XxHash64::reset(uint64_t seed)
+  {
+    _seed = seed;
+    _acc[0] = seed + prime1 + prime2;
+    _acc[1] = seed + prime2;
+    _acc[2] = seed;
+    _acc[3] = seed - prime1;
+    _total = 0;
+    _bufsize = 0;
+  }
+
+  void XxHash64::consume(const unsigned char* p)
+  {
+    _acc[0] = round(_acc[0], read64(p));
+    _acc[1] = round(_acc[1], read64(p + 8));
+    _acc[2] = round(_acc[2], read64(p + 16));
+    _acc[3] = round(_acc[3], read64(p + 24));
+  }
+
+  void XxHash64::update(const char* data, size_t size)
+  {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* e = p + size;
+    _total += size;
+
+    if (_bufsize > 0)
+    {
+      size_t n = sizeof(_buffer) - _bufsize;
+      if (size < n)
+      {
+        std::memcpy(_buffer + _bufsize, p, size);
+        _bufsize += size;
+        return;
+      }
+
+      std::memcpy(_buffer + _bufsize, p, n);
+      consume(_buffer);
+      p += n;
+      _bufsize = 0;
+    }
+
+    for (; e - p >= 32; p += 32)
+      consume(p);
+
+    std::memcpy(_buffer, p, e - p);
+    _bufsize = e - p;
+  }
+
+  uint64_t XxHash64::digest() const
+  {
+    uint64_t h;
+    if (_total >= 32)
+    {
+      h = rotl(_acc[0], 1) + rotl(_acc[1], 7) + rotl(_acc[2], 12) + rotl(_acc[3], 18);
+      h = mergeRound(h, _acc[0]);
+      h = mergeRound(h, _acc[1]);
+      h = mergeRound(h, _acc[2]);
+      h = mergeRound(h, _acc[3]);
+    }
+    else
+      h = _seed + prime5;
+
+    h += _total;
+
+    const unsigned char* p = _buffer;
+    const unsigned char* e = _buffer + _bufsize;
+
+    for (; e - p >= 8; p += 8)
+    {
+      h ^= round(0, read64(p));
+      h = rotl(h, 27) * prime1 + prime4;
+    }
+
+    if (e - p >= 4)
+    {
+      h ^= read32(p) * prime1;
+      h = rotl(h, 23) * prime2 + prime3;
+      p += 4;
+    }
+
+    for (; p < e; ++p)
+    {
+      h ^= *p * prime5;
+      h = rotl(h, 11) * prime1;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+
+    return h;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // entity tags
+  //
+  std::string makeEtag(uint64_t hash)
+  {
+    std::string etag(1, '"');
+    appendHex(etag, hash);
+    etag += '"';
+    return etag;
+  }
+
+  std::string makeEtag(const struct ::stat& st)
+  {
+    std::string etag(1, '"');
+    appendHex(etag, static_cast<uint64_t>(st.st_ino));
+    etag += '-';
+    appendHex(etag, static_cast<uint64_t>(st.st_mtime));
+    etag += '-';
+    appendHex(etag, static_cast<uint64_t>(st.st_size));
+    etag += '"';
+    return etag;
+  }
+
+  bool etagMatches(const char* ifNoneMatch, const std::string& etag,
+    bool withCoding, std::string* matched)
+  {
+    const char* tag = opaqueTag(etag.c_str());
+    std::string::size_type taglen = etag.size() - (tag - etag.c_str());
+
+    // the tag without the closing quote, so that a content coding may follow
+    std::string::size_type prefixlen = taglen > 0 ? taglen - 1 : 0;
+
+    const char* p = ifNoneMatch;
+    while (*p)
+    {
+      while (*p == ',' || std::isspace(static_cast<unsigned char>(*p)))
+        ++p;
+
+      if (*p == '*')
+      {
+        if (matched)
+          *matched = etag;
+        return true;
+      }
+
+      const char* b = opaqueTag(p);
+      if (*b != '"')
+      {
+        // no valid entity tag; skip to the next one
+        while (*p && *p != ',')
+          ++p;
+        continue;
+      }
+
+      const char* e = std::strchr(b + 1, '"');
+      if (e == 0)
+        return false;
+
+      ++e;
+      std::string::size_type len = e - b;
+
+      if (len == taglen && std::strncmp(b, tag, len) == 0)
+      {
+        if (matched)
+          *matched = etag;
+        return true;
+      }
+
+      if (withCoding
+        && len > prefixlen + 2
+        && std::strncmp(b, tag, prefixlen) == 0
+        && b[prefixlen] == '-')
+      {
+        if (matched)
+          matched->assign(b, len);
+        return true;
+      }
+
+      p = e;
+    }
+
+    return false;
+  }
+}
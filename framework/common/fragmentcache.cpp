@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <tnt/fragmentcache.h>
+#include <tnt/tntconfig.h>
+#include <cxxtools/mutex.h>
+#include <cxxtools/log.h>
+#include <list>
+#include <map>
+#include <time.h>
+
+log_define("tntnet.fragmentcache")
+
+namespace tnt
+{
+  namespace
+  {
+    typedef std::list<std::string> LruType;
+
+    struct Fragment
+    {
+      FragmentCache::ContentPtr content;
+      std::string tag;
+      time_t expires;   // 0 = never
+      std::size_t size;
+      LruType::iterator lru;
+    };
+
+    typedef std::map<std::string, Fragment> FragmentsType;
+
+    // Only the pointer to the content is copied under the lock. The most
+    // recently used key is at the front of the lru list.
+    cxxtools::Mutex fragmentsMutex;
+    FragmentsType fragments;
+    LruType lru;
+    std::size_t fragmentBytes = 0;
+
+    time_t currentSeconds()
+    {
+      struct timespec ts;
+      ::clock_gettime(CLOCK_MONOTONIC, &ts);
+      return ts.tv_sec;
+    }
+
+    bool isExpired(const Fragment& fragment, time_t now)
+    {
+      return fragment.expires != 0 && fragment.expires <= now;
+    }
+
+    // estimates the memory used by a fragment including the key in the map
+    // and in the lru list
+    std::size_t fragmentSize(const std::string& key, const Fragment& fragment)
+    {
+      return 2 * key.size() + fragment.tag.size() + fragment.content->str().size()
+           + sizeof(FragmentsType::value_type) + sizeof(std::string);
+    }
+
+    void erase(FragmentsType::iterator it)
+    {
+      fragmentBytes -= it->second.size;
+      lru.erase(it->second.lru);
+      fragments.erase(it);
+    }
+
+    // removes the least recently used fragments, until `size` more bytes fit
+    void makeRoom(std::size_t size, std::size_t maxBytes)
+    {
+      unsigned count = 0;
+      while (!lru.empty() && fragmentBytes + size > maxBytes)
+      {
+        erase(fragments.find(lru.back()));
+        ++count;
+      }
+
+      if (count > 0)
+        log_debug(count << " fragments evicted");
+    }
+  }
+
+  FragmentCache::ContentPtr FragmentCache::get(const std::string& key)
+  {
+    cxxtools::MutexLock lock(fragmentsMutex);
+
+    FragmentsType::iterator it = fragments.find(key);
+    if (it == fragments.end())
+    {
+      log_debug("fragment \"" << key << "\" not found");
+      return ContentPtr();
+    }
+
+    if (isExpired(it->second, currentSeconds()))
+    {
+      log_debug("fragment \"" << key << "\" expired");
+      erase(it);
+      return ContentPtr();
+    }
+
+    lru.splice(lru.begin(), lru, it->second.lru);
+    return it->second.content;
+  }
+
+  bool FragmentCache::get(const std::string& key, std::string& content)
+  {
+    ContentPtr c = get(key);
+    if (c.getPointer() == 0)
+      return false;
+
+    content = c->str();
+    return true;
+  }
+
+  void FragmentCache::put(const std::string& key, ContentPtr content,
+                          unsigned ttl, const std::string& tag)
+  {
+    time_t now = currentSeconds();
+    std::size_t maxBytes = TntConfig::it().fragmentCacheSize;
+
+    cxxtools::MutexLock lock(fragmentsMutex);
+
+    FragmentsType::iterator it = fragments.find(key);
+    if (it != fragments.end())
+      erase(it);
+
+    Fragment fragment;
+    fragment.content = content;
+    fragment.tag = tag;
+    fragment.expires = ttl > 0 ? now + ttl : 0;
+    fragment.size = fragmentSize(key, fragment);
+
+    if (fragment.size > maxBytes)
+    {
+      log_debug("fragment \"" << key << "\" with " << content->str().size() << " bytes is too large for the cache");
+      return;
+    }
+
+    makeRoom(fragment.size, maxBytes);
+
+    lru.push_front(key);
+    fragment.lru = lru.begin();
+    fragments.insert(FragmentsType::value_type(key, fragment));
+    fragmentBytes += fragment.size;
+
+    log_debug("fragment \"" << key << "\" stored with " << content->str().size() << " bytes");
+  }
+
+  unsigned FragmentCache::invalidate(const std::string& prefix)
+  {
+    cxxtools::MutexLock lock(fragmentsMutex);
+
+    unsigned count = 0;
+    FragmentsType::iterator it = fragments.lower_bound(prefix);
+    while (it != fragments.end() && it->first.compare(0, prefix.size(), prefix) == 0)
+    {
+      erase(it++);
+      ++count;
+    }
+
+    log_debug(count << " fragments with prefix \"" << prefix << "\" invalidated");
+    return count;
+  }
+
+  unsigned FragmentCache::invalidateTag(const std::string& tag)
+  {
+    cxxtools::MutexLock lock(fragmentsMutex);
+
+    unsigned count = 0;
+    for (FragmentsType::iterator it = fragments.begin(); it != fragments.end(); )
+    {
+      if (it->second.tag == tag)
+      {
+        erase(it++);
+        ++count;
+      }
+      else
+        ++it;
+    }
+
+    log_debug(count << " fragments with tag \"" << tag << "\" invalidated");
+    return count;
+  }
+
+  void FragmentCache::clear()
+  {
+    cxxtools::MutexLock lock(fragmentsMutex);
+    fragments.clear();
+    lru.clear();
+    fragmentBytes = 0;
+  }
+}
@@ -36,6 +36,10 @@
 #include <sys/poll.h>
 #include <errno.h>
 #include <cxxtools/ioerror.h>
+#include <cxxtools/systemerror.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
 
 log_define("tntnet.ssl")
 
@@ -367,6 +371,37 @@ namespace tnt
     return ret;
   }
 
+  void GnuTlsStream::sslSendFile(int fd, off_t offset, off_t count) const
+  {
+    // pass large blocks to gnutls_record_send, so that full sized tls
+    // records are written without copying the data through the stream buffer
+    std::vector<char> buffer(65536);
+    while (count > 0)
+    {
+      ssize_t n = ::pread(fd, &buffer[0], std::min(count, static_cast<off_t>(buffer.size())), offset);
+      if (n < 0 && errno == EINTR)
+        continue;
+
+      if (n < 0)
+        throw cxxtools::SystemError("pread");
+
+      if (n == 0)
+        throw std::runtime_error("file truncated while sending");
+
+      offset += n;
+      count -= n;
+
+      // gnutls_record_send may send less than requested
+      const char* p = &buffer[0];
+      while (n > 0)
+      {
+        int s = sslWrite(p, n);
+        p += s;
+        n -= s;
+      }
+    }
+  }
+
   void GnuTlsStream::shutdown()
   {
     int ret;
@@ -29,19 +29,111 @@
 
 #include "tnt/htmlescostream.h"
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 namespace tnt
 {
+  namespace
+  {
+    inline bool needsEscape(char ch)
+    {
+      return ch == '<' || ch == '>' || ch == '&' || ch == '"' || ch == '\'';
+    }
+
+    // Returns the first character in [b, e), which must be escaped, or e.
+    const char* findEscape(const char* b, const char* e)
+    {
+#if defined(__AVX2__)
+      {
+        const __m256i lt = _mm256_set1_epi8('<');
+        const __m256i gt = _mm256_set1_epi8('>');
+        const __m256i amp = _mm256_set1_epi8('&');
+        const __m256i quot = _mm256_set1_epi8('"');
+        const __m256i apos = _mm256_set1_epi8('\'');
+
+        for (; e - b >= 32; b += 32)
+        {
+          __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+          __m256i m = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, lt), _mm256_cmpeq_epi8(v, gt)),
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, amp),
+                          _mm256_or_si256(_mm256_cmpeq_epi8(v, quot), _mm256_cmpeq_epi8(v, apos))));
+          unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+          if (mask)
+            return b + __builtin_ctz(mask);
+        }
+      }
+#endif
+
+#if defined(__SSE2__)
+      {
+        const __m128i lt = _mm_set1_epi8('<');
+        const __m128i gt = _mm_set1_epi8('>');
+        const __m128i amp = _mm_set1_epi8('&');
+        const __m128i quot = _mm_set1_epi8('"');
+        const __m128i apos = _mm_set1_epi8('\'');
+
+        for (; e - b >= 16; b += 16)
+        {
+          __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+          __m128i m = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(v, lt), _mm_cmpeq_epi8(v, gt)),
+                        _mm_or_si128(_mm_cmpeq_epi8(v, amp),
+                          _mm_or_si128(_mm_cmpeq_epi8(v, quot), _mm_cmpeq_epi8(v, apos))));
+          unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(m));
+          if (mask)
+            return b + __builtin_ctz(mask);
+        }
+      }
+#endif
+
+      for (; b < e; ++b)
+        if (needsEscape(*b))
+          return b;
+
+      return e;
+    }
+
+    inline std::streambuf::int_type putEscaped(std::streambuf* sink, char ch)
+    {
+      switch (ch)
+      {
+        case '<': return sink->sputn("&lt;", 4);
+        case '>': return sink->sputn("&gt;", 4);
+        case '&': return sink->sputn("&amp;", 5);
+        case '"': return sink->sputn("&quot;", 6);
+        case '\'': return sink->sputn("&#39;", 5);
+        default: return sink->sputc(ch);
+      }
+    }
+  }
+
   std::streambuf::int_type HtmlEscStreamBuf::overflow(std::streambuf::int_type ch)
   {
-    switch (ch)
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+      return traits_type::not_eof(ch);
+    return putEscaped(_sink, traits_type::to_char_type(ch));
+  }
+
+  std::streamsize HtmlEscStreamBuf::xsputn(const char* s, std::streamsize n)
+  {
+    const char* e = s + n;
+    while (s < e)
     {
-      case '<': return _sink->sputn("&lt;", 4);
-      case '>': return _sink->sputn("&gt;", 4);
-      case '&': return _sink->sputn("&amp;", 5);
-      case '"': return _sink->sputn("&quot;", 6);
-      case '\'': return _sink->sputn("&#39;", 5);
-      default: return _sink->sputc(ch);
+      const char* p = findEscape(s, e);
+      if (p > s)
+        _sink->sputn(s, p - s);
+
+      if (p == e)
+        break;
+
+      putEscaped(_sink, *p);
+      s = p + 1;
     }
+
+    return n;
   }
 
   std::streambuf::int_type HtmlEscStreamBuf::underflow()
@@ -50,4 +142,3 @@ namespace tnt
   int HtmlEscStreamBuf::sync()
     { return _sink->pubsync(); }
 }
-
@@ -67,6 +67,12 @@ namespace tnt
     const char* contentDisposition = "Content-Disposition:";
     const char* age = "Age:";
     const char* transferEncoding = "Transfer-Encoding:";
+    const char* vary = "Vary:";
+    const char* etag = "ETag:";
+    const char* ifNoneMatch = "If-None-Match:";
+    const char* ifRange = "If-Range:";
+    const char* expect = "Expect:";
+    const char* expect100Continue = "100-continue";
   }
 }
 
@@ -30,6 +30,7 @@
 #include <tnt/httpmessage.h>
 #include <cxxtools/log.h>
 #include <cxxtools/mutex.h>
+#include <cxxtools/atomicity.h>
 #include <list>
 #include <sstream>
 #include <stdio.h>
@@ -103,6 +104,110 @@ namespace tnt
       tm->tm_hour, tm->tm_min, tm->tm_sec);
   }
 
+  namespace
+  {
+    const char* skipSpace(const char* p)
+    {
+      while (*p == ' ')
+        ++p;
+      return p;
+    }
+
+    const char* parseNumber(const char* p, unsigned maxDigits, int& value)
+    {
+      if (*p < '0' || *p > '9')
+        return 0;
+
+      value = 0;
+      for (unsigned n = 0; n < maxDigits && *p >= '0' && *p <= '9'; ++n, ++p)
+        value = value * 10 + (*p - '0');
+
+      return p;
+    }
+
+    const char* parseMonth(const char* p, int& month)
+    {
+      static const char monthn[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+      for (month = 0; month < 12; ++month)
+        if (std::strncmp(p, monthn + month * 3, 3) == 0)
+          return p + 3;
+      return 0;
+    }
+
+    const char* parseTime(const char* p, int& hour, int& min, int& sec)
+    {
+      if ((p = parseNumber(p, 2, hour)) == 0 || *p++ != ':'
+        || (p = parseNumber(p, 2, min)) == 0 || *p++ != ':'
+        || (p = parseNumber(p, 2, sec)) == 0)
+        return 0;
+      return p;
+    }
+
+    // days since 1970-01-01 of a date in the gregorian calendar
+    long daysFromCivil(int year, int month, int day)
+    {
+      year -= month <= 2;
+      long era = (year >= 0 ? year : year - 399) / 400;
+      long yoe = year - era * 400;
+      long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+      long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+      return era * 146097 + doe - 719468;
+    }
+  }
+
+  bool HttpMessage::parseHtdate(const char* date, time_t& t)
+  {
+    int year, month, day, hour, min, sec;
+
+    // day of week
+    const char* p = date;
+    while ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z'))
+      ++p;
+
+    if (*p == ',')
+    {
+      // "Sun, 06 Nov 1994 08:49:37 GMT" or "Sunday, 06-Nov-94 08:49:37 GMT"
+      p = skipSpace(p + 1);
+      if ((p = parseNumber(p, 2, day)) == 0)
+        return false;
+
+      char sep = *p;
+      if ((sep != ' ' && sep != '-')
+        || (p = parseMonth(p + 1, month)) == 0
+        || *p++ != sep
+        || (p = parseNumber(p, 4, year)) == 0
+        || *p++ != ' '
+        || (p = parseTime(p, hour, min, sec)) == 0)
+        return false;
+
+      if (sep == '-' && year < 100)
+        year += year < 70 ? 2000 : 1900;
+
+      if (std::strcmp(skipSpace(p), "GMT") != 0)
+        return false;
+    }
+    else
+    {
+      // "Sun Nov  6 08:49:37 1994"
+      p = skipSpace(p);
+      if ((p = parseMonth(p, month)) == 0
+        || (p = parseNumber(skipSpace(p), 2, day)) == 0
+        || *p++ != ' '
+        || (p = parseTime(p, hour, min, sec)) == 0
+        || (p = parseNumber(skipSpace(p), 4, year)) == 0
+        || *p != '\0')
+        return false;
+    }
+
+    if (day < 1 || day > 31 || hour > 23 || min > 59 || sec > 60)
+      return false;
+
+    t = static_cast<time_t>(daysFromCivil(year, month + 1, day)) * 86400
+      + hour * 3600 + min * 60 + sec;
+
+    return true;
+  }
+
   std::string HttpMessage::htdateCurrent()
   {
     char current[30];
@@ -151,6 +256,51 @@ namespace tnt
     std::strcpy(current, lastHtdate);
   }
 
+  namespace
+  {
+    // The cached date is protected by a sequence counter. Only the timer
+    // thread writes and the counter is odd while it does. Readers retry,
+    // when the counter changed during their copy.
+    char cachedHtdate[30];
+    cxxtools::atomic_t cachedHtdateSeq = 0;
+    cxxtools::atomic_t cachedHtdateValid = 0;
+  }
+
+  void HttpMessage::htdateCached(char* current)
+  {
+    if (cxxtools::atomicGet(cachedHtdateValid))
+    {
+      for (unsigned n = 0; n < 3; ++n)
+      {
+        cxxtools::atomic_t seq = cxxtools::atomicGet(cachedHtdateSeq);
+        if (seq & 1)
+          continue;
+
+        std::memcpy(current, cachedHtdate, sizeof(cachedHtdate));
+        if (cxxtools::atomicGet(cachedHtdateSeq) == seq)
+          return;
+      }
+    }
+
+    htdateCurrent(current);
+  }
+
+  void HttpMessage::refreshHtdateCache()
+  {
+    char current[30];
+    htdateCurrent(current);
+
+    cxxtools::atomicIncrement(cachedHtdateSeq);
+    std::memcpy(cachedHtdate, current, sizeof(cachedHtdate));
+    cxxtools::atomicIncrement(cachedHtdateSeq);
+    cxxtools::atomicSet(cachedHtdateValid, 1);
+  }
+
+  void HttpMessage::clearHtdateCache()
+  {
+    cxxtools::atomicSet(cachedHtdateValid, 0);
+  }
+
   namespace
   {
     class Pstr
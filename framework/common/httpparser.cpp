@@ -31,9 +31,12 @@
 #include <tnt/httperror.h>
 #include <tnt/httpheader.h>
 #include <tnt/tntconfig.h>
+#include <tnt/stringlessignorecase.h>
 #include <cxxtools/log.h>
+#include <cxxtools/convert.h>
 #include <sstream>
 #include <algorithm>
+#include <zlib.h>
 
 #define SET_STATE(new_state) _state = &Parser::new_state
 
@@ -94,6 +97,7 @@ namespace tnt
     SET_STATE(state_cmd0);
     _httpCode = HTTP_OK;
     _failedFlag = false;
+    _expectContinue = false;
     RequestSizeMonitor::reset();
     _headerParser.reset();
   }
@@ -402,6 +406,21 @@ namespace tnt
         return true;
       }
 
+      const char* expect = _message.getHeader(httpheader::expect);
+      if (*expect)
+      {
+        if (tnt::StringCompareIgnoreCase<const char*>(expect, httpheader::expect100Continue) != 0)
+        {
+          log_info("unsupported expectation \"" << expect << '"');
+          throw HttpError(HTTP_EXPECTATION_FAILED, "expectation failed", "Expectation not supported by this server");
+        }
+
+        // clients using HTTP/1.0 must not get an interim response, so the
+        // expectation is ignored there
+        _expectContinue = _message.getMajorVersion() > 1
+                       || (_message.getMajorVersion() == 1 && _message.getMinorVersion() >= 1);
+      }
+
       const char* content_length_header = _message.getHeader(httpheader::contentLength);
       if (*content_length_header)
       {
@@ -422,15 +441,24 @@ namespace tnt
 
         _message._contentSize = _bodySize;
         if (_bodySize == 0)
+        {
+          _expectContinue = false;
           return true;
+        }
         else
         {
           SET_STATE(state_body);
           _message._body.reserve(_bodySize);
-          return false;
+
+          // when the client waits for "100 Continue" we stop here and let the
+          // worker decide, whether the body is wanted at all
+          if (_expectContinue)
+            log_debug("expect 100-continue; body of " << _bodySize << " bytes pending");
+          return _expectContinue;
         }
       }
 
+      _expectContinue = false;
       return true;
     }
 
@@ -440,7 +468,106 @@ namespace tnt
   bool HttpRequest::Parser::state_body(char ch)
   {
     _message._body += ch;
-    return --_bodySize == 0;
+    if (--_bodySize > 0)
+      return false;
+
+    if (TntConfig::it().inflateRequestBody)
+      inflateBody();
+
+    return true;
+  }
+
+  void HttpRequest::Parser::inflateBody()
+  {
+    const char* contentEncoding = _message.getHeader(httpheader::contentEncoding);
+
+    // gzip and zlib format are detected by zlib automatically
+    int windowBits;
+    if (tnt::StringCompareIgnoreCase<const char*>(contentEncoding, "gzip") == 0
+      || tnt::StringCompareIgnoreCase<const char*>(contentEncoding, "x-gzip") == 0
+      || tnt::StringCompareIgnoreCase<const char*>(contentEncoding, "deflate") == 0)
+      windowBits = MAX_WBITS + 32;
+    else
+      return;
+
+    // The inflated body replaces the compressed body in the request size
+    // limit. Independent of that the compression ratio is limited, so that
+    // a small request can't decompress to a huge body.
+    size_t maxBodySize = static_cast<size_t>(-1);
+    if (TntConfig::it().maxRequestSize > 0)
+    {
+      size_t headerSize = getCurrentRequestSize() - _message._body.size();
+      maxBodySize = TntConfig::it().maxRequestSize > headerSize
+                  ? TntConfig::it().maxRequestSize - headerSize : 0;
+    }
+
+    unsigned maxRatio = TntConfig::it().maxInflateRatio;
+    if (maxRatio > 0 && _message._body.size() < maxBodySize / maxRatio)
+      maxBodySize = _message._body.size() * maxRatio;
+
+    std::string body;
+
+    for (unsigned attempt = 0; attempt < 2; ++attempt)
+    {
+      z_stream stream;
+      stream.zalloc = Z_NULL;
+      stream.zfree = Z_NULL;
+      stream.opaque = Z_NULL;
+      stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(_message._body.data()));
+      stream.avail_in = _message._body.size();
+
+      if (inflateInit2(&stream, windowBits) != Z_OK)
+      {
+        log_error("failed to initialize inflate");
+        throw HttpError(HTTP_INTERNAL_SERVER_ERROR, "inflate failed");
+      }
+
+      body.clear();
+      int ret;
+      do
+      {
+        char buffer[8192];
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        ret = ::inflate(&stream, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END)
+          break;
+
+        size_t count = sizeof(buffer) - stream.avail_out;
+        if (body.size() + count > maxBodySize)
+        {
+          ::inflateEnd(&stream);
+          log_warn("inflated request body exceeds " << maxBodySize << " bytes");
+          requestSizeExceeded();
+          return;
+        }
+
+        body.append(buffer, count);
+      } while (ret != Z_STREAM_END);
+
+      ::inflateEnd(&stream);
+
+      if (ret == Z_STREAM_END)
+      {
+        log_debug("request body inflated from " << _message._body.size() << " to " << body.size() << " bytes");
+        _message._body.swap(body);
+        _message._contentSize = _message._body.size();
+        _message.removeHeader(httpheader::contentEncoding);
+        _message.setHeader(httpheader::contentLength, cxxtools::convert<std::string>(_message._contentSize));
+        return;
+      }
+
+      // Some clients send raw deflate data without zlib header for
+      // "Content-Encoding: deflate", so we try that once.
+      if (attempt > 0 || tnt::StringCompareIgnoreCase<const char*>(contentEncoding, "deflate") != 0)
+        break;
+
+      windowBits = -MAX_WBITS;
+    }
+
+    log_info("failed to inflate request body with content encoding \"" << contentEncoding << '"');
+    _httpCode = HTTP_BAD_REQUEST;
+    _failedFlag = true;
   }
 
   void HttpRequest::Parser::requestSizeExceeded()
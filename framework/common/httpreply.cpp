@@ -30,21 +30,34 @@
 #include <tnt/httpreply.h>
 #include <tnt/http.h>
 #include <tnt/httpheader.h>
-#include <tnt/deflatestream.h>
+#include <tnt/compressor.h>
+#include <tnt/compressiongovernor.h>
 #include <tnt/httperror.h>
 #include <tnt/tntconfig.h>
 #include <tnt/htmlescostream.h>
 #include <tnt/urlescostream.h>
 #include <tnt/encoding.h>
+#include <tnt/etag.h>
 #include <tnt/chunkedostream.h>
 #include <tnt/cstream.h>
+#include <tnt/threadlocal.h>
 #include <cxxtools/log.h>
 #include <cxxtools/md5stream.h>
 #include <cxxtools/mutex.h>
 #include <sstream>
+#include <algorithm>
+#include <limits>
 #include <stdio.h>
 #include <zlib.h>
 #include <netinet/in.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/poll.h>
+#include <limits.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
 
 namespace tnt
 {
@@ -52,74 +65,275 @@ namespace tnt
 
   namespace
   {
-    class Compressor
+    // Discards all output; takes the body of replies to HEAD requests,
+    // which are written in direct mode or with chunked encoding.
+    class NullStreamBuf : public std::streambuf
     {
-        ocstream _zbody;
-        DeflateStream _deflator;
-        uLong _crc;
-        unsigned _size;
+      protected:
+        int_type overflow(int_type ch)
+          { return traits_type::not_eof(ch); }
+
+        std::streamsize xsputn(const char*, std::streamsize n)
+          { return n; }
+    };
+
+    // Replies with these status codes never carry a body.
+    bool isBodyless(unsigned ret)
+    {
+      return ret < 200 || ret == HTTP_NO_CONTENT || ret == HTTP_NOT_MODIFIED;
+    }
+
+    // Appends the reply header to a flat buffer, which is passed to the
+    // socket with a single write.
+    class HeaderWriter
+    {
+        std::string& _buffer;
 
       public:
-        Compressor()
-          : _deflator(_zbody),
-            _crc(0),
-            _size(0)
+        explicit HeaderWriter(std::string& buffer)
+          : _buffer(buffer)
+          { }
+
+        template <std::size_t N>
+        HeaderWriter& literal(const char (&s)[N])
+          { _buffer.append(s, N - 1); return *this; }
+
+        HeaderWriter& str(const char* s, std::size_t len)
+          { _buffer.append(s, len); return *this; }
+
+        HeaderWriter& str(const char* s)
+          { _buffer.append(s); return *this; }
+
+        HeaderWriter& str(const std::string& s)
+          { _buffer.append(s); return *this; }
+
+        HeaderWriter& number(unsigned long n)
         {
+          char buffer[24];
+          char* p = buffer + sizeof(buffer);
+          do
+          {
+            *--p = static_cast<char>('0' + n % 10);
+            n /= 10;
+          } while (n > 0);
+          _buffer.append(p, buffer + sizeof(buffer));
+          return *this;
         }
 
-        void init()
+        HeaderWriter& header(const char* key, const char* value)
+          { return str(key).literal(" ").str(value).literal("\r\n"); }
+
+        HeaderWriter& header(const char* key, const std::string& value)
+          { return str(key).literal(" ").str(value).literal("\r\n"); }
+    };
+
+    struct StatusLine
+    {
+      unsigned code;
+      const char* line;
+      unsigned len;
+
+      bool operator< (const StatusLine& other) const
+        { return code < other.code; }
+
+      // The reason phrase follows "HTTP/1.1 nnn " and ends before "\r\n".
+      bool hasText(const char* msg) const
+      {
+        unsigned textLen = len - 15;
+        return strncmp(msg, line + 13, textLen) == 0 && msg[textLen] == '\0';
+      }
+    };
+
+#define TNT_STATUS_LINE(code, text) \
+    { code, "HTTP/1.1 " #code " " text "\r\n", sizeof("HTTP/1.1 " #code " " text "\r\n") - 1 }
+
+    // Complete status lines of the common replies. The texts must match
+    // the ones returned by HttpReturn::httpMessage.
+    const StatusLine statusLines[] = {
+      TNT_STATUS_LINE(200, "OK"),
+      TNT_STATUS_LINE(201, "Created"),
+      TNT_STATUS_LINE(204, "No Content"),
+      TNT_STATUS_LINE(206, "Partial Content"),
+      TNT_STATUS_LINE(301, "Moved Permanently"),
+      TNT_STATUS_LINE(302, "Moved Temporarily"),
+      TNT_STATUS_LINE(303, "See Other"),
+      TNT_STATUS_LINE(304, "Not Modified"),
+      TNT_STATUS_LINE(307, "Temporary Redirect"),
+      TNT_STATUS_LINE(400, "Bad Request"),
+      TNT_STATUS_LINE(401, "Unauthorized"),
+      TNT_STATUS_LINE(403, "Forbidden"),
+      TNT_STATUS_LINE(404, "Not Found"),
+      TNT_STATUS_LINE(500, "Internal Server Error")
+    };
+
+#undef TNT_STATUS_LINE
+
+    // Writes the header and the body chunks with sendmsg, so that the
+    // kernel gets all data with one call without copying it into the stream
+    // buffer first. Partial writes are continued, when the socket gets
+    // writable again within the socket write timeout.
+    bool writeGathered(int fd, const std::string& header, const ocstream* body)
+    {
+#ifdef IOV_MAX
+      static const unsigned maxIov = IOV_MAX < 1024 ? IOV_MAX : 1024;
+#else
+      static const unsigned maxIov = 16;
+#endif
+      struct iovec iov[maxIov];
+      unsigned iovcount = 0;
+
+      // index of the next body chunk, which is not in iov
+      ocstream::size_type nextChunk = 0;
+
+      if (!header.empty())
+      {
+        iov[iovcount].iov_base = const_cast<char*>(header.data());
+        iov[iovcount].iov_len = header.size();
+        ++iovcount;
+      }
+
+      while (true)
+      {
+        while (body && iovcount < maxIov && nextChunk < body->chunkcount())
         {
-          static const char f[] =
-               "\x1f\x8b\x08\x00"
-               "\x00\x00\x00\x00"
-               "\x04\x03";
-          _zbody.write(f, sizeof(f) - 1);
+          iov[iovcount].iov_base = const_cast<char*>(body->chunk(nextChunk));
+          iov[iovcount].iov_len = body->chunksize(nextChunk);
+          ++nextChunk;
+          if (iov[iovcount].iov_len > 0)
+            ++iovcount;
         }
 
-        void compress(const char* d, unsigned s)
+        if (iovcount == 0)
+          return true;
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovcount;
+
+        ssize_t n = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+
+        if (n < 0)
         {
-          _deflator.write(d, s);
-          _size += s;
-          _crc = crc32(_crc, reinterpret_cast<const Bytef*>(d), s);
+          if (errno == EINTR)
+            continue;
+
+          if (errno != EAGAIN && errno != EWOULDBLOCK)
+          {
+            log_debug("sendmsg failed: " << strerror(errno));
+            return false;
+          }
+
+          struct pollfd pfd;
+          pfd.fd = fd;
+          pfd.events = POLLOUT;
+          int timeout = static_cast<int>(TntConfig::it().socketWriteTimeout.totalMSecs());
+          int p = ::poll(&pfd, 1, timeout);
+          if (p == 0)
+          {
+            log_warn("socket write timeout " << timeout << "ms exceeded");
+            return false;
+          }
+          else if (p < 0 && errno != EINTR)
+          {
+            log_debug("poll failed: " << strerror(errno));
+            return false;
+          }
+
+          continue;
         }
 
-        void finalize()
+        // skip the written buffers and move the rest to the front
+        unsigned done = 0;
+        size_t written = static_cast<size_t>(n);
+        while (done < iovcount && written >= iov[done].iov_len)
+          written -= iov[done++].iov_len;
+
+        if (done < iovcount)
         {
-          _deflator.end();
-
-          uint32_t u = _crc;
-          _zbody.put(static_cast<char>(u & 0xFF));
-          _zbody.put(static_cast<char>((u >>= 8) & 0xFF));
-          _zbody.put(static_cast<char>((u >>= 8) & 0xFF));
-          _zbody.put(static_cast<char>((u >>= 8) & 0xFF));
-
-          u = _size;
-          _zbody.put(static_cast<char>(u & 0xFF));
-          _zbody.put(static_cast<char>((u >>= 8) & 0xFF));
-          _zbody.put(static_cast<char>((u >>= 8) & 0xFF));
-          _zbody.put(static_cast<char>((u >>= 8) & 0xFF));
+          iov[done].iov_base = static_cast<char*>(iov[done].iov_base) + written;
+          iov[done].iov_len -= written;
         }
 
-        std::string::size_type uncompressedSize()
-        { return _size; }
+        for (unsigned i = done; i < iovcount; ++i)
+          iov[i - done] = iov[i];
+        iovcount -= done;
+      }
+    }
+
+    const StatusLine* findStatusLine(unsigned code)
+    {
+      static const StatusLine* begin = statusLines;
+      static const StatusLine* end = statusLines + sizeof(statusLines) / sizeof(StatusLine);
 
-        std::string::size_type zsize()
-        { return _zbody.size(); }
+      StatusLine s;
+      s.code = code;
+      const StatusLine* it = std::lower_bound(begin, end, s);
+      return it == end || it->code != code ? 0 : it;
+    }
+
+    // Selects the compression method for a reply body from the configured
+    // methods. The client quality decides; on equal quality the configured
+    // order wins. Returns 0, if the body is sent uncompressed. varies is set,
+    // when the body qualifies for compression at all, so that the reply
+    // depends on the Accept-Encoding header of the request.
+    const TntConfig::Compression* selectCompression(const Encoding& acceptEncoding,
+      std::string::size_type bodySize, bool& varies)
+    {
+      const TntConfig& config = TntConfig::it();
+
+      varies = false;
+      if (!config.enableCompression)
+        return 0;
+
+      const TntConfig::Compression* best = 0;
+      unsigned bestQuality = 0;
+      for (TntConfig::CompressionsType::const_iterator it = config.compressions.begin();
+        it != config.compressions.end(); ++it)
+      {
+        if (!Compressor::isSupported(Compressor::parseCodec(it->encoding)))
+          continue;
 
-        std::string str() const
-        { return _zbody.str(); }
+        unsigned minSize = it->minSize > 0 ? it->minSize : config.minCompressSize;
+        if (bodySize < minSize)
+          continue;
 
-        void output(std::ostream& out)
-        { _zbody.output(out); }
+        varies = true;
 
-        void clear()
+        unsigned quality = acceptEncoding.accept(it->encoding);
+        if (quality > bestQuality)
         {
-          _zbody.makeEmpty();
-          _deflator.reinitialize();
-          _crc = 0;
-          _size = 0;
+          best = &*it;
+          bestQuality = quality;
         }
-    };
+      }
+
+      return best;
+    }
+
+    // Returns true, if a Vary header value already covers Accept-Encoding.
+    bool varyCoversEncoding(const char* value)
+    {
+      static const char acceptEncoding[] = "accept-encoding";
+
+      const char* p = value;
+      while (*p)
+      {
+        while (*p == ',' || *p == ' ' || *p == '\t')
+          ++p;
+
+        const char* b = p;
+        while (*p && *p != ',' && *p != ' ' && *p != '\t')
+          ++p;
+
+        std::size_t len = p - b;
+        if ((len == 1 && *b == '*')
+          || (len == sizeof(acceptEncoding) - 1 && strncasecmp(b, acceptEncoding, len) == 0))
+          return true;
+      }
+
+      return false;
+    }
   }
 
   ////////////////////////////////////////////////////////////////////////
@@ -129,29 +343,55 @@ namespace tnt
   //////////////////////////////////////////////////////////////////////
   // HttpReply::Impl
   //
-  struct HttpReply::Impl
+  struct HttpReply::Impl : public cstreambuf::Drain
   {
+    HttpReply* owner;
     std::ostream* socket;
     ocstream outstream;
     HtmlEscOstream safeOutstream;
     UrlEscOstream urlOutstream;
     ChunkedOStream chunkedOutstream;
     Compressor compressor;
+    CompressOStream compressOutstream;
+    NullStreamBuf nullStreambuf;
+    std::ostream nullOutstream;
+    std::string headerBuffer;
 
     Encoding acceptEncoding;
 
     unsigned keepAliveCounter;
+    int socketFd;
 
     bool sendStatusLine;
     bool headRequest;
     bool clearSession;
+    bool chunked;
+
+    // set, when a chunked or direct reply is compressed while it is written
+    const TntConfig::Compression* streamCompression;
+    bool varyEncoding;
+
+    // entity tag of the buffered body, set by setBodyEtag
+    std::string etag;
+
+    // set, when the buffered body exceeded the limit and is streamed
+    std::ostream* spillStream;
+    SpillListener* spillListener;
+
+    // the content coding, when send compressed the buffered body
+    const char* sentEncoding;
 
     Impl(std::ostream& s, bool sendStatusLine);
 
+    bool governCompression(const char* contentType, int& level) const;
+    void startStreamCompression(std::streambuf* sink, const char* contentType);
+    void startSpill();
+    void drain(cstreambuf& buf);
+
+    // Unused instances are kept per thread, so getting one needs no lock.
     struct Pool
     {
       std::vector<Impl*> pool;
-      cxxtools::Mutex poolMutex;
 
       ~Pool()
       {
@@ -159,23 +399,23 @@ namespace tnt
           delete pool[n];
       }
 
-      Impl* getInstance(std::ostream& s, bool sendStatusLine);
-      void releaseInstance(Impl* inst);
-      void clear();
+      static Impl* getInstance(std::ostream& s, bool sendStatusLine);
+      static void releaseInstance(Impl* inst);
+      static void clear();
     };
 
-    static Pool pool;
+    static ThreadLocal<Pool> pool;
 
   private:
     Impl(const Impl&);
     Impl& operator=(const Impl&);
   };
 
-  HttpReply::Impl::Pool HttpReply::Impl::pool;
+  ThreadLocal<HttpReply::Impl::Pool> HttpReply::Impl::pool;
 
   HttpReply::Impl* HttpReply::Impl::Pool::getInstance(std::ostream& s, bool sendStatusLine)
   {
-    cxxtools::MutexLock lock(poolMutex);
+    std::vector<Impl*>& pool = Impl::pool.get().pool;
 
     if (pool.empty())
       return new Impl(s, sendStatusLine);
@@ -185,11 +425,20 @@ namespace tnt
 
     impl->socket = &s;
     impl->keepAliveCounter = 0;
+    impl->socketFd = -1;
     impl->sendStatusLine = sendStatusLine;
     impl->headRequest = false;
     impl->clearSession = false;
+    impl->chunked = false;
+    impl->streamCompression = 0;
+    impl->varyEncoding = false;
+    impl->etag.clear();
+    impl->spillStream = 0;
+    impl->spillListener = 0;
+    impl->sentEncoding = 0;
     impl->acceptEncoding.clear();
     impl->safeOutstream.setSink(impl->outstream.rdbuf());
+    impl->urlOutstream.setSink(impl->outstream.rdbuf());
     impl->chunkedOutstream.setSink(impl->outstream.rdbuf());
 
     return impl;
@@ -197,14 +446,17 @@ namespace tnt
 
   void HttpReply::Impl::Pool::releaseInstance(Impl* inst)
   {
-    cxxtools::MutexLock lock(poolMutex);
-    if (pool.size() < 64)
+    std::vector<Impl*>& pool = Impl::pool.get().pool;
+    if (pool.size() < TntConfig::it().maxCachedReplies)
     {
       inst->outstream.clear();
       inst->outstream.makeEmpty();
+      inst->outstream.setDrain(0, 0);
       inst->safeOutstream.clear();
       inst->urlOutstream.clear();
       inst->chunkedOutstream.clear();
+      inst->compressOutstream.clear();
+      inst->nullOutstream.clear();
       inst->compressor.clear();
       pool.push_back(inst);
     }
@@ -216,32 +468,140 @@ namespace tnt
 
   void HttpReply::Impl::Pool::clear()
   {
-    cxxtools::MutexLock lock(poolMutex);
-    for (unsigned n = 0; n < pool.size(); ++n)
-      delete pool[n];
-    pool.clear();
+    Impl::pool.reset();
   }
 
   HttpReply::Impl::Impl(std::ostream& s, bool sendStatusLine_)
-    : socket(&s),
+    : owner(0),
+      socket(&s),
       safeOutstream(outstream),
       urlOutstream(outstream),
       chunkedOutstream(s),
+      compressOutstream(compressor),
+      nullOutstream(&nullStreambuf),
       keepAliveCounter(0),
+      socketFd(-1),
       sendStatusLine(sendStatusLine_),
       headRequest(false),
-      clearSession(false)
+      clearSession(false),
+      chunked(false),
+      streamCompression(0),
+      varyEncoding(false),
+      spillStream(0),
+      spillListener(0),
+      sentEncoding(0)
     { }
 
+  // Lets the compression governor adjust the level, when adaptive
+  // compression is enabled. Returns false, if the body is to be sent
+  // uncompressed.
+  bool HttpReply::Impl::governCompression(const char* contentType, int& level) const
+  {
+    if (!TntConfig::it().adaptiveCompression)
+      return true;
+
+    CompressionGovernor::Decision decision = CompressionGovernor::decide(contentType, socketFd, level);
+    log_debug("compression decision " << CompressionGovernor::decisionName(decision));
+
+    return decision == CompressionGovernor::decisionDefault
+        || decision == CompressionGovernor::decisionReduced;
+  }
+
+  void HttpReply::Impl::startStreamCompression(std::streambuf* sink, const char* contentType)
+  {
+    // the size of a streamed body is not known in advance
+    streamCompression = selectCompression(acceptEncoding,
+      std::numeric_limits<std::string::size_type>::max(), varyEncoding);
+
+    int level = streamCompression ? streamCompression->level : -1;
+    if (streamCompression && !governCompression(contentType, level))
+      streamCompression = 0;
+
+    if (streamCompression)
+    {
+      log_debug("compress streamed reply with " << streamCompression->encoding);
+      compressOutstream.begin(sink, Compressor::parseCodec(streamCompression->encoding), level);
+    }
+  }
+
+  // Sends the headers of a reply, which outgrew the buffer limit, and
+  // streams the body from now on. A body of known length is sent as it
+  // is; otherwise it is chunked for http/1.1 clients and terminated by
+  // closing the connection for older ones. The status is not known yet,
+  // so it is 200 like with setChunkedEncoding.
+  void HttpReply::Impl::startSpill()
+  {
+    HttpReply& reply = *owner;
+
+    // the last chance to add headers like the session cookie
+    if (spillListener)
+      spillListener->onSpill(reply);
+
+    bool knownLength = reply.hasHeader(httpheader::contentLength);
+
+    chunked = !knownLength
+           && (reply.getMajorVersion() > 1
+            || (reply.getMajorVersion() == 1 && reply.getMinorVersion() >= 1));
+
+    if (chunked)
+      chunkedOutstream.setSink(*socket);
+    else
+    {
+      if (!knownLength)
+        reply.setHeader(httpheader::connection, httpheader::connectionClose);
+      else if (!reply.hasHeader(httpheader::connection))
+        reply.setKeepAliveHeader();
+
+      if (!reply.hasHeader(httpheader::contentType))
+        reply.setHeader(httpheader::contentType, TntConfig::it().defaultContentType);
+    }
+
+    if (!headRequest
+      && !reply.hasHeader(httpheader::contentEncoding)
+      && !reply.hasHeader(httpheader::contentLength))
+    {
+      startStreamCompression(chunked ? chunkedOutstream.rdbuf() : socket->rdbuf(),
+        reply.getHeader(httpheader::contentType, TntConfig::it().defaultContentType.c_str()));
+    }
+
+    spillStream = headRequest ? &nullOutstream
+                : streamCompression ? static_cast<std::ostream*>(&compressOutstream)
+                : chunked ? static_cast<std::ostream*>(&chunkedOutstream)
+                : socket;
+
+    log_info("reply exceeds " << outstream.size() << " bytes; switch to "
+      << (chunked ? "chunked encoding" : "direct mode"));
+
+    // sends the headers and the body buffered so far
+    reply.send(HTTP_OK, "OK", chunked);
+  }
+
+  void HttpReply::Impl::drain(cstreambuf& buf)
+  {
+    if (spillStream == 0)
+      startSpill();
+    else
+    {
+      for (unsigned n = 0; n < buf.chunkcount(); ++n)
+        spillStream->write(buf.chunk(n), buf.chunksize(n));
+    }
+
+    buf.makeEmpty();
+
+    // let the client see the data now
+    spillStream->flush();
+    socket->flush();
+  }
+
   HttpReply::HttpReply(std::ostream& s, bool sendStatusLine)
-    : _impl(Impl::pool.getInstance(s, sendStatusLine)),
+    : _impl(Impl::Pool::getInstance(s, sendStatusLine)),
       _currentOutstream(&_impl->outstream),
       _safeOutstream(&_impl->safeOutstream),
       _urlOutstream(&_impl->urlOutstream)
-    { }
+    { _impl->owner = this; }
 
   HttpReply::~HttpReply()
-    { Impl::pool.releaseInstance(_impl); }
+    { Impl::Pool::releaseInstance(_impl); }
 
   void HttpReply::setHeadRequest(bool sw)
     { _impl->headRequest = sw; }
@@ -261,20 +621,53 @@ namespace tnt
   }
 
   bool HttpReply::isDirectMode() const
-    { return _currentOutstream == _impl->socket; }
+  {
+    return _currentOutstream == _impl->socket
+        || ((_currentOutstream == &_impl->compressOutstream
+            || _currentOutstream == &_impl->nullOutstream
+            || _impl->spillStream) && !_impl->chunked);
+  }
+
+  void HttpReply::setBufferLimit(unsigned size, SpillListener* listener)
+  {
+    if (_currentOutstream == &_impl->outstream && _impl->spillStream == 0)
+    {
+      _impl->outstream.setDrain(size > 0 ? _impl : 0, size);
+      _impl->spillListener = listener;
+    }
+  }
 
   std::string::size_type HttpReply::getContentSize() const
     { return _impl->outstream.size(); }
 
+  std::string HttpReply::getContent() const
+    { return _impl->outstream.str(); }
+
+  bool HttpReply::getSentContent(std::string& encoding, std::string& body) const
+  {
+    if (_impl->sentEncoding == 0)
+      return false;
+
+    encoding = _impl->sentEncoding;
+    body = _impl->compressor.str();
+    return true;
+  }
+
   unsigned HttpReply::chunkedBytesWritten() const
     { return _impl->chunkedOutstream.bytesWritten(); }
 
   std::ostream& HttpReply::getDirectStream()
     { return *_impl->socket; }
 
+  bool HttpReply::isHeadRequest() const
+    { return _impl->headRequest; }
+
   void HttpReply::setKeepAliveCounter(unsigned c)
     { _impl->keepAliveCounter = c; }
 
+  void HttpReply::setSocketFd(int fd)
+    { _impl->socketFd = fd; }
+
   unsigned HttpReply::getKeepAliveCounter() const
     { return _impl->keepAliveCounter; }
 
@@ -302,156 +695,250 @@ namespace tnt
   }
 
   void HttpReply::postRunCleanup()
-    { Impl::pool.clear(); }
+    { Impl::Pool::clear(); }
 
-  void HttpReply::sendHttpStatus(std::ostream& hsocket, unsigned ret, const char* msg) const
+  void HttpReply::sendHttpStatus(std::string& buffer, unsigned ret, const char* msg) const
   {
     if (_impl->sendStatusLine)
     {
-      if (msg == 0)
-        msg = HttpReturn::httpMessage(ret);
-
-      log_debug("HTTP/" << getMajorVersion() << '.' << getMinorVersion()
-             << ' ' << ret << ' ' << msg);
-      hsocket << "HTTP/" << getMajorVersion() << '.' << getMinorVersion()
-              << ' ' << ret << ' ' << msg << "\r\n";
+      HeaderWriter w(buffer);
+
+      // callers usually pass the standard text, so the precomputed line
+      // is used, when the text matches
+      const StatusLine* statusLine;
+      if (getMajorVersion() == 1 && getMinorVersion() == 1
+        && (statusLine = findStatusLine(ret)) != 0
+        && (msg == 0 || statusLine->hasText(msg)))
+      {
+        w.str(statusLine->line, statusLine->len);
+      }
+      else
+      {
+        if (msg == 0)
+          msg = HttpReturn::httpMessage(ret);
+
+        w.literal("HTTP/")
+         .number(getMajorVersion())
+         .literal(".")
+         .number(getMinorVersion())
+         .literal(" ")
+         .number(ret)
+         .literal(" ")
+         .str(msg)
+         .literal("\r\n");
+      }
     }
   }
 
-  void HttpReply::sendHttpHeaders(std::ostream& hsocket) const
+  void HttpReply::sendHttpHeaders(std::string& buffer, bool varyEncoding) const
   {
+    HeaderWriter w(buffer);
+
     if (!hasHeader(httpheader::date))
     {
-      char current[50];
-      htdateCurrent(current);
-      log_debug(httpheader::date << ' ' << current);
-      hsocket << httpheader::date << ' ' << current << "\r\n";
+      char current[30];
+      htdateCached(current);
+      w.literal("Date: ").str(current).literal("\r\n");
     }
 
     if (!TntConfig::it().server.empty()
       && !hasHeader(httpheader::server))
     {
-      log_debug(httpheader::server << ' ' << TntConfig::it().server);
-      hsocket << httpheader::server << ' ' << TntConfig::it().server << "\r\n";
+      w.literal("Server: ").str(TntConfig::it().server).literal("\r\n");
     }
 
     for (header_type::const_iterator it = header.begin(); it != header.end(); ++it)
     {
-      log_debug(it->first << ' ' << it->second);
-      hsocket << it->first << ' ' << it->second << "\r\n";
+      if (varyEncoding && strcasecmp(it->first, httpheader::vary) == 0
+        && !varyCoversEncoding(it->second))
+      {
+        w.str(it->first).literal(" ").str(it->second).literal(", Accept-Encoding\r\n");
+      }
+      else
+        w.header(it->first, it->second);
     }
 
+    if (varyEncoding && !hasHeader(httpheader::vary))
+      w.literal("Vary: Accept-Encoding\r\n");
+
     if (hasCookies())
     {
-      log_debug(httpheader::setCookie << ' ' << httpcookies);
-
+      std::ostringstream cookies;
       for (Cookies::cookies_type::const_iterator it = httpcookies._data.begin();
         it != httpcookies._data.end(); ++it)
       {
-        hsocket << httpheader::setCookie << ' ';
-        it->second.write(hsocket, it->first);
-        hsocket << "\r\n";
+        cookies << httpheader::setCookie << ' ';
+        it->second.write(cookies, it->first);
+        cookies << "\r\n";
       }
-    }
 
+      w.str(cookies.str());
+    }
   }
 
   void HttpReply::send(unsigned ret, const char* msg, bool ready) const
   {
-    std::ostream hsocket(_impl->socket->rdbuf());
-    hsocket.imbue(std::locale::classic());
+    // status line and headers are collected in one buffer
+    std::string& buffer = _impl->headerBuffer;
+    buffer.clear();
+
+    // choose the compression method before the headers are written, since
+    // the Vary header depends on it
+    const TntConfig::Compression* compression = 0;
+    bool varyEncoding = _impl->varyEncoding;
+    bool bodyless = isBodyless(ret);
+    if (ready
+      && !bodyless
+      && !isChunkedEncoding()
+      && !hasHeader(httpheader::contentEncoding)
+      && !hasHeader(httpheader::contentLength))
+    {
+      compression = selectCompression(_impl->acceptEncoding, _impl->outstream.size(), varyEncoding);
+    }
 
-    // send header
-    sendHttpStatus(hsocket, ret, msg);
-    sendHttpHeaders(hsocket);
+    int level = compression ? compression->level : -1;
+    if (compression
+      && !_impl->governCompression(getHeader(httpheader::contentType, TntConfig::it().defaultContentType.c_str()), level))
+    {
+      compression = 0;
+    }
+
+    sendHttpStatus(buffer, ret, msg);
+    sendHttpHeaders(buffer, varyEncoding);
+
+    HeaderWriter w(buffer);
+
+    if (!_impl->etag.empty())
+    {
+      // every content coding of the body is a representation of its own
+      const std::string& etag = _impl->etag;
+      if (compression && !bodyless)
+        w.literal("ETag: ").str(etag.data(), etag.size() - 1)
+         .literal("-").str(compression->encoding).literal("\"\r\n");
+      else
+        w.literal("ETag: ").str(etag).literal("\r\n");
+    }
+
+    if (_impl->streamCompression)
+      w.literal("Content-Encoding: ").str(_impl->streamCompression->encoding).literal("\r\n");
 
     bool compressed = false;
 
     if (ready)
     {
-      if (_currentOutstream == &_impl->chunkedOutstream)
+      if (isChunkedEncoding())
       {
-        log_debug(httpheader::transferEncoding << " chunked");
-        hsocket << httpheader::transferEncoding << " chunked\r\n";
+        w.literal("Transfer-Encoding: chunked\r\n");
       }
       else
       {
         ocstream& body = _impl->outstream;
 
-        if (body.size() >= TntConfig::it().minCompressSize
-            && !hasHeader(httpheader::contentEncoding)
-            && _impl->acceptEncoding.accept("gzip")
-            && !hasHeader(httpheader::contentLength))
+        if (bodyless)
+        {
+          log_debug("reply " << ret << " has no body");
+        }
+        else if (compression && _impl->headRequest)
         {
-          _impl->compressor.init();
+          // The client gets the headers of a compressed reply. Compressing
+          // the body just to know its size is not worth it, so the length
+          // is omitted.
+          w.literal("Content-Encoding: ").str(compression->encoding).literal("\r\n");
+        }
+        else if (compression)
+        {
+          Compressor::Codec codec = Compressor::parseCodec(compression->encoding);
+          _impl->compressor.init(codec, level);
           for (unsigned n = 0; n < body.chunkcount(); ++n)
             _impl->compressor.compress(body.chunk(n), body.chunksize(n));
           _impl->compressor.finalize();
 
           compressed = true;
-          log_debug(httpheader::contentEncoding << " gzip");
-          log_debug(httpheader::contentLength << ' ' << _impl->compressor.zsize());
+          _impl->sentEncoding = Compressor::encodingName(codec);
 
-          hsocket << httpheader::contentLength << ' ' << _impl->compressor.zsize() << "\r\n"
-                  << httpheader::contentEncoding << " gzip\r\n";
-          log_info("gzip body " << body.size() << " bytes to " << _impl->compressor.zsize() << " bytes");
+          w.literal("Content-Length: ").number(_impl->compressor.zsize()).literal("\r\n")
+           .literal("Content-Encoding: ").str(Compressor::encodingName(codec)).literal("\r\n");
+          log_info(Compressor::encodingName(codec) << " body " << body.size() << " bytes to " << _impl->compressor.zsize() << " bytes");
         }
-        else
+        else if (!hasHeader(httpheader::contentLength)
+          && (!_impl->headRequest || body.size() > 0))
         {
-          if (!hasHeader(httpheader::contentLength))
-          {
-            log_debug(httpheader::contentLength << ' ' << body.size());
-            hsocket << httpheader::contentLength << ' ' << body.size() << "\r\n";
-          }
+          // A component may skip generating the body of a HEAD request;
+          // then the length is unknown and omitted.
+          w.literal("Content-Length: ").number(body.size()).literal("\r\n");
         }
       }
 
-      if (!hasHeader(httpheader::contentType))
-      {
-        log_debug(httpheader::contentType << ' ' << TntConfig::it().defaultContentType);
-        hsocket << httpheader::contentType << ' ' << TntConfig::it().defaultContentType << "\r\n";
-      }
+      if (!bodyless && !hasHeader(httpheader::contentType))
+        w.literal("Content-Type: ").str(TntConfig::it().defaultContentType).literal("\r\n");
 
       if (!hasHeader(httpheader::connection))
       {
         if (TntConfig::it().keepAliveTimeout > 0 && getKeepAliveCounter() > 0)
         {
-          log_debug(httpheader::keepAlive << " timeout=" << TntConfig::it().keepAliveTimeout << ", max=" << getKeepAliveCounter());
-          log_debug(httpheader::connection << ' ' << httpheader::connectionKeepAlive);
-          hsocket << httpheader::keepAlive << " timeout=" << TntConfig::it().keepAliveTimeout << ", max=" << getKeepAliveCounter() << "\r\n"
-                  << httpheader::connection << ' ' << httpheader::connectionKeepAlive << "\r\n";
+          w.literal("Keep-Alive: timeout=")
+           .number(static_cast<unsigned long>(TntConfig::it().keepAliveTimeout.totalSeconds()))
+           .literal(", max=")
+           .number(getKeepAliveCounter())
+           .literal("\r\nConnection: Keep-Alive\r\n");
         }
         else
-        {
-          log_debug(httpheader::connection << ' ' << httpheader::connectionClose);
-          hsocket << httpheader::connection << ' ' << httpheader::connectionClose << "\r\n";
-        }
+          w.literal("Connection: close\r\n");
       }
     }
 
-    hsocket << "\r\n";
+    w.literal("\r\n");
+
+    log_debug("reply header:\n" << buffer);
+
+    std::ostream& socket = *_impl->socket;
+
+    if (_impl->socketFd >= 0 && ready && !isChunkedEncoding())
+    {
+      // Data already buffered in the stream must be sent first; then the
+      // header and body are passed to the kernel directly.
+      socket.flush();
+
+      const ocstream* body = _impl->headRequest || bodyless ? 0
+                           : compressed ? &_impl->compressor.zbody()
+                           : &_impl->outstream;
+
+      log_debug("send header and " << (body ? body->size() : 0) << " bytes body with gathered write");
+      if (!writeGathered(_impl->socketFd, buffer, body))
+        socket.setstate(std::ios::badbit);
+
+      return;
+    }
+
+    socket.write(buffer.data(), buffer.size());
 
     // send body
     if (_impl->headRequest)
       log_debug("HEAD-request - empty body");
+    else if (bodyless)
+      log_debug("no body with status " << ret);
     else
     {
       ocstream& body = _impl->outstream;
-      if (_currentOutstream == &_impl->chunkedOutstream)
+      if (_impl->streamCompression)
+      {
+        body.output(_impl->compressOutstream);
+      }
+      else if (isChunkedEncoding())
       {
-        body.output(*_currentOutstream);
+        body.output(_impl->chunkedOutstream);
       }
       else
       {
         if (compressed)
         {
           log_debug("send " << _impl->compressor.zsize() << " bytes body (compressed)");
-          _impl->compressor.output(hsocket);
+          _impl->compressor.output(socket);
         }
         else
         {
           log_debug("send " << body.size() << " bytes body");
-          body.output(hsocket);
+          body.output(socket);
         }
       }
     }
@@ -460,8 +947,27 @@ namespace tnt
   void HttpReply::sendReply(unsigned ret, const char* msg)
   {
     log_debug("sendReply");
-    if (_currentOutstream == &_impl->chunkedOutstream)
+    if (_impl->spillStream)
     {
+      log_debug("send rest of streamed body");
+      ocstream& body = _impl->outstream;
+      body.setDrain(0, 0);
+      body.output(*_impl->spillStream);
+      body.makeEmpty();
+    }
+
+    if (isChunkedEncoding() && _impl->headRequest)
+    {
+      log_debug("HEAD-request - no chunks sent");
+    }
+    else if (isChunkedEncoding())
+    {
+      if (_impl->streamCompression)
+      {
+        log_debug("finish compression");
+        _impl->compressOutstream.finish();
+      }
+
       log_debug("finish chunked encoding");
       _impl->chunkedOutstream.finish();
       *_impl->socket << "\r\n";
@@ -471,6 +977,11 @@ namespace tnt
       log_debug("send data");
       send(ret, msg, true);
     }
+    else if (_impl->streamCompression)
+    {
+      log_debug("finish compression");
+      _impl->compressOutstream.finish();
+    }
 
     _impl->socket->flush();
   }
@@ -484,6 +995,34 @@ namespace tnt
     setHeader(httpheader::contentMD5, md5.getHexDigest());
   }
 
+  void HttpReply::setBodyEtag()
+  {
+    XxHash64 hash;
+    const tnt::ocstream& c = _impl->outstream;
+    for (unsigned n = 0; n < c.chunkcount(); ++n)
+      hash.update(c.chunk(n), c.chunksize(n));
+    _impl->etag = makeEtag(hash.digest());
+    log_debug("body etag " << _impl->etag);
+  }
+
+  void HttpReply::setBodyEtag(const std::string& etag)
+  {
+    _impl->etag = etag;
+  }
+
+  const std::string& HttpReply::getBodyEtag() const
+  {
+    return _impl->etag;
+  }
+
+  bool HttpReply::bodyEtagMatches(const char* ifNoneMatch)
+  {
+    // The client may hold a compressed representation, which has the
+    // content coding appended. A 304 reply must repeat that tag.
+    return !_impl->etag.empty()
+        && etagMatches(ifNoneMatch, _impl->etag, true, &_impl->etag);
+  }
+
   unsigned HttpReply::redirect(const std::string& newLocation, Redirect type)
   {
     setHeader(httpheader::location, newLocation);
@@ -558,8 +1097,32 @@ namespace tnt
     if (!isDirectMode())
     {
       log_debug("enable direct mode");
+
+      if (!_impl->headRequest
+        && !hasHeader(httpheader::contentEncoding)
+        && !hasHeader(httpheader::contentLength))
+      {
+        _impl->startStreamCompression(_impl->socket->rdbuf(),
+          getHeader(httpheader::contentType, TntConfig::it().defaultContentType.c_str()));
+      }
+
       send(ret, msg, false);
-      setDirectModeNoFlush();
+
+      if (_impl->headRequest)
+      {
+        log_debug("HEAD-request - discard body");
+        _currentOutstream = &_impl->nullOutstream;
+        _impl->safeOutstream.setSink(&_impl->nullStreambuf);
+        _impl->urlOutstream.setSink(&_impl->nullStreambuf);
+      }
+      else if (_impl->streamCompression)
+      {
+        _currentOutstream = &_impl->compressOutstream;
+        _impl->safeOutstream.setSink(_impl->compressOutstream.rdbuf());
+        _impl->urlOutstream.setSink(_impl->compressOutstream.rdbuf());
+      }
+      else
+        setDirectModeNoFlush();
     }
   }
 
@@ -573,16 +1136,32 @@ namespace tnt
   void HttpReply::setChunkedEncoding(unsigned ret, const char* msg)
   {
     log_debug("set chunked encoding");
-    _currentOutstream = &_impl->chunkedOutstream;
+    _impl->chunked = true;
     _impl->chunkedOutstream.setSink(*_impl->socket);
-    _impl->safeOutstream.setSink(_impl->chunkedOutstream.rdbuf());
-    _impl->urlOutstream.setSink(_impl->chunkedOutstream.rdbuf());
+
+    if (!_impl->headRequest
+      && !hasHeader(httpheader::contentEncoding)
+      && !hasHeader(httpheader::contentLength))
+    {
+      _impl->startStreamCompression(_impl->chunkedOutstream.rdbuf(),
+        getHeader(httpheader::contentType, TntConfig::it().defaultContentType.c_str()));
+    }
+
+    if (_impl->headRequest)
+      _currentOutstream = &_impl->nullOutstream;
+    else if (_impl->streamCompression)
+      _currentOutstream = &_impl->compressOutstream;
+    else
+      _currentOutstream = &_impl->chunkedOutstream;
+
+    _impl->safeOutstream.setSink(_currentOutstream->rdbuf());
+    _impl->urlOutstream.setSink(_currentOutstream->rdbuf());
     send(ret, msg, true);
   }
 
   bool HttpReply::isChunkedEncoding() const
   {
-    return _currentOutstream == &_impl->chunkedOutstream;
+    return _impl->chunked;
   }
 
   void HttpReply::setCookie(const std::string& name, const Cookie& value)
@@ -249,10 +249,9 @@ namespace tnt
 
   void HttpRequest::doPostParse()
   {
-    if (hasHeader("Expect:"))
-      throw HttpError(HTTP_EXPECTATION_FAILED, "expectation failed", "Expect not supported by this server");
-
-    _getparam.parse_url(getQueryString());
+    // parameters are parsed lazily on first access
+    _getparam.parseLazy(_queryString);
+    _qparam.parseLazy(_queryString);
 
     if (isMethodPOST())
     {
@@ -274,18 +273,18 @@ namespace tnt
               _postparam.add(it->getName(), multipartBody);
             }
           }
+
+          _qparam.add(_postparam);
         }
         else if (_ct.getType() == "application"
               && _ct.getSubtype() == "x-www-form-urlencoded")
         {
-          _postparam.parse_url(getBody());
+          _postparam.parseLazy(_body);
+          _qparam.parseLazy(_body);
         }
       }
     }
 
-    _qparam.add(_getparam);
-    _qparam.add(_postparam);
-
     _serial = cxxtools::atomicIncrement(_nextSerial);
   }
 
@@ -358,8 +357,9 @@ namespace tnt
     if (!_localeInit)
     {
       static const std::string LANG = "LANG";
-      _lang = _qparam[LANG];
-      const_cast<QueryParams&>(_qparam).locale(getCacheLocale(_qparam[LANG]));
+      // avoid parsing the parameters just for looking up the language
+      _lang = _qparam.mightHave(LANG) ? _qparam[LANG] : std::string();
+      const_cast<QueryParams&>(_qparam).locale(getCacheLocale(_lang));
       if (_lang.empty())
         _lang = _qparam.locale().name();
       _localeInit = true;
@@ -29,23 +29,113 @@
 
 #include "tnt/job.h"
 #include "tnt/tntconfig.h"
+#include <cxxtools/log.h>
+#include <vector>
+
+log_define("tntnet.job")
 
 namespace tnt
 {
+  namespace
+  {
+    // Idle connections do not need a request and parser, so they are kept
+    // here for reuse by the next connection, which receives a request.
+    class RequestStatePool
+    {
+        std::vector<Job::RequestState*> _pool;
+        cxxtools::Mutex _mutex;
+
+      public:
+        ~RequestStatePool()
+        {
+          for (unsigned n = 0; n < _pool.size(); ++n)
+            delete _pool[n];
+        }
+
+        Job::RequestState* getInstance(Tntnet& app);
+        void releaseInstance(Job::RequestState* state);
+    };
+
+    Job::RequestState* RequestStatePool::getInstance(Tntnet& app)
+    {
+      cxxtools::MutexLock lock(_mutex);
+
+      while (!_pool.empty())
+      {
+        Job::RequestState* state = _pool.back();
+        _pool.pop_back();
+        if (&state->request.getApplication() == &app)
+          return state;
+        delete state;
+      }
+
+      return 0;
+    }
+
+    void RequestStatePool::releaseInstance(Job::RequestState* state)
+    {
+      state->parser.reset();
+
+      cxxtools::MutexLock lock(_mutex);
+
+      // At most one state per worker thread is in use at a time, so
+      // keeping more does not help.
+      if (_pool.size() < TntConfig::it().maxThreads)
+        _pool.push_back(state);
+      else
+        delete state;
+    }
+
+    RequestStatePool requestStatePool;
+  }
+
   Job::Job(Tntnet& app, const SocketIf* socketIf)
     : _keepAliveCounter(TntConfig::it().keepAliveMax),
-      _request(app, socketIf),
-      _parser(_request),
-      _lastAccessTime(0)
+      _application(app),
+      _socketIf(socketIf),
+      _requestState(0),
+      _lastAccessTime(0),
+      _resumed(false)
     { }
 
   Job::~Job()
-    { }
+  {
+    if (_requestState)
+      requestStatePool.releaseInstance(_requestState);
+  }
+
+  void Job::acquireRequestState()
+  {
+    _requestState = requestStatePool.getInstance(_application);
+    if (_requestState)
+    {
+      log_debug("reuse request state for fd " << getFd());
+      _requestState->request._socketIf = _socketIf;
+    }
+    else
+      _requestState = new RequestState(_application, _socketIf);
+  }
+
+  void Job::releaseRequestState()
+  {
+    // a partially received request must be kept until it is complete
+    if (_requestState && _requestState->parser.getCurrentRequestSize() == 0)
+    {
+      requestStatePool.releaseInstance(_requestState);
+      _requestState = 0;
+    }
+  }
 
   void Job::clear()
   {
-    _parser.reset();
-    _request.clear();
+    _resumed = false;
+    _sharedReply = StoredReplyPtr();
+
+    if (_requestState)
+    {
+      _requestState->parser.reset();
+      _requestState->request.clear();
+    }
   }
 
   cxxtools::Milliseconds Job::msecToTimeout(time_t currentTime) const
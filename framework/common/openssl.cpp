@@ -33,12 +33,21 @@
 #include <openssl/err.h>
 #include <cxxtools/log.h>
 #include <cxxtools/ioerror.h>
+#include <cxxtools/systemerror.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
 #include <sys/poll.h>
 #include <pthread.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
 #include <tnt/tntconfig.h>
 
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(OPENSSL_NO_KTLS)
+#  define TNT_SSL_SENDFILE
+#endif
+
 log_define("tntnet.ssl")
 
 namespace tnt
@@ -146,6 +155,12 @@ namespace tnt
     if (sslProtocols.find("-TLSv1_2") != std::string::npos)
         SSL_CTX_set_options(_ctx.getPointer(), SSL_OP_NO_TLSv1_2);
 
+#ifdef SSL_OP_ENABLE_KTLS
+    // let the kernel encrypt when it supports the negotiated cipher
+    if (TntConfig::it().sslKtls)
+        SSL_CTX_set_options(_ctx.getPointer(), SSL_OP_ENABLE_KTLS);
+#endif
+
     // restrict cipher list
     if (!TntConfig::it().sslCipherList.empty())
     {
@@ -366,6 +381,77 @@ namespace tnt
     return bufsize;
   }
 
+  void OpensslStream::sslSendFile(int fd, off_t offset, off_t count) const
+  {
+#ifdef TNT_SSL_SENDFILE
+    if (BIO_get_ktls_send(SSL_get_wbio(_ssl)))
+    {
+      // kernel TLS is active for sending, so the file is encrypted by the
+      // kernel without copying it to user space
+      while (count > 0)
+      {
+        size_t s = static_cast<size_t>(std::min(count, static_cast<off_t>(0x7ffff000)));
+        ossl_ssize_t n;
+        int err = SSL_ERROR_NONE;
+        int errnum = 0;
+
+        {
+          cxxtools::MutexLock lock(mutex);
+          log_debug("SSL_sendfile(" << _ssl << ", " << fd << ", " << offset << ", " << s << ')');
+          n = SSL_sendfile(_ssl, fd, offset, s, 0);
+          errnum = errno;
+          if (n < 0)
+            err = SSL_get_error(_ssl, n);
+          log_debug("SSL_sendfile returns " << n);
+        }
+
+        if (n > 0)
+        {
+          offset += n;
+          count -= n;
+        }
+        else if (n == 0)
+        {
+          throw std::runtime_error("file truncated while sending");
+        }
+        else if (err == SSL_ERROR_WANT_WRITE
+              || (err == SSL_ERROR_SYSCALL && errnum == EAGAIN))
+        {
+          log_debug("poll with POLLOUT");
+          poll(POLLOUT);
+        }
+        else
+        {
+          log_debug("error " << err << " occured in SSL_sendfile");
+          throwOpensslException("error from SSL_sendfile", err);
+        }
+      }
+
+      return;
+    }
+#endif
+
+    // pass large blocks to SSL_write, so that full sized tls records are
+    // written without copying the data through the stream buffer
+    std::vector<char> buffer(65536);
+    while (count > 0)
+    {
+      ssize_t n = ::pread(fd, &buffer[0], std::min(count, static_cast<off_t>(buffer.size())), offset);
+      if (n < 0 && errno == EINTR)
+        continue;
+
+      if (n < 0)
+        throw cxxtools::SystemError("pread");
+
+      if (n == 0)
+        throw std::runtime_error("file truncated while sending");
+
+      sslWrite(&buffer[0], n);
+      offset += n;
+      count -= n;
+    }
+  }
+
   void OpensslStream::shutdown() const
   {
     cxxtools::MutexLock lock(mutex);
@@ -29,9 +29,455 @@
 
 #include <tnt/query_params.h>
 #include <sstream>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <clocale>
+#include <errno.h>
+#include <stdint.h>
+
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
 
 namespace tnt
 {
+  namespace
+  {
+    inline int valueOfHexDigit(char ch)
+    {
+      return ch >= '0' && ch <= '9' ? ch - '0'
+           : ch >= 'a' && ch <= 'f' ? ch - 'a' + 10
+           : ch >= 'A' && ch <= 'F' ? ch - 'A' + 10
+           : -1;
+    }
+
+    // Tests 8 bytes at once, whether one of them is a '%' or a '+'.
+    inline bool hasEscapeChar(uint64_t v)
+    {
+      static const uint64_t ones = 0x0101010101010101ULL;
+      static const uint64_t highs = 0x8080808080808080ULL;
+      uint64_t p = v ^ (ones * '%');
+      uint64_t q = v ^ (ones * '+');
+      return ((((p - ones) & ~p) | ((q - ones) & ~q)) & highs) != 0;
+    }
+
+    // Returns a pointer to the first '%' or '+' in [b, e) or e if there is none.
+    inline const char* findEscapeChar(const char* b, const char* e)
+    {
+      while (e - b >= 8)
+      {
+        uint64_t v;
+        std::memcpy(&v, b, sizeof(v));
+        if (hasEscapeChar(v))
+          break;
+        b += 8;
+      }
+
+      while (b < e && *b != '%' && *b != '+')
+        ++b;
+
+      return b;
+    }
+  }
+
+  void urlUnescape(const char* b, const char* e, std::string& out)
+  {
+    out.reserve(out.size() + (e - b));
+
+    while (b < e)
+    {
+      // copy clean runs in one go
+      const char* p = findEscapeChar(b, e);
+      out.append(b, p);
+      if (p == e)
+        break;
+
+      int h, l;
+      if (*p == '+')
+      {
+        out += ' ';
+        b = p + 1;
+      }
+      else if (e - p >= 3
+        && (h = valueOfHexDigit(p[1])) >= 0
+        && (l = valueOfHexDigit(p[2])) >= 0)
+      {
+        out += static_cast<char>((h << 4) | l);
+        b = p + 3;
+      }
+      else
+      {
+        // invalid escape sequence - keep it as is
+        out += '%';
+        b = p + 1;
+      }
+    }
+  }
+
+  std::string urlUnescape(const std::string& s)
+  {
+    std::string ret;
+    urlUnescape(s.data(), s.data() + s.size(), ret);
+    return ret;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // number conversion
+  //
+  namespace
+  {
+    inline bool isSpace(char ch)
+    {
+      return ch == ' ' || ch == '\t' || ch == '\n'
+          || ch == '\r' || ch == '\f' || ch == '\v';
+    }
+
+    // Reads sign and magnitude of an integer like std::istream does and
+    // checks, that the magnitude does not exceed `limit`.
+    bool parseInteger(const std::string& s, bool& negative, unsigned long long& magnitude,
+      unsigned long long limitPositive, unsigned long long limitNegative)
+    {
+      const char* p = s.data();
+      const char* e = p + s.size();
+
+      while (p < e && isSpace(*p))
+        ++p;
+
+      negative = false;
+      if (p < e && (*p == '+' || *p == '-'))
+        negative = (*p++ == '-');
+
+      unsigned long long limit = negative ? limitNegative : limitPositive;
+      const char* digits = p;
+      magnitude = 0;
+      for (; p < e && *p >= '0' && *p <= '9'; ++p)
+      {
+        unsigned d = *p - '0';
+        if (magnitude > (limit - d) / 10)
+          return false;
+        magnitude = magnitude * 10 + d;
+      }
+
+      return p > digits;
+    }
+
+    template <typename Type>
+    qhelper::ConvertResult convertSigned(const std::string& s, Type& value)
+    {
+      bool negative;
+      unsigned long long magnitude;
+      unsigned long long max = static_cast<unsigned long long>(std::numeric_limits<Type>::max());
+      if (!parseInteger(s, negative, magnitude, max, max + 1))
+        return qhelper::convertFailed;
+
+      value = negative && magnitude > 0 ? static_cast<Type>(-static_cast<Type>(magnitude - 1) - 1)
+                       : static_cast<Type>(magnitude);
+      return qhelper::convertOk;
+    }
+
+    template <typename Type>
+    qhelper::ConvertResult convertUnsigned(const std::string& s, Type& value)
+    {
+      // like std::istream a negative value is accepted and negated in the
+      // unsigned type
+      bool negative;
+      unsigned long long magnitude;
+      unsigned long long max = std::numeric_limits<Type>::max();
+      if (!parseInteger(s, negative, magnitude, max, max))
+        return qhelper::convertFailed;
+
+      value = static_cast<Type>(magnitude);
+      if (negative)
+        value = static_cast<Type>(-value);
+      return qhelper::convertOk;
+    }
+
+#if !defined(__cpp_lib_to_chars)
+    inline float strtoFloat(const char* s, char** end, float*)
+      { return std::strtof(s, end); }
+
+    inline double strtoFloat(const char* s, char** end, double*)
+      { return std::strtod(s, end); }
+
+    inline long double strtoFloat(const char* s, char** end, long double*)
+      { return std::strtold(s, end); }
+#endif
+
+    template <typename Type>
+    qhelper::ConvertResult convertFloat(const std::string& s, Type& value, const std::locale& loc)
+    {
+      if (std::use_facet<std::numpunct<char> >(loc).decimal_point() != '.')
+        return qhelper::convertUnsupported;
+
+      const char* p = s.data();
+      const char* e = p + s.size();
+
+      while (p < e && isSpace(*p))
+        ++p;
+
+      bool negative = false;
+      if (p < e && (*p == '+' || *p == '-'))
+        negative = (*p++ == '-');
+
+      // streams do not read "inf", "nan" or hex floats
+      if (p == e || !((*p >= '0' && *p <= '9') || *p == '.'))
+        return qhelper::convertFailed;
+
+#if defined(__cpp_lib_to_chars)
+      std::from_chars_result r = std::from_chars(p, e, value, std::chars_format::general);
+      if (r.ec == std::errc::result_out_of_range)
+        return qhelper::convertUnsupported;  // let the stream decide about over- and underflow
+      else if (r.ec != std::errc())
+        return qhelper::convertFailed;
+
+      // streams fail on an exponent without digits
+      if (r.ptr < e && (*r.ptr == 'e' || *r.ptr == 'E'))
+        return qhelper::convertFailed;
+#else
+      // Copy the decimal number to a terminated buffer for strtod. strtod
+      // uses the decimal point of the C locale, so the '.' is replaced by it.
+      char buffer[64];
+      char* b = buffer;
+      char* be = buffer + sizeof(buffer) - 1;
+      char decimalPoint = *std::localeconv()->decimal_point;
+      bool digits = false;
+
+      for (; p < e && *p >= '0' && *p <= '9' && b < be; ++p, digits = true)
+        *b++ = *p;
+
+      if (p < e && *p == '.' && b < be)
+      {
+        *b++ = decimalPoint;
+        for (++p; p < e && *p >= '0' && *p <= '9' && b < be; ++p, digits = true)
+          *b++ = *p;
+      }
+
+      if (!digits)
+        return qhelper::convertFailed;
+
+      if (p < e && (*p == 'e' || *p == 'E'))
+      {
+        const char* x = p + 1;
+        if (x < e && (*x == '+' || *x == '-'))
+          ++x;
+
+        // streams fail on an exponent without digits
+        if (x == e || *x < '0' || *x > '9')
+          return qhelper::convertFailed;
+
+        for (; p < x && b < be; ++p)
+          *b++ = *p;
+        for (; p < e && *p >= '0' && *p <= '9' && b < be; ++p)
+          *b++ = *p;
+      }
+
+      if (b == be)
+        return qhelper::convertUnsupported;  // too long for the buffer
+
+      *b = '\0';
+
+      errno = 0;
+      char* end;
+      value = strtoFloat(buffer, &end, static_cast<Type*>(0));
+      if (errno == ERANGE)
+        return qhelper::convertUnsupported;  // let the stream decide about over- and underflow
+      else if (end != b)
+        return qhelper::convertFailed;
+#endif
+
+      if (negative)
+        value = -value;
+
+      return qhelper::convertOk;
+    }
+
+    template <typename Type>
+    bool formatSigned(Type value, std::string& s)
+    {
+      char buffer[24];
+      char* p = buffer + sizeof(buffer);
+
+      // convert to the unsigned magnitude without overflowing on the minimum
+      unsigned long long u = value < 0
+          ? static_cast<unsigned long long>(-(value + 1)) + 1
+          : static_cast<unsigned long long>(value);
+
+      do
+      {
+        *--p = static_cast<char>('0' + u % 10);
+        u /= 10;
+      } while (u > 0);
+
+      if (value < 0)
+        *--p = '-';
+
+      s.assign(p, buffer + sizeof(buffer));
+      return true;
+    }
+
+    template <typename Type>
+    bool formatUnsigned(Type value, std::string& s)
+    {
+      char buffer[24];
+      char* p = buffer + sizeof(buffer);
+
+      do
+      {
+        *--p = static_cast<char>('0' + value % 10);
+        value /= 10;
+      } while (value > 0);
+
+      s.assign(p, buffer + sizeof(buffer));
+      return true;
+    }
+  }
+
+  namespace qhelper
+  {
+    ConvertResult convertParam(const std::string& s, short& value, const std::locale&)
+      { return convertSigned(s, value); }
+
+    ConvertResult convertParam(const std::string& s, unsigned short& value, const std::locale&)
+      { return convertUnsigned(s, value); }
+
+    ConvertResult convertParam(const std::string& s, int& value, const std::locale&)
+      { return convertSigned(s, value); }
+
+    ConvertResult convertParam(const std::string& s, unsigned& value, const std::locale&)
+      { return convertUnsigned(s, value); }
+
+    ConvertResult convertParam(const std::string& s, long& value, const std::locale&)
+      { return convertSigned(s, value); }
+
+    ConvertResult convertParam(const std::string& s, unsigned long& value, const std::locale&)
+      { return convertUnsigned(s, value); }
+
+    ConvertResult convertParam(const std::string& s, long long& value, const std::locale&)
+      { return convertSigned(s, value); }
+
+    ConvertResult convertParam(const std::string& s, unsigned long long& value, const std::locale&)
+      { return convertUnsigned(s, value); }
+
+    ConvertResult convertParam(const std::string& s, float& value, const std::locale& loc)
+      { return convertFloat(s, value, loc); }
+
+    ConvertResult convertParam(const std::string& s, double& value, const std::locale& loc)
+      { return convertFloat(s, value, loc); }
+
+    ConvertResult convertParam(const std::string& s, long double& value, const std::locale& loc)
+      { return convertFloat(s, value, loc); }
+
+    bool formatParam(short value, std::string& s)
+      { return formatSigned(value, s); }
+
+    bool formatParam(unsigned short value, std::string& s)
+      { return formatUnsigned(value, s); }
+
+    bool formatParam(int value, std::string& s)
+      { return formatSigned(value, s); }
+
+    bool formatParam(unsigned value, std::string& s)
+      { return formatUnsigned(value, s); }
+
+    bool formatParam(long value, std::string& s)
+      { return formatSigned(value, s); }
+
+    bool formatParam(unsigned long value, std::string& s)
+      { return formatUnsigned(value, s); }
+
+    bool formatParam(long long value, std::string& s)
+      { return formatSigned(value, s); }
+
+    bool formatParam(unsigned long long value, std::string& s)
+      { return formatUnsigned(value, s); }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // QueryParams
+  //
+  void QueryParams::parseUrlencoded(const std::string& s)
+  {
+    const char* b = s.data();
+    const char* e = b + s.size();
+
+    std::string name;
+    std::string value;
+
+    while (b < e)
+    {
+      const char* a = static_cast<const char*>(std::memchr(b, '&', e - b));
+      if (a == 0)
+        a = e;
+
+      if (a > b)
+      {
+        const char* eq = static_cast<const char*>(std::memchr(b, '=', a - b));
+        value.clear();
+        if (eq)
+        {
+          name.clear();
+          urlUnescape(b, eq, name);
+          urlUnescape(eq + 1, a, value);
+          cxxtools::QueryParams::add(name, value);
+        }
+        else
+        {
+          // parameter without name
+          urlUnescape(b, a, value);
+          cxxtools::QueryParams::add(value);
+        }
+      }
+
+      b = a + 1;
+    }
+  }
+
+  void QueryParams::doParsePending()
+  {
+    // reset the pending list first, so that accessors called while
+    // parsing do not recurse
+    const std::string* pending[maxPending];
+    for (unsigned n = 0; n < maxPending; ++n)
+    {
+      pending[n] = _pending[n];
+      _pending[n] = 0;
+    }
+
+    for (unsigned n = 0; n < maxPending && pending[n]; ++n)
+      parseUrlencoded(*pending[n]);
+  }
+
+  bool QueryParams::mightHave(const std::string& name) const
+  {
+    if (isParsed())
+      return cxxtools::QueryParams::has(name);
+
+    if (cxxtools::QueryParams::has(name))
+      return true;
+
+    for (std::string::size_type n = 0; n < name.size(); ++n)
+    {
+      char ch = name[n];
+      if (!(ch >= 'a' && ch <= 'z')
+        && !(ch >= 'A' && ch <= 'Z')
+        && !(ch >= '0' && ch <= '9')
+        && ch != '_' && ch != '-' && ch != '.')
+      {
+        // the name may be escaped in the raw string
+        return has(name);
+      }
+    }
+
+    for (unsigned n = 0; n < maxPending && _pending[n]; ++n)
+    {
+      if (_pending[n]->find(name) != std::string::npos)
+        return has(name);
+    }
+
+    return false;
+  }
+
   void ConversionError::doThrow(const std::string& argname, unsigned argnum, const char* typeto, const std::string& value)
   {
     std::ostringstream msg;
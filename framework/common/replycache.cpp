@@ -0,0 +1,402 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#include <tnt/replycache.h>
+#include <tnt/httprequest.h>
+#include <tnt/httpreply.h>
+#include <tnt/httpheader.h>
+#include <tnt/http.h>
+#include <cxxtools/log.h>
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <string.h>
+#include <time.h>
+
+log_define("tntnet.replycache")
+
+namespace tnt
+{
+  namespace
+  {
+    long long currentMillis()
+    {
+      struct timespec ts;
+      ::clock_gettime(CLOCK_MONOTONIC, &ts);
+      return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+    }
+
+    // headers, which are generated for every reply
+    bool isHopHeader(const char* key)
+    {
+      return strcasecmp(key, httpheader::connection) == 0
+          || strcasecmp(key, httpheader::keepAlive) == 0
+          || strcasecmp(key, httpheader::date) == 0
+          || strcasecmp(key, httpheader::setCookie) == 0;
+    }
+
+    bool containsToken(std::string value, const char* token)
+    {
+      std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+      return value.find(token) != std::string::npos;
+    }
+
+    // Without maxRequestTime the renewing request has no time limit. The
+    // waiting requests give up after a fixed time then and call the
+    // component themselves.
+    cxxtools::Timespan renewWaitLimit()
+    {
+      if (TntConfig::it().maxRequestTime > cxxtools::Seconds(0))
+        return TntConfig::it().maxRequestTime;
+      return cxxtools::Seconds(60);
+    }
+  }
+
+  void ReplyCache::purge(long long now)
+  {
+    for (SlotsType::iterator it = _slots.begin(); it != _slots.end(); )
+    {
+      if (!it->second.renewing
+        && it->second.uncacheableUntil <= now
+        && (it->second.entry.getPointer() == 0 || it->second.entry->expires <= now))
+        _slots.erase(it++);
+      else
+        ++it;
+    }
+
+    if (_slots.size() >= _config.maxEntries)
+    {
+      log_warn("clear reply cache");
+      for (SlotsType::iterator it = _slots.begin(); it != _slots.end(); )
+      {
+        if (it->second.renewing)
+          ++it;
+        else
+          _slots.erase(it++);
+      }
+    }
+  }
+
+  std::string ReplyCache::makeKey(const HttpRequest& request) const
+  {
+    std::string key = request.getHost();
+    key += '\n';
+    key += request.getUrl();
+
+    if (_config.params.empty())
+    {
+      key += '?';
+      key += request.getQueryString();
+    }
+    else
+    {
+      for (unsigned n = 0; n < _config.params.size(); ++n)
+      {
+        const std::string& name = _config.params[n];
+        key += '\n';
+        if (request.getQueryParams().has(name))
+          key += request.getQueryParams().param(name);
+        else
+          key += '\0';
+      }
+    }
+
+    for (unsigned n = 0; n < _config.headers.size(); ++n)
+    {
+      std::string name = _config.headers[n];
+      if (name.empty() || name[name.size() - 1] != ':')
+        name += ':';
+      key += '\n';
+      key += request.getHeader(name.c_str());
+    }
+
+    for (unsigned n = 0; n < _config.cookies.size(); ++n)
+    {
+      key += '\n';
+      key += request.getCookie(_config.cookies[n]).getValue();
+    }
+
+    return key;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // StoredReply
+  //
+  bool StoredReply::isShareable(const HttpReply& reply, unsigned httpReturn)
+  {
+    // A body encoded by the component depends on the Accept-Encoding
+    // header of the request, which is not part of the key.
+    if (httpReturn != HTTP_OK
+      || reply.isChunkedEncoding()
+      || reply.isDirectMode()
+      || reply.hasCookies()
+      || reply.isClearSession()
+      || reply.hasHeader(httpheader::contentEncoding))
+      return false;
+
+    const char* cacheControl = reply.getHeader(httpheader::cacheControl, 0);
+    return cacheControl == 0
+        || !(containsToken(cacheControl, "private")
+          || containsToken(cacheControl, "no-store")
+          || containsToken(cacheControl, "no-cache"));
+  }
+
+  StoredReply* StoredReply::create(const HttpReply& reply, unsigned httpReturn)
+  {
+    if (!isShareable(reply, httpReturn))
+    {
+      log_debug("reply is not shareable");
+      return 0;
+    }
+
+    StoredReply* stored = new StoredReply();
+    try
+    {
+      stored->_httpReturn = httpReturn;
+      for (HttpReply::header_type::const_iterator it = reply.header_begin(); it != reply.header_end(); ++it)
+      {
+        if (!isHopHeader(it->first))
+          stored->_headers.push_back(HeadersType::value_type(it->first, it->second));
+      }
+      stored->_body = reply.getContent();
+      stored->_etag = reply.getBodyEtag();
+      stored->created = currentMillis();
+      stored->expires = stored->created;
+    }
+    catch (...)
+    {
+      delete stored;
+      throw;
+    }
+
+    return stored;
+  }
+
+  unsigned StoredReply::fill(const HttpRequest& request, HttpReply& reply) const
+  {
+    for (HeadersType::const_iterator it = _headers.begin(); it != _headers.end(); ++it)
+      reply.setHeader(it->first, it->second);
+
+    // send the compressed variant, which the client rates best
+    {
+      cxxtools::MutexLock lock(_variantsMutex);
+
+      VariantsType::const_iterator best = _variants.end();
+      unsigned bestQ = 0;
+      for (VariantsType::const_iterator it = _variants.begin(); it != _variants.end(); ++it)
+      {
+        unsigned q = request.getEncoding().accept(it->first);
+        if (q > bestQ)
+        {
+          best = it;
+          bestQ = q;
+        }
+      }
+
+      if (best != _variants.end())
+      {
+        log_debug("send stored " << best->first << " body");
+        reply.setHeader(httpheader::contentEncoding, best->first);
+
+        const char* vary = reply.getHeader(httpheader::vary, 0);
+        if (vary == 0)
+          reply.setHeader(httpheader::vary, "Accept-Encoding");
+        else if (!containsToken(vary, "accept-encoding"))
+          reply.setHeader(httpheader::vary, std::string(vary) + ", Accept-Encoding");
+        if (!_etag.empty())
+          reply.setBodyEtag(_etag.substr(0, _etag.size() - 1) + '-' + best->first + '"');
+        reply.out().write(best->second.data(), best->second.size());
+        return _httpReturn;
+      }
+    }
+
+    if (!_etag.empty())
+      reply.setBodyEtag(_etag);
+    reply.out().write(_body.data(), _body.size());
+    return _httpReturn;
+  }
+
+  void StoredReply::addVariant(const HttpReply& reply)
+  {
+    std::string encoding;
+    std::string compressed;
+    if (!reply.getSentContent(encoding, compressed))
+      return;
+
+    cxxtools::MutexLock lock(_variantsMutex);
+    if (_variants.find(encoding) == _variants.end())
+    {
+      log_debug("store " << encoding << " variant");
+      _variants[encoding] = compressed;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // ReplyCache::Lookup
+  //
+  ReplyCache::Lookup::Lookup(ReplyCache* cache, const HttpRequest& request)
+    : _cache(cache),
+      _renewing(false)
+  {
+    if (_cache == 0)
+      return;
+
+    // replies to authorized requests are not shared
+    if ((!request.isMethodGET() && !request.isMethodHEAD())
+      || request.hasHeader(httpheader::authorization))
+    {
+      _cache = 0;
+      return;
+    }
+
+    _key = _cache->makeKey(request);
+
+    cxxtools::MutexLock lock(_cache->_mutex);
+
+    while (true)
+    {
+      long long now = currentMillis();
+
+      SlotsType::iterator it = _cache->_slots.find(_key);
+      if (it == _cache->_slots.end())
+      {
+        if (_cache->_slots.size() >= _cache->_config.maxEntries)
+          _cache->purge(now);
+        it = _cache->_slots.insert(SlotsType::value_type(_key, Slot())).first;
+      }
+
+      Slot& slot = it->second;
+
+      if (slot.uncacheableUntil > now)
+      {
+        log_debug("reply is not cacheable; bypass cache");
+        _cache = 0;
+        return;
+      }
+
+      if (slot.entry.getPointer() != 0 && slot.entry->expires > now)
+      {
+        log_debug("cache hit");
+        _entry = slot.entry;
+        return;
+      }
+
+      if (!slot.renewing)
+      {
+        // the body of a HEAD request may be incomplete, so it is not stored
+        if (request.isMethodGET())
+        {
+          log_debug("cache miss; renew reply");
+          slot.renewing = true;
+          _renewing = true;
+        }
+        return;
+      }
+
+      if (slot.entry.getPointer() != 0 && _cache->_config.serveStale)
+      {
+        log_debug("reply is renewed by another request; serve expired reply");
+        _entry = slot.entry;
+        return;
+      }
+
+      log_debug("wait for reply renewed by another request");
+      if (!_cache->_renewed.wait(lock, renewWaitLimit()))
+      {
+        log_warn("timeout waiting for cached reply");
+        return;
+      }
+    }
+  }
+
+  void ReplyCache::Lookup::release()
+  {
+    if (!_renewing)
+      return;
+
+    cxxtools::MutexLock lock(_cache->_mutex);
+    SlotsType::iterator it = _cache->_slots.find(_key);
+    if (it != _cache->_slots.end())
+      it->second.renewing = false;
+    _renewing = false;
+    _cache->_renewed.broadcast();
+  }
+
+  unsigned ReplyCache::Lookup::fill(const HttpRequest& request, HttpReply& reply) const
+  {
+    std::ostringstream age;
+    age << (currentMillis() - _entry->created) / 1000;
+    reply.setHeader(httpheader::age, age.str());
+
+    return _entry->fill(request, reply);
+  }
+
+  void ReplyCache::Lookup::store(const HttpReply& reply, unsigned httpReturn)
+  {
+    if (!_renewing)
+      return;
+
+    long long maxAge = static_cast<long long>(_cache->_config.maxAge.totalMSecs());
+
+    StoredReplyPtr entry = StoredReply::create(reply, httpReturn);
+    if (entry.getPointer() == 0)
+    {
+      // the waiting and the following requests would only get replies of
+      // their own, so they should not wait for each other
+      cxxtools::MutexLock lock(_cache->_mutex);
+      Slot& slot = _cache->_slots[_key];
+      slot.uncacheableUntil = currentMillis() + maxAge;
+      slot.renewing = false;
+      _renewing = false;
+      _cache->_renewed.broadcast();
+      return;
+    }
+
+    entry->expires = entry->created + maxAge;
+
+    log_debug("cache reply");
+
+    cxxtools::MutexLock lock(_cache->_mutex);
+    Slot& slot = _cache->_slots[_key];
+    slot.entry = entry;
+    slot.renewing = false;
+    slot.uncacheableUntil = 0;
+    _renewing = false;
+    _cache->_renewed.broadcast();
+
+    _entry = entry;
+  }
+
+  void ReplyCache::Lookup::storeVariant(const HttpReply& reply)
+  {
+    if (found())
+      _entry->addVariant(reply);
+  }
+}
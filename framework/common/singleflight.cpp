@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#include <tnt/singleflight.h>
+#include <tnt/maptarget.h>
+#include <tnt/httprequest.h>
+#include <tnt/httpreply.h>
+#include <tnt/httpheader.h>
+#include <cxxtools/log.h>
+
+log_define("tntnet.singleflight")
+
+namespace tnt
+{
+  bool SingleFlight::isCoalescable(const HttpRequest& request)
+  {
+    return request.isMethodGET()
+        && !request.hasHeader(httpheader::authorization);
+  }
+
+  std::string SingleFlight::makeKey(const Maptarget& ci, const HttpRequest& request)
+  {
+    // Cookies and language select the content of most pages, so requests
+    // differing in them are never coalesced.
+    std::string key = ci.toString();
+    key += '\n';
+    key += request.getHost();
+    key += '\n';
+    key += request.getUrl();
+    key += '?';
+    key += request.getQueryString();
+    key += '\n';
+    key += request.getHeader(httpheader::cookie);
+    key += '\n';
+    key += request.getHeader(httpheader::acceptLanguage);
+    return key;
+  }
+
+  bool SingleFlight::start(const std::string& key)
+  {
+    cxxtools::MutexLock lock(_mutex);
+    return _flights.insert(FlightsType::value_type(key, FollowersType())).second;
+  }
+
+  bool SingleFlight::park(const std::string& key, Jobqueue::JobPtr& job)
+  {
+    cxxtools::MutexLock lock(_mutex);
+
+    FlightsType::iterator it = _flights.find(key);
+    if (it == _flights.end())
+      return false;
+
+    it->second.push_back(job);
+    log_debug(it->second.size() << " requests wait for flight");
+    return true;
+  }
+
+  void SingleFlight::land(const std::string& key, const StoredReplyPtr& reply, Jobqueue& queue)
+  {
+    FollowersType followers;
+
+    {
+      cxxtools::MutexLock lock(_mutex);
+      FlightsType::iterator it = _flights.find(key);
+      if (it == _flights.end())
+        return;
+      followers.swap(it->second);
+      _flights.erase(it);
+    }
+
+    log_debug_if(!followers.empty(), "resume " << followers.size() << " requests "
+      << (reply.getPointer() != 0 ? "with shared reply" : "without reply"));
+
+    for (FollowersType::iterator it = followers.begin(); it != followers.end(); ++it)
+    {
+      (*it)->resume(reply);
+      queue.put(*it, true);
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // SingleFlight::Leader
+  //
+  bool SingleFlight::Leader::lead(SingleFlight& flight, const std::string& key, Jobqueue& queue)
+  {
+    if (!flight.start(key))
+      return false;
+
+    _flight = &flight;
+    _key = key;
+    _queue = &queue;
+    return true;
+  }
+
+  void SingleFlight::Leader::capture(const HttpReply& reply, unsigned httpReturn)
+  {
+    if (_flight)
+      _reply = StoredReply::create(reply, httpReturn);
+  }
+
+  void SingleFlight::Leader::land(const HttpReply& reply)
+  {
+    if (_reply.getPointer() != 0)
+      _reply->addVariant(reply);
+    land();
+  }
+
+  void SingleFlight::Leader::land()
+  {
+    if (_flight == 0)
+      return;
+
+    _flight->land(_key, _reply, *_queue);
+    _flight = 0;
+    _reply = StoredReplyPtr();
+  }
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <tnt/staticmanifest.h>
+#include <tnt/util.h>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+namespace tnt
+{
+  namespace
+  {
+    // splits a line at tabs
+    void split(const std::string& line, std::vector<std::string>& fields)
+    {
+      fields.clear();
+      std::string::size_type b = 0;
+      while (true)
+      {
+        std::string::size_type e = line.find('\t', b);
+        fields.push_back(line.substr(b, e == std::string::npos ? e : e - b));
+        if (e == std::string::npos)
+          break;
+        b = e + 1;
+      }
+    }
+
+    bool parseDecimal(const std::string& s, uint64_t& value)
+    {
+      if (s.empty() || s.size() > 20)
+        return false;
+
+      value = 0;
+      for (std::string::size_type n = 0; n < s.size(); ++n)
+      {
+        if (s[n] < '0' || s[n] > '9')
+          return false;
+        uint64_t v = value * 10 + (s[n] - '0');
+        if (v / 10 != value)
+          return false;
+        value = v;
+      }
+
+      return true;
+    }
+
+    bool parseHex(const std::string& s, uint64_t& value)
+    {
+      if (s.empty() || s.size() > 16)
+        return false;
+
+      value = 0;
+      for (std::string::size_type n = 0; n < s.size(); ++n)
+      {
+        char ch = s[n];
+        unsigned d;
+        if (ch >= '0' && ch <= '9')
+          d = ch - '0';
+        else if (ch >= 'a' && ch <= 'f')
+          d = ch - 'a' + 10;
+        else if (ch >= 'A' && ch <= 'F')
+          d = ch - 'A' + 10;
+        else
+          return false;
+        value = (value << 4) | d;
+      }
+
+      return true;
+    }
+
+    bool parseMtime(const std::string& s, int64_t& value)
+    {
+      uint64_t v;
+      if (!s.empty() && s[0] == '-')
+      {
+        if (!parseDecimal(s.substr(1), v) || v > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+          return false;
+        value = -static_cast<int64_t>(v);
+      }
+      else
+      {
+        if (!parseDecimal(s, v) || v > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+          return false;
+        value = static_cast<int64_t>(v);
+      }
+
+      return true;
+    }
+
+    void printHex(std::ostream& out, uint64_t value)
+    {
+      static const char hex[] = "0123456789abcdef";
+      char buffer[16];
+      for (int n = 15; n >= 0; --n)
+      {
+        buffer[n] = hex[value & 0xf];
+        value >>= 4;
+      }
+      out.write(buffer, sizeof(buffer));
+    }
+
+    void syntaxError(unsigned lineNo, const char* what)
+    {
+      std::ostringstream msg;
+      msg << "syntax error in manifest line " << lineNo << ": " << what;
+      throwRuntimeError(msg.str());
+    }
+  }
+
+  const char* StaticManifest::fileName()
+  {
+    return ".tntnet-precompress";
+  }
+
+  const char* StaticManifest::suffix(const std::string& encoding)
+  {
+    if (encoding == "gzip")
+      return ".gz";
+    else if (encoding == "br")
+      return ".br";
+    else if (encoding == "zstd")
+      return ".zst";
+    else
+      return 0;
+  }
+
+  void StaticManifest::read(std::istream& in)
+  {
+    std::string line;
+    std::vector<std::string> fields;
+    unsigned lineNo = 0;
+
+    while (std::getline(in, line))
+    {
+      ++lineNo;
+
+      if (!line.empty() && line[line.size() - 1] == '\r')
+        line.erase(line.size() - 1);
+
+      if (line.empty() || line[0] == '#')
+        continue;
+
+      split(line, fields);
+      if (fields.size() < 4 || fields[0].empty())
+        syntaxError(lineNo, "path, size, mtime and hash expected");
+
+      Entry entry;
+      if (!parseDecimal(fields[1], entry.size))
+        syntaxError(lineNo, "invalid size");
+      if (!parseMtime(fields[2], entry.mtime))
+        syntaxError(lineNo, "invalid mtime");
+      if (!parseHex(fields[3], entry.hash))
+        syntaxError(lineNo, "invalid hash");
+
+      for (std::vector<std::string>::size_type n = 4; n < fields.size(); ++n)
+      {
+        const std::string& f = fields[n];
+        std::string::size_type c1 = f.find(':');
+        std::string::size_type c2 = c1 == std::string::npos ? c1 : f.find(':', c1 + 1);
+        if (c1 == 0 || c2 == std::string::npos)
+          syntaxError(lineNo, "encoding:size:hash expected");
+
+        Variant variant;
+        variant.encoding = f.substr(0, c1);
+        if (!parseDecimal(f.substr(c1 + 1, c2 - c1 - 1), variant.size)
+          || !parseHex(f.substr(c2 + 1), variant.hash))
+          syntaxError(lineNo, "invalid size or hash of compressed file");
+
+        entry.variants.push_back(variant);
+      }
+
+      _entries[fields[0]] = entry;
+    }
+  }
+
+  void StaticManifest::write(std::ostream& out) const
+  {
+    out << "# tntnet-precompress manifest\n"
+           "# path\tsize\tmtime\thash\tencoding:size:hash...\n";
+
+    for (EntriesType::const_iterator it = _entries.begin(); it != _entries.end(); ++it)
+    {
+      const Entry& entry = it->second;
+      out << it->first << '\t' << entry.size << '\t' << entry.mtime << '\t';
+      printHex(out, entry.hash);
+
+      for (VariantsType::const_iterator v = entry.variants.begin(); v != entry.variants.end(); ++v)
+      {
+        out << '\t' << v->encoding << ':' << v->size << ':';
+        printHex(out, v->hash);
+      }
+
+      out << '\n';
+    }
+  }
+
+  const StaticManifest::Entry* StaticManifest::find(const std::string& path) const
+  {
+    EntriesType::const_iterator it = _entries.find(path);
+    return it == _entries.end() ? 0 : &it->second;
+  }
+}
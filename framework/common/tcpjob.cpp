@@ -75,7 +75,7 @@ namespace tnt
     if (TntnetImpl::shouldStop())
       p = this;
     else
-      p = new Tcpjob(getRequest().getApplication(), _listener, _queue);
+      p = new Tcpjob(getApplication(), _listener, _queue);
 
     _queue.put(p);
   }
@@ -158,7 +158,7 @@ namespace tnt
     if (TntnetImpl::shouldStop())
       p = this;
     else
-      p = new SslTcpjob(getRequest().getApplication(), _listener, _queue);
+      p = new SslTcpjob(getApplication(), _listener, _queue);
 
     _queue.put(p);
   }
@@ -258,5 +258,11 @@ namespace tnt
 
     return j;
   }
+
+  unsigned Jobqueue::size() const
+  {
+    cxxtools::MutexLock lock(_mutex);
+    return _jobs.size();
+  }
 }
 
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#ifndef TNT_BYTERANGE_H
+#define TNT_BYTERANGE_H
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <time.h>
+
+/// @cond internal
+
+namespace tnt
+{
+  /// A range of bytes of a file.
+  struct ByteRange
+  {
+    off_t offset;
+    off_t count;
+
+    ByteRange(off_t offset_, off_t count_)
+      : offset(offset_),
+        count(count_)
+      { }
+
+    bool operator< (const ByteRange& other) const
+      { return offset < other.offset; }
+
+    bool operator== (const ByteRange& other) const
+      { return offset == other.offset && count == other.count; }
+  };
+
+  typedef std::vector<ByteRange> ByteRangesType;
+
+  /// More ranges in a Range header are considered abusive; the header is
+  /// ignored then.
+  const unsigned maxByteRanges = 64;
+
+  /** Parses the value of a Range header (RFC 7233) like "bytes=0-99,
+      200-, -500" for a file of the given size. Returns false, when the
+      header is malformed, uses an unknown unit or has more than
+      maxByteRanges ranges; then it is ignored and `ranges` is left
+      empty. Otherwise the satisfiable ranges are returned in `ranges`,
+      which is empty, when none of them is satisfiable (416). Overlapping
+      ranges are coalesced.
+   */
+  bool parseByteRanges(const char* header, off_t size, ByteRangesType& ranges);
+
+  /// Checks the If-Range header against the current validators of a file.
+  bool ifRangeMatches(const char* ifRange, const std::string& etag, time_t mtime);
+
+  /// Returns the value of the Content-Range header for a range.
+  std::string contentRange(const ByteRange& range, off_t size);
+}
+
+/// @endcond internal
+
+#endif // TNT_BYTERANGE_H
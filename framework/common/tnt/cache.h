@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#ifndef TNT_CACHE_H
+#define TNT_CACHE_H
+
+#include <cxxtools/refcounted.h>
+#include <cxxtools/smartptr.h>
+#include <cxxtools/timespan.h>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace tnt
+{
+  /// Counters of a cache
+  struct CacheStatistics
+  {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long insertions;
+    unsigned long evictions;    ///< entries removed to make room
+    unsigned long expirations;  ///< entries removed since their time to live passed
+    std::size_t entries;
+    std::size_t bytes;
+
+    CacheStatistics()
+      : hits(0),
+        misses(0),
+        insertions(0),
+        evictions(0),
+        expirations(0),
+        entries(0),
+        bytes(0)
+      { }
+  };
+
+  /// Estimates the memory used by a cached value.
+  template <typename T>
+  std::size_t cacheSize(const T&)
+    { return sizeof(T); }
+
+  inline std::size_t cacheSize(const std::string& s)
+    { return sizeof(std::string) + s.capacity(); }
+
+  /** Untyped part of a cache
+
+      The entries are distributed by the hash of the key to shards, which
+      are locked independently. Each shard holds a part of the byte limit
+      and evicts its least recently used entries when full.
+   */
+  class CacheBase
+  {
+      class Shard;
+
+      std::vector<Shard*> _shards;
+      std::size_t _maxBytes;
+
+      Shard& shard(const std::string& key) const;
+
+      // non-copyable
+      CacheBase(const CacheBase&);
+      CacheBase& operator=(const CacheBase&);
+
+    protected:
+      class Value : public cxxtools::AtomicRefCounted
+      {
+        public:
+          virtual ~Value() { }
+      };
+
+      typedef cxxtools::SmartPtr<Value> ValuePtr;
+
+      CacheBase(std::size_t maxBytes, unsigned shards);
+      ~CacheBase();
+
+      /// Returns the value or a null pointer, when the key is missing or expired.
+      ValuePtr getValue(const std::string& key);
+      void putValue(const std::string& key, ValuePtr value, std::size_t size, cxxtools::Milliseconds ttl);
+
+    public:
+      /// Removes a key; returns false, when it was not found.
+      bool erase(const std::string& key);
+
+      /// Removes all keys starting with `prefix` and returns their number.
+      unsigned erasePrefix(const std::string& prefix);
+
+      void clear();
+
+      CacheStatistics getStatistics() const;
+
+      std::size_t maxBytes() const
+        { return _maxBytes; }
+  };
+
+  /** Concurrent cache for values of type T
+
+      Components share a cache by defining it as a static object, e.g. in a
+      `<%shared>` section of an ecpp component:
+
+          static tnt::Cache<std::string> userNames(1024 * 1024);
+
+          std::string name = userNames.getOrCompute(userId, LoadUserName(userId),
+                                                    cxxtools::Minutes(5));
+
+      Values are copied into and out of the cache. The size of a value is
+      estimated with `cacheSize`, which may be overloaded for own types, or
+      passed explicitly when storing it.
+   */
+  template <typename T>
+  class Cache : public CacheBase
+  {
+      class TypedValue : public Value
+      {
+        public:
+          explicit TypedValue(const T& v)
+            : value(v)
+            { }
+          T value;
+      };
+
+    public:
+      /// Creates a cache, which keeps up to `maxBytes` bytes of values.
+      explicit Cache(std::size_t maxBytes, unsigned shards = 16)
+        : CacheBase(maxBytes, shards)
+        { }
+
+      /// Copies the value to `value`; returns false, when it is not found or expired.
+      bool get(const std::string& key, T& value)
+      {
+        ValuePtr v = getValue(key);
+        if (v.getPointer() == 0)
+          return false;
+        value = static_cast<TypedValue*>(v.getPointer())->value;
+        return true;
+      }
+
+      /** Stores a value.
+
+          A `ttl` of 0 keeps the value until it is evicted. A `size` of 0 is
+          replaced by the result of `cacheSize(value)`.
+       */
+      void put(const std::string& key, const T& value,
+               cxxtools::Milliseconds ttl = cxxtools::Milliseconds(0),
+               std::size_t size = 0)
+      {
+        putValue(key, new TypedValue(value), size > 0 ? size : cacheSize(value), ttl);
+      }
+
+      /** Returns the cached value or stores and returns `compute()`.
+
+          The functor is called without holding a lock, so concurrent
+          requests for a missing key may compute it more than once.
+       */
+      template <typename Compute>
+      T getOrCompute(const std::string& key, Compute compute,
+                     cxxtools::Milliseconds ttl = cxxtools::Milliseconds(0))
+      {
+        T value;
+        if (!get(key, value))
+        {
+          value = compute();
+          put(key, value, ttl);
+        }
+        return value;
+      }
+  };
+}
+
+#endif // TNT_CACHE_H
@@ -38,6 +38,7 @@
 #include <string>
 #include <utility>
 #include <dlfcn.h>
+#include <time.h>
 
 /// @cond internal
 
@@ -111,6 +112,7 @@ namespace tnt
 
       operator const void* () const { return _handlePtr.getPointer(); }
 
+      /// Creates the component or returns 0, if the library has no factory for it.
       Component* create(const std::string& compname, Comploader& cl, const Urlmapper& rootmapper);
       LangLib::PtrType getLangLib(const std::string& lang);
 
@@ -124,15 +126,32 @@ namespace tnt
   {
       typedef std::map<std::string, ComponentLibrary> librarymap_type;
       typedef std::map<Compident, Component*> componentmap_type;
+      // a component, which was not found
+      struct NotFound
+      {
+        bool libraryMissing;
+        time_t expires;     // the component is looked up again then
+      };
+
+      typedef std::map<Compident, NotFound> notfoundmap_type;
 
       // loaded libraries
       static librarymap_type& getLibrarymap();
 
       // map soname/compname to compinstance
       componentmap_type componentmap;
+      // components, which were not found
+      notfoundmap_type notfoundmap;
       static ComponentLibrary::factoryMapType* currentFactoryMap;
 
+      Component* lookupComp(const Compident& compident, const Urlmapper& rootmapper, bool& libraryMissing);
+
+      // lookup library; load if needed; returns 0 if the library is not found
+      ComponentLibrary* findLib(const std::string& libname);
+
     public:
+      /// Returns the component or 0, if the library or the component is not found.
+      Component* findComp(const Compident& compident, const Urlmapper& rootmapper = Urlmapper());
       Component& fetchComp(const Compident& compident, const Urlmapper& rootmapper = Urlmapper());
       Component* createComp(const Compident& compident, const Urlmapper& rootmapper);
       const char* getLangData(const Compident& compident, const std::string& lang);
@@ -51,12 +51,36 @@ namespace tnt
       virtual unsigned operator() (HttpRequest&, HttpReply&, tnt::QueryParams&);
       virtual unsigned endTag (HttpRequest&, HttpReply&, tnt::QueryParams&);
 
+      /** Decide whether the body of a request is wanted
+
+          When a client sends `Expect: 100-continue`, this method is called
+          after the header is parsed but before the body is read. Return
+          HTTP_CONTINUE to receive the body, DECLINED to pass the decision to
+          the next mapping or any other http return code to reject the request
+          with that status before the client uploads anything.
+
+          Query parameters and sessions are not available at that point.
+          The default accepts the body.
+       */
+      virtual unsigned expectContinue(HttpRequest&, HttpReply&);
+
       /** Get the value of the given attribute, or `def` if the attribute is unset
 
           Attributes are set using the ECPP tag `<%attr>`.
        */
       virtual std::string getAttribute(const std::string& name, const std::string& def = std::string()) const;
 
+      /** Tell whether the query parameters may stay unparsed until accessed
+
+          Query parameters are parsed on first access through
+          tnt::QueryParams. The accessors of its base class
+          cxxtools::QueryParams don't parse them, so tntnet parses them
+          before calling the component. A component, which reads its
+          parameters only through tnt::QueryParams or not at all, returns
+          true to skip that. The default is false.
+       */
+      virtual bool lazyQueryParams() const;
+
       /// Component call - sometimes more readable than operator()
       unsigned call(HttpRequest& request, HttpReply& reply, tnt::QueryParams& qparam)
         { return operator() (request, reply, qparam); }
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef TNT_COMPRESSIONGOVERNOR_H
+#define TNT_COMPRESSIONGOVERNOR_H
+
+#include <cstddef>
+
+namespace tnt
+{
+  /** Adapts the compression of replies to the server load and the client link.
+
+      When the configuration setting adaptiveCompression is enabled, each
+      reply the client accepts compressed for is passed to the governor.
+      It skips compression for content types, which are compressed already,
+      when the CPU usage of the process reaches compressionCpuLimit and for
+      clients with a round trip time below compressionLanRtt, when set.
+      Under moderate load or when requests wait in the queue it switches to
+      the fastest compression level.
+
+      The decisions are counted and can be read with getStatistics().
+   */
+  class CompressionGovernor
+  {
+    public:
+      enum Decision
+      {
+        decisionDefault,          ///< compressed with the configured level
+        decisionReduced,          ///< compressed with the fastest level
+        decisionSkipCpu,          ///< not compressed due to cpu load
+        decisionSkipLink,         ///< not compressed due to a fast client link
+        decisionSkipContentType,  ///< not compressed due to the content type
+        decisionCount
+      };
+
+      struct Statistics
+      {
+        /// Number of replies per decision
+        unsigned long decisions[decisionCount];
+        /// Cpu usage of the process in per mille of all cpus in the last sample
+        unsigned cpuLoad;
+        /// Number of jobs waiting in the queue in the last sample
+        unsigned queueDepth;
+      };
+
+      /// Returns a short name of the decision for logging.
+      static const char* decisionName(Decision decision);
+
+      /// Returns the decision counters and the current load values.
+      static Statistics getStatistics();
+
+      /// @cond internal
+
+      /// Measures the cpu usage since the last call; called periodically by
+      /// the timer thread.
+      static void sample(unsigned queueDepth);
+
+      /// Decides about compressing a reply body. level is the configured
+      /// compression level and may be changed to the fastest level.
+      /// socketFd is the client socket or -1, if unknown.
+      static Decision decide(const char* contentType, int socketFd, int& level);
+
+      /// Returns true for content types, which are compressed already.
+      static bool isCompressedContentType(const char* contentType);
+
+      /// @endcond
+  };
+}
+
+#endif // TNT_COMPRESSIONGOVERNOR_H
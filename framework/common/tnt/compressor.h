@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef TNT_COMPRESSOR_H
+#define TNT_COMPRESSOR_H
+
+#include <tnt/cstream.h>
+#include <tnt/deflatestream.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+/// @cond internal
+
+namespace tnt
+{
+  /// Compresses a http body with one of the supported content codings.
+  /// The compressed data is collected in a chunked buffer.
+  class Compressor
+  {
+    public:
+      enum Codec
+      {
+        codecNone,
+        codecGzip,
+        codecBrotli,
+        codecZstd
+      };
+
+      /// Returns true, if support for the codec is compiled in.
+      static bool isSupported(Codec codec);
+      /// Returns the codec for a content coding name like "gzip" or "br".
+      static Codec parseCodec(const std::string& encoding);
+      /// Returns the content coding name of the codec.
+      static const char* encodingName(Codec codec);
+
+    private:
+      struct BrotliState;
+      struct ZstdState;
+
+      ocstream _zbody;
+      DeflateStream _deflator;
+      BrotliState* _brotli;
+      ZstdState* _zstd;
+      Codec _codec;
+      uLong _crc;
+      unsigned _size;
+
+      // disable copy and assignment
+      Compressor(const Compressor&);
+      Compressor& operator=(const Compressor&);
+
+    public:
+      Compressor();
+      ~Compressor();
+
+      /// Starts a new compressed body; a negative level selects the default
+      /// level of the codec.
+      void init(Codec codec = codecGzip, int level = -1);
+      void compress(const char* d, unsigned s);
+      /// Makes all data compressed so far decodable by the receiver without
+      /// ending the stream (like Z_SYNC_FLUSH in zlib).
+      void flush();
+      void finalize();
+
+      Codec codec() const
+      { return _codec; }
+
+      std::string::size_type uncompressedSize() const
+      { return _size; }
+
+      std::string::size_type zsize() const
+      { return _zbody.size(); }
+
+      std::string str() const
+      { return _zbody.str(); }
+
+      const ocstream& zbody() const
+      { return _zbody; }
+
+      void output(std::ostream& out) const
+      { _zbody.output(out); }
+
+      /// Drops the compressed data collected so far; the compression
+      /// stream itself continues.
+      void discardOutput()
+      { _zbody.makeEmpty(); }
+
+      void clear();
+  };
+
+  /// Streambuf, which compresses the written data incrementally and passes
+  /// it to a sink. Synchronizing the stream flushes the compressor, so that
+  /// the client can decode everything written so far.
+  class CompressStreamBuf : public std::streambuf
+  {
+      Compressor& _compressor;
+      std::streambuf* _sink;
+      std::vector<char> _buffer;
+
+      bool compressBuffer();
+      bool passOutput();
+
+    public:
+      explicit CompressStreamBuf(Compressor& compressor)
+        : _compressor(compressor),
+          _sink(0)
+        { }
+
+      /// see std::streambuf
+      int_type overflow(int_type ch);
+      /// see std::streambuf
+      int_type underflow();
+      /// see std::streambuf
+      int sync();
+
+      /// Starts a new compressed stream to the sink.
+      void begin(std::streambuf* sink, Compressor::Codec codec, int level);
+      /// Ends the compressed stream. Returns false, when the sink failed.
+      bool finish();
+      void clear();
+
+      bool isActive() const
+      { return _sink != 0; }
+  };
+
+  class CompressOStream : public std::ostream
+  {
+      CompressStreamBuf _streambuf;
+
+    public:
+      explicit CompressOStream(Compressor& compressor)
+        : std::ostream(0),
+          _streambuf(compressor)
+        { init(&_streambuf); }
+
+      void begin(std::streambuf* sink, Compressor::Codec codec, int level)
+      { _streambuf.begin(sink, codec, level); }
+
+      void finish()
+      {
+        if (!_streambuf.finish())
+          setstate(failbit);
+      }
+
+      void clear()
+      {
+        std::ostream::clear();
+        _streambuf.clear();
+      }
+
+      bool isActive() const
+      { return _streambuf.isActive(); }
+  };
+}
+
+#endif // TNT_COMPRESSOR_H
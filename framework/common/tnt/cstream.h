@@ -38,15 +38,30 @@ namespace tnt
 
 class cstreambuf : public std::streambuf
 {
+  public:
+    /// Receives the content of the buffer, when it grows beyond a limit.
+    /// The drain is expected to pass the data on and empty the buffer.
+    class Drain
+    {
+      public:
+        virtual ~Drain() { }
+        virtual void drain(cstreambuf& buf) = 0;
+    };
+
+  private:
     typedef std::vector<char*> _chunks_type;
     unsigned _chunksize;
     _chunks_type _chunks;
+    Drain* _drain;
+    unsigned _drainLimit;
 
   public:
     typedef _chunks_type::size_type size_type;
 
     explicit cstreambuf(unsigned chunksize = 32768)
-    : _chunksize(chunksize)
+    : _chunksize(chunksize),
+      _drain(0),
+      _drainLimit(0)
     { }
 
     ~cstreambuf();
@@ -73,7 +88,15 @@ class cstreambuf : public std::streambuf
 
     void makeEmpty();
 
+    /// Passes the content to the drain, when a new chunk is needed and the
+    /// buffer holds at least `limit` bytes; a null drain disables it.
+    void setDrain(Drain* drain, unsigned limit)
+    { _drain = drain; _drainLimit = limit; }
+
   private:
+    char* allocChunk();
+    void releaseChunk(char* chunk);
+
     std::streambuf::int_type overflow(std::streambuf::int_type ch);
     std::streambuf::int_type underflow();
     int sync();
@@ -111,6 +134,9 @@ class ocstream : public std::ostream
     void makeEmpty()
     { _streambuf.makeEmpty(); }
 
+    void setDrain(cstreambuf::Drain* drain, unsigned limit)
+    { _streambuf.setDrain(drain, limit); }
+
     std::string str() const;
 
     void output(std::ostream& out) const;
@@ -55,6 +55,7 @@ namespace tnt
       z_stream _stream;
       std::vector<char_type> _obuffer;
       std::streambuf* _sink;
+      int _level;
 
     public:
       explicit DeflateStreamBuf(std::streambuf* sink_, int level = Z_DEFAULT_COMPRESSION, unsigned bufsize = 8192);
@@ -70,6 +71,8 @@ namespace tnt
       /// end deflate-stream
       int end();
       void reinitialize();
+      /// Set the compression level; only valid before data is written
+      void setLevel(int level);
       void setSink(std::streambuf* sink) { _sink = sink; }
       uLong getAdler() const             { return _stream.adler; }
   };
@@ -91,6 +94,8 @@ namespace tnt
       void end();
       void reinitialize()
       { _streambuf.reinitialize(); }
+      void setLevel(int level)
+      { _streambuf.setLevel(level); }
       void setSink(std::streambuf* sink) { _streambuf.setSink(sink); }
       void setSink(std::ostream& sink)   { _streambuf.setSink(sink.rdbuf()); }
       uLong getAdler() const             { return _streambuf.getAdler(); }
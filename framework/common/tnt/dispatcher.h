@@ -34,6 +34,7 @@
 #include <tnt/urlmapper.h>
 #include <tnt/mapping.h>
 #include <tnt/maptarget.h>
+#include <tnt/tntconfig.h>
 #include <vector>
 #include <map>
 
@@ -89,10 +90,15 @@ namespace tnt
       mutable cxxtools::ReadWriteMutex _urlMapCacheMutex;
       mutable urlMapCacheType _urlMapCache;
 
-      Maptarget mapCompNext(const HttpRequest& request, urlmap_type::size_type& pos) const;
+      std::vector<ReplyCache*> _replyCaches;
+
+      bool mapCompNext(const HttpRequest& request, urlmap_type::size_type& pos, Maptarget& ci) const;
 
     public:
-      virtual ~Dispatcher()  { }
+      virtual ~Dispatcher();
+
+      /// Creates a reply cache, which lives as long as the dispatcher.
+      ReplyCache* addReplyCache(const TntConfig::Cache& config);
 
       Mapping& addUrlMapEntry(const std::string& vhost, const std::string& url, const std::string& method, int ssl, const Maptarget& ci);
 
@@ -116,6 +122,10 @@ namespace tnt
               _first(true)
             { }
 
+          /// Fetches the next matching target; returns false, when no mapping is left.
+          bool getNext(Maptarget& ci);
+
+          /// Returns the next matching target; throws NotFoundException, when no mapping is left.
           Maptarget getNext();
       };
   };
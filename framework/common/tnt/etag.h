@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#ifndef TNT_ETAG_H
+#define TNT_ETAG_H
+
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+
+struct stat;
+
+/// @cond internal
+
+namespace tnt
+{
+  /// Incremental 64 bit xxHash of a byte sequence. The hash is fast and
+  /// good enough to detect changed content, but not cryptographically
+  /// secure.
+  class XxHash64
+  {
+      uint64_t _acc[4];
+      uint64_t _seed;
+      uint64_t _total;
+      unsigned char _buffer[32];
+      unsigned _bufsize;
+
+      void consume(const unsigned char* p);
+
+    public:
+      explicit XxHash64(uint64_t seed = 0)
+        { reset(seed); }
+
+      void reset(uint64_t seed = 0);
+      void update(const char* data, size_t size);
+      uint64_t digest() const;
+  };
+
+  /// Returns a strong entity tag (including quotes) for a hash value.
+  std::string makeEtag(uint64_t hash);
+
+  /// Returns a strong entity tag (including quotes) built from inode,
+  /// modification time and size of a file.
+  std::string makeEtag(const struct ::stat& st);
+
+  /** Checks, whether the value of a If-None-Match header matches an entity
+      tag. Entity tags are compared weakly, i.e. a "W/" prefix is ignored.
+
+      When `withCoding` is set, a tag followed by "-<content-coding>" inside
+      the quotes matches too. The matching tag is then stored in `matched`,
+      if passed.
+   */
+  bool etagMatches(const char* ifNoneMatch, const std::string& etag,
+    bool withCoding = false, std::string* matched = 0);
+}
+
+/// @endcond internal
+
+#endif // TNT_ETAG_H
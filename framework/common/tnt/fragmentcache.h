@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#ifndef TNT_FRAGMENTCACHE_H
+#define TNT_FRAGMENTCACHE_H
+
+#include <cxxtools/refcounted.h>
+#include <cxxtools/smartptr.h>
+#include <string>
+
+namespace tnt
+{
+  /** Shared cache for rendered parts of pages
+
+      The ecpp directive `<%cache>` stores the output of the enclosed block
+      here and replays it on later requests. Fragments are shared by all
+      threads and components of the process. Applications remove outdated
+      fragments by key prefix or by the tag given when storing them. When
+      the fragments exceed TntConfig::fragmentCacheSize bytes, the least
+      recently used ones are dropped.
+   */
+  class FragmentCache
+  {
+    public:
+      /// The immutable text of a fragment, shared by all readers
+      class Content : public cxxtools::AtomicRefCounted
+      {
+          std::string _str;
+
+        public:
+          explicit Content(const std::string& str)
+            : _str(str)
+            { }
+
+          const std::string& str() const
+            { return _str; }
+      };
+
+      typedef cxxtools::SmartPtr<Content> ContentPtr;
+
+      /// Returns the fragment or a null pointer, when it is missing or expired.
+      static ContentPtr get(const std::string& key);
+
+      /// Copies the fragment into `content`; returns false, when it is missing or expired.
+      static bool get(const std::string& key, std::string& content);
+
+      /// Stores a fragment for `ttl` seconds; 0 keeps it until it is invalidated.
+      static void put(const std::string& key, ContentPtr content,
+                      unsigned ttl, const std::string& tag = std::string());
+
+      static void put(const std::string& key, const std::string& content,
+                      unsigned ttl, const std::string& tag = std::string())
+        { put(key, ContentPtr(new Content(content)), ttl, tag); }
+
+      /// Removes all fragments with keys starting with `prefix` and returns their number.
+      static unsigned invalidate(const std::string& prefix);
+
+      /// Removes all fragments stored with `tag` and returns their number.
+      static unsigned invalidateTag(const std::string& tag);
+
+      /// Removes all fragments.
+      static void clear();
+  };
+}
+
+#endif // TNT_FRAGMENTCACHE_H
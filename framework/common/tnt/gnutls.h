@@ -32,6 +32,7 @@
 
 #include <cxxtools/net/tcpstream.h>
 #include <gnutls/gnutls.h>
+#include <sys/types.h>
 
 /// @cond internal
 namespace tnt
@@ -121,6 +122,9 @@ namespace tnt
       void handshake(const GnuTlsServer& server);
       int sslRead(char* buffer, int bufsize) const;
       int sslWrite(const char* buffer, int bufsize) const;
+      /// Sends count bytes of the file starting at offset. Data buffered in
+      /// the stream must be flushed before.
+      void sslSendFile(int fd, off_t offset, off_t count) const;
       void shutdown();
   };
 
@@ -70,6 +70,12 @@ namespace tnt
     extern const char* contentDisposition;
     extern const char* age;
     extern const char* transferEncoding;
+    extern const char* vary;
+    extern const char* etag;
+    extern const char* ifNoneMatch;
+    extern const char* ifRange;
+    extern const char* expect;
+    extern const char* expect100Continue;
   }
 }
 
@@ -119,12 +119,37 @@ namespace tnt
       static void htdate(char* date, const struct ::tm* tm);
       /// @}
 
+      /** Parse a http date
+
+          All three date formats of RFC 7231 are accepted: the preferred
+          "Sun, 06 Nov 1994 08:49:37 GMT", the obsolete RFC 850 format
+          "Sunday, 06-Nov-94 08:49:37 GMT" and the asctime format
+          "Sun Nov  6 08:49:37 1994".
+
+          @return false, if the string is not a valid date
+       */
+      static bool parseHtdate(const char* date, time_t& t);
+
       /// Get a string for the current time, formatted as needed in http
       static std::string htdateCurrent();
       /// Get a string for the current time, formatted as needed in http
       /// buffer must point to at least 30 bytes
       static void htdateCurrent(char* current);
 
+      /** Get the current time, formatted as needed in http, from a cache
+
+          The cached value is refreshed once per second by the timer thread
+          of tntnet. When no timer is running, this is the same as
+          htdateCurrent. The buffer must point to at least 30 bytes.
+       */
+      static void htdateCached(char* current);
+
+      /// Refresh the value returned by htdateCached; called by the timer thread
+      static void refreshHtdateCache();
+
+      /// Stop using the cached date, when the timer thread stops
+      static void clearHtdateCache();
+
       // TODO: Documentation revision: Is this meant to check for absolute URLs?
       /** Check for double-dot-url
 
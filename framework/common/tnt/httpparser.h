@@ -67,6 +67,7 @@ namespace tnt
       unsigned _httpCode;
 
       size_t _bodySize;
+      bool _expectContinue;
 
       bool state_cmd0(char ch);
       bool state_cmd(char ch);
@@ -87,6 +88,8 @@ namespace tnt
       bool state_header(char ch);
       bool state_body(char ch);
 
+      void inflateBody();
+
     protected:
       virtual void requestSizeExceeded();
 
@@ -95,10 +98,22 @@ namespace tnt
         : tnt::Parser<Parser, RequestSizeMonitor>(&Parser::state_cmd0),
           _message(message),
           _headerParser(message.header),
-          _httpCode(HTTP_OK)
+          _httpCode(HTTP_OK),
+          _expectContinue(false)
         { }
 
       void reset();
+
+      /// Returns the http status code, which describes why parsing failed.
+      unsigned getHttpCode() const  { return _httpCode; }
+
+      /// Returns true, when the header is complete but the client waits for
+      /// a "100 Continue" before sending the body. Parsing the body is
+      /// resumed with the next call to parse.
+      bool expectContinue() const   { return _expectContinue; }
+
+      /// Marks the pending expectation as handled.
+      void continueBody()           { _expectContinue = false; }
   };
 }
 
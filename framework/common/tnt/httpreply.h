@@ -49,8 +49,8 @@ namespace tnt
       std::ostream* _safeOutstream;
       std::ostream* _urlOutstream;
 
-      void sendHttpStatus(std::ostream& hsocket, unsigned ret, const char* msg) const;
-      void sendHttpHeaders(std::ostream& hsocket) const;
+      void sendHttpStatus(std::string& buffer, unsigned ret, const char* msg) const;
+      void sendHttpHeaders(std::string& buffer, bool varyEncoding) const;
       void send(unsigned ret, const char* msg, bool ready) const;
 
     public:
@@ -65,6 +65,9 @@ namespace tnt
       const char* getContentType() const        { return getHeader(httpheader::contentType); }
 
       void setHeadRequest(bool sw = true);
+      /// Returns true, if the reply to a HEAD request is generated. Components
+      /// may skip generating the body then, since it is not sent anyway.
+      bool isHeadRequest() const;
 
       /// Configure the session to be cleared after the current request
       void clearSession();
@@ -118,7 +121,37 @@ namespace tnt
       virtual void setDirectMode(unsigned ret = HTTP_OK, const char* msg = "OK");
       virtual void setDirectModeNoFlush();
       virtual bool isDirectMode() const;
+
+      /// Is notified, before the headers of a reply are sent, because its
+      /// body outgrew the limit set with setBufferLimit.
+      class SpillListener
+      {
+        public:
+          virtual ~SpillListener() { }
+          virtual void onSpill(HttpReply& reply) = 0;
+      };
+
+      /** Limits the size of the buffered body
+
+          When the body grows beyond `size` bytes, the headers are sent with
+          status 200 and the body is streamed from then on. A body with a
+          Content-Length header is sent in direct mode keeping the length;
+          otherwise it is chunked, or sent in direct mode closing the
+          connection for http/1.0 clients. Compression stays active for
+          bodies of unknown length. Headers set after that point are lost;
+          `listener` gets the chance to add its headers before. 0 disables
+          the limit. Tntnet sets the limit from the configuration before
+          calling a component.
+      */
+      void setBufferLimit(unsigned size, SpillListener* listener = 0);
       std::string::size_type getContentSize() const;
+      /// Get a copy of the buffered body
+      std::string getContent() const;
+      /** Get the body as sent, when tntnet compressed it on sending
+
+          @return false, if the body was not compressed
+       */
+      bool getSentContent(std::string& encoding, std::string& body) const;
       unsigned chunkedBytesWritten() const;
       std::ostream& getDirectStream();
 
@@ -149,6 +182,24 @@ namespace tnt
       */
       void setMd5Sum();
 
+      /** Sets a strong ETag header calculated from the current content.
+
+          Like with setMd5Sum no output must be created after calling that
+          method. When the body is compressed on sending, the content coding
+          is appended to the tag, so that each representation has its own
+          entity tag.
+      */
+      void setBodyEtag();
+
+      /// Sets the tag of the body explicitly, e.g. a tag known from a cached body
+      void setBodyEtag(const std::string& etag);
+
+      /// Returns the tag set by setBodyEtag or an empty string
+      const std::string& getBodyEtag() const;
+
+      /// Check whether the value of a If-None-Match header matches the tag set by setBodyEtag
+      bool bodyEtagMatches(const char* ifNoneMatch);
+
       void setCookie(const std::string& name, const Cookie& value);
       void setCookie(const std::string& name, const std::string& value, unsigned seconds)
         { setCookie(name, Cookie(value, seconds)); }
@@ -163,6 +214,14 @@ namespace tnt
         { return httpcookies; }
 
       void setKeepAliveCounter(unsigned c);
+
+      /** Set the file descriptor of the plain socket of the reply stream
+
+          When set, the complete reply is passed to the kernel with a
+          single gathered write bypassing the stream buffer. It must not
+          be set for ssl connections.
+       */
+      void setSocketFd(int fd);
       unsigned getKeepAliveCounter() const;
 
       void setAcceptEncoding(const Encoding& enc);
@@ -56,6 +56,7 @@ namespace tnt
   {
       friend class SessionUnlocker;
       friend class ApplicationUnlocker;
+      friend class Job;
 
     public:
       // forward declaration of subclass defined in httpparser.h
@@ -200,6 +201,10 @@ namespace tnt
       /// Set query parameters (GET and POST)
       void setQueryParams(const tnt::QueryParams& q) { _qparam = q; }
 
+      /// Parse the GET and POST parameters now instead of on first access
+      void parseQueryParams() const
+        { _getparam.parse(); _postparam.parse(); _qparam.parse(); }
+
       /// Get the IP the request was sent from
       std::string getPeerIp() const   { return _socketIf ? _socketIf->getPeerIp()   : std::string(); }
 
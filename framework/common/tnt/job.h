@@ -33,6 +33,7 @@
 #include <deque>
 #include <tnt/httprequest.h>
 #include <tnt/httpparser.h>
+#include <tnt/replycache.h>
 #include <cxxtools/mutex.h>
 #include <cxxtools/condition.h>
 #include <cxxtools/refcounted.h>
@@ -46,11 +47,36 @@ namespace tnt
 
   class Job : public cxxtools::RefCounted
   {
+    public:
+      /// The per request state of a connection. It is only held while a
+      /// request is processed and returned to a pool, when the connection
+      /// gets idle.
+      class RequestState
+      {
+        public:
+          HttpRequest request;
+          HttpRequest::Parser parser;
+
+          RequestState(Tntnet& app, const SocketIf* socketIf)
+            : request(app, socketIf),
+              parser(request)
+            { }
+      };
+
+    private:
       unsigned _keepAliveCounter;
 
-      HttpRequest _request;
-      HttpRequest::Parser _parser;
+      Tntnet& _application;
+      const SocketIf* _socketIf;
+      RequestState* _requestState;
       time_t _lastAccessTime;
+      bool _resumed;
+      StoredReplyPtr _sharedReply;
+
+      void acquireRequestState();
+
+      Job(const Job&);
+      Job& operator=(const Job&);
 
     public:
       explicit Job(Tntnet& app, const SocketIf* socketIf = 0);
@@ -61,12 +87,42 @@ namespace tnt
       virtual void setRead() = 0;
       virtual void setWrite() = 0;
 
-      HttpRequest& getRequest()        { return _request; }
-      HttpRequest::Parser& getParser() { return _parser; }
+      Tntnet& getApplication()         { return _application; }
+
+      HttpRequest& getRequest()
+      {
+        if (_requestState == 0)
+          acquireRequestState();
+        return _requestState->request;
+      }
+
+      HttpRequest::Parser& getParser()
+      {
+        if (_requestState == 0)
+          acquireRequestState();
+        return _requestState->parser;
+      }
 
       unsigned decrementKeepAliveCounter()
         { return _keepAliveCounter > 0 ? --_keepAliveCounter : 0; }
+      unsigned getKeepAliveCounter() const
+        { return _keepAliveCounter; }
+
+      /// Continues a parked request, which is already parsed. It gets the
+      /// reply of an identical request or processes it itself, when the
+      /// reply is null.
+      void resume(const StoredReplyPtr& reply)
+        { _resumed = true; _sharedReply = reply; }
+      bool isResumed() const
+        { return _resumed; }
+      const StoredReplyPtr& getSharedReply() const
+        { return _sharedReply; }
+
       void clear();
+
+      /// Returns the request state to the pool, when no request is in
+      /// progress. Called before the job is passed to the poller.
+      void releaseRequestState();
       void touch() { time(&_lastAccessTime); }
       cxxtools::Milliseconds msecToTimeout(time_t currentTime) const;
   };
@@ -80,7 +136,7 @@ namespace tnt
 
     private:
       std::deque<JobPtr> _jobs;
-      cxxtools::Mutex _mutex;
+      mutable cxxtools::Mutex _mutex;
       cxxtools::Condition _notEmpty;
       cxxtools::Condition _notFull;
       unsigned _waitThreads;
@@ -103,6 +159,8 @@ namespace tnt
         { return _waitThreads; }
       bool empty() const
         { return _jobs.empty(); }
+      /// Returns the number of waiting jobs.
+      unsigned size() const;
   };
 
 }
@@ -76,6 +76,24 @@ namespace tnt
         return *this;
       }
 
+      Mapping& setEtag(bool sw)
+      {
+        _target.setEtag(sw);
+        return *this;
+      }
+
+      Mapping& setReplyBufferLimit(int size)
+      {
+        _target.setReplyBufferLimit(size);
+        return *this;
+      }
+
+      Mapping& setCoalesce(bool sw)
+      {
+        _target.setCoalesce(sw);
+        return *this;
+      }
+
       Mapping& setArgs(const args_type& a)
       {
         _target.setArgs(a);
@@ -37,6 +37,8 @@
 
 namespace tnt
 {
+  class ReplyCache;
+
   /// @cond internal
   class Maptarget : public Compident
   {
@@ -50,23 +52,39 @@ namespace tnt
       args_type _args;
       bool _pathinfoSet;
       unsigned _httpreturn;
+      bool _etag;
+      int _replyBufferLimit;
+      ReplyCache* _replyCache;
+      bool _coalesce;
 
     public:
       Maptarget()
         : _pathinfoSet(false),
-          _httpreturn(HTTP_OK)
+          _httpreturn(HTTP_OK),
+          _etag(false),
+          _replyBufferLimit(-1),
+          _replyCache(0),
+          _coalesce(false)
         { }
 
       explicit Maptarget(const std::string& ident)
         : Compident(ident),
           _pathinfoSet(false),
-          _httpreturn(HTTP_OK)
+          _httpreturn(HTTP_OK),
+          _etag(false),
+          _replyBufferLimit(-1),
+          _replyCache(0),
+          _coalesce(false)
         { }
 
       Maptarget(const Compident& ident)
         : Compident(ident),
           _pathinfoSet(false),
-          _httpreturn(HTTP_OK)
+          _httpreturn(HTTP_OK),
+          _etag(false),
+          _replyBufferLimit(-1),
+          _replyCache(0),
+          _coalesce(false)
         { }
 
       bool hasPathInfo() const
@@ -79,6 +97,26 @@ namespace tnt
         { _httpreturn = ret; }
       unsigned getHttpReturn() const
         { return _httpreturn; }
+      /// Enables an ETag calculated from the body of buffered replies
+      void setEtag(bool sw)
+        { _etag = sw; }
+      bool getEtag() const
+        { return _etag; }
+      /// Overrides the global replyBufferLimit, when not negative
+      void setReplyBufferLimit(int size)
+        { _replyBufferLimit = size; }
+      int getReplyBufferLimit() const
+        { return _replyBufferLimit; }
+      /// Sets the cache for the replies of the target; 0 disables caching
+      void setReplyCache(ReplyCache* cache)
+        { _replyCache = cache; }
+      ReplyCache* getReplyCache() const
+        { return _replyCache; }
+      /// Lets identical concurrent requests share the reply of the first one
+      void setCoalesce(bool sw)
+        { _coalesce = sw; }
+      bool getCoalesce() const
+        { return _coalesce; }
       const std::string& getPathInfo() const
         { return _pathinfo; }
       const args_type& getArgs() const
@@ -33,6 +33,7 @@
 #include <cxxtools/net/tcpstream.h>
 #include <cxxtools/smartptr.h>
 #include <openssl/ssl.h>
+#include <sys/types.h>
 
 /// @cond internal
 namespace tnt
@@ -92,6 +93,9 @@ namespace tnt
 
       int sslRead(char* buffer, int bufsize) const;
       int sslWrite(const char* buffer, int bufsize) const;
+      /// Sends count bytes of the file starting at offset. Data buffered in
+      /// the stream must be flushed before.
+      void sslSendFile(int fd, off_t offset, off_t count) const;
       void shutdown() const;
   };
 
@@ -54,6 +54,59 @@ namespace tnt
   /// @cond internal
   namespace qhelper
   {
+    enum ConvertResult
+    {
+      convertFailed,
+      convertOk,
+      convertUnsupported
+    };
+
+    /// @{
+    /** Fast locale independent conversion of parameters to numbers
+
+        The conversion follows the rules of reading the number from a
+        std::istream: leading white space is skipped and trailing
+        characters after the number are ignored. Types without a fast
+        conversion return convertUnsupported and are read using a stream.
+        Floating point numbers are only converted here when the decimal
+        point of the locale is '.'.
+     */
+    template <typename Type>
+    ConvertResult convertParam(const std::string&, Type&, const std::locale&)
+      { return convertUnsupported; }
+
+    ConvertResult convertParam(const std::string& s, short& value, const std::locale&);
+    ConvertResult convertParam(const std::string& s, unsigned short& value, const std::locale&);
+    ConvertResult convertParam(const std::string& s, int& value, const std::locale&);
+    ConvertResult convertParam(const std::string& s, unsigned& value, const std::locale&);
+    ConvertResult convertParam(const std::string& s, long& value, const std::locale&);
+    ConvertResult convertParam(const std::string& s, unsigned long& value, const std::locale&);
+    ConvertResult convertParam(const std::string& s, long long& value, const std::locale&);
+    ConvertResult convertParam(const std::string& s, unsigned long long& value, const std::locale&);
+    ConvertResult convertParam(const std::string& s, float& value, const std::locale& loc);
+    ConvertResult convertParam(const std::string& s, double& value, const std::locale& loc);
+    ConvertResult convertParam(const std::string& s, long double& value, const std::locale& loc);
+    /// @}
+
+    /// @{
+    /** Fast formatting of numbers
+
+        Returns false, when there is no fast formatting for the type.
+     */
+    template <typename Type>
+    bool formatParam(const Type&, std::string&)
+      { return false; }
+
+    bool formatParam(short value, std::string& s);
+    bool formatParam(unsigned short value, std::string& s);
+    bool formatParam(int value, std::string& s);
+    bool formatParam(unsigned value, std::string& s);
+    bool formatParam(long value, std::string& s);
+    bool formatParam(unsigned long value, std::string& s);
+    bool formatParam(long long value, std::string& s);
+    bool formatParam(unsigned long long value, std::string& s);
+    /// @}
+
     template <typename Type>
     class QArg
     {
@@ -117,39 +170,77 @@ namespace tnt
   }
   /// @endcond internal
 
-  /// Container for GET and POST parameters
+  /// Decode the url encoded string in the range [b, e) and append it to `out`
+  void urlUnescape(const char* b, const char* e, std::string& out);
+
+  /// Decode the url encoded string `s`
+  std::string urlUnescape(const std::string& s);
+
+  /** Container for GET and POST parameters
+
+      Parameters from a request are parsed lazily. The request registers
+      the query string and the url encoded body with parseLazy() and they
+      are decoded only when a parameter is accessed the first time through
+      this class. Components, which never look at their parameters, do not
+      pay for parsing them.
+
+      The accessors of the base class cxxtools::QueryParams are not
+      virtual, so they do not see pending parameters. Call parse() before
+      the object is used through a reference to the base class. Tntnet
+      does this before calling a component, unless the component declares
+      with Component::lazyQueryParams(), that it does not need it.
+   */
   class QueryParams : public cxxtools::QueryParams
   {
       Scope* _paramScope;
       std::locale _locale;
 
+      // url encoded strings not yet parsed; the strings are owned by the
+      // request and must live until the parameters are accessed
+      enum { maxPending = 2 };
+      const std::string* _pending[maxPending];
+
+      void parsePending() const
+      {
+        if (_pending[0])
+          const_cast<QueryParams*>(this)->doParsePending();
+      }
+
+      void doParsePending();
+      void parseUrlencoded(const std::string& s);
+
     public:
       /// Create an empty %QueryParams object
       QueryParams()
         : _paramScope(0),
           _locale(std::locale::classic())
-        { }
+        { _pending[0] = _pending[1] = 0; }
 
       QueryParams(const QueryParams& src)
-        : cxxtools::QueryParams(src),
+        : cxxtools::QueryParams((src.parsePending(), src)),
           _paramScope(src._paramScope),
           _locale(src._locale)
         {
+          _pending[0] = _pending[1] = 0;
           if (_paramScope)
             _paramScope->addRef();
         }
 
       explicit QueryParams(const std::string& url)
-        : cxxtools::QueryParams(url),
-          _paramScope(0),
+        : _paramScope(0),
           _locale(std::locale::classic())
-        { }
+        {
+          _pending[0] = _pending[1] = 0;
+          parseUrlencoded(url);
+        }
 
       QueryParams& operator= (const QueryParams& src)
       {
         if (this == &src)
           return *this;
 
+        src.parsePending();
+        _pending[0] = _pending[1] = 0;
         cxxtools::QueryParams::operator=(src);
         if (_paramScope != src._paramScope)
         {
@@ -182,6 +273,93 @@ namespace tnt
       /// Set the locale used for parsing floating-point numbers
       void locale(const std::locale& loc) { _locale = loc; }
 
+      /** Register an url encoded string to be parsed on first access
+
+          Only a pointer to the string is kept, so it must not be destroyed
+          before the parameters are read or this object is cleared.
+       */
+      void parseLazy(const std::string& s)
+      {
+        if (s.empty())
+          return;
+        if (_pending[maxPending - 1])
+          parsePending();
+        for (unsigned n = 0; n < maxPending; ++n)
+          if (_pending[n] == 0)
+          {
+            _pending[n] = &s;
+            break;
+          }
+      }
+
+      /// Check whether there are pending strings, which are not parsed yet
+      bool isParsed() const  { return _pending[0] == 0; }
+
+      /// Parse pending strings now
+      void parse() const     { parsePending(); }
+
+      /** Quick check whether a parameter with the given name may exist
+
+          When the parameters are not parsed yet, the raw strings are searched
+          for the name without parsing them. A return value of false means
+          that the parameter is definitely not set.
+       */
+      bool mightHave(const std::string& name) const;
+
+      /// @{
+      /// Accessors of cxxtools::QueryParams, which parse pending parameters first
+      void parse_url(const std::string& url)
+        { parsePending(); parseUrlencoded(url); }
+
+      std::string param(size_type n) const
+        { parsePending(); return cxxtools::QueryParams::param(n); }
+
+      size_type paramcount() const
+        { parsePending(); return cxxtools::QueryParams::paramcount(); }
+
+      std::string operator[] (size_type n) const
+        { parsePending(); return cxxtools::QueryParams::operator[](n); }
+
+      std::string param(const std::string& name, size_type n = 0) const
+        { parsePending(); return cxxtools::QueryParams::param(name, n); }
+
+      std::string param(const std::string& name, size_type n, const std::string& def) const
+        { parsePending(); return cxxtools::QueryParams::param(name, n, def); }
+
+      size_type paramcount(const std::string& name) const
+        { parsePending(); return cxxtools::QueryParams::paramcount(name); }
+
+      std::string operator[] (const std::string& name) const
+        { parsePending(); return cxxtools::QueryParams::operator[](name); }
+
+      bool has(const std::string& name) const
+        { parsePending(); return cxxtools::QueryParams::has(name); }
+
+      bool empty() const
+        { parsePending(); return cxxtools::QueryParams::empty(); }
+
+      const_iterator begin() const
+        { parsePending(); return cxxtools::QueryParams::begin(); }
+
+      const_iterator begin(const std::string& name) const
+        { parsePending(); return cxxtools::QueryParams::begin(name); }
+
+      const_iterator end() const
+        { return cxxtools::QueryParams::end(); }
+
+      std::string getUrl() const
+        { parsePending(); return cxxtools::QueryParams::getUrl(); }
+
+      void remove(const std::string& name)
+        { parsePending(); cxxtools::QueryParams::remove(name); }
+
+      void clear()
+      {
+        _pending[0] = _pending[1] = 0;
+        cxxtools::QueryParams::clear();
+      }
+      /// @}
+
       template <typename Type>
       Type arg(const std::string& name, const Type& def = Type()) const
         { return qhelper::QArg<Type>::arg(*this, name, 0, def); }
@@ -232,14 +410,31 @@ namespace tnt
       QueryParams& add(const std::string& name, const Type& value)
         { qhelper::QAdd<Type>::add(*this, name, value); return *this; }
 
+      QueryParams& add(const std::string& name, const std::string& value)
+      {
+        parsePending();
+        cxxtools::QueryParams::add(name, value);
+        return *this;
+      }
+
       QueryParams& add(const std::string& name, const char* value)
       {
+        parsePending();
         cxxtools::QueryParams::add(name, value);
         return *this;
       }
 
       QueryParams& add(const cxxtools::QueryParams& q)
       {
+        parsePending();
+        cxxtools::QueryParams::add(q);
+        return *this;
+      }
+
+      QueryParams& add(const QueryParams& q)
+      {
+        parsePending();
+        q.parsePending();
         cxxtools::QueryParams::add(q);
         return *this;
       }
@@ -251,9 +446,17 @@ namespace tnt
     Type QArg<Type>::arg(const QueryParams& q, const std::string& name, unsigned n, const Type& def)
     {
       std::string v = q.param(name, n);
+
+      Type ret;
+      switch (convertParam(v, ret, q.locale()))
+      {
+        case convertOk:          return ret;
+        case convertFailed:      return def;
+        case convertUnsupported: break;
+      }
+
       std::istringstream s(v);
       s.imbue(q.locale());
-      Type ret;
       s >> ret;
       if (!s)
         return def;
@@ -264,9 +467,16 @@ namespace tnt
     Type QArg<Type>::argt(const QueryParams& q, const std::string& name, unsigned n, const char* typeName)
     {
       std::string v = q.param(name, n);
+
+      Type ret;
+      ConvertResult r = convertParam(v, ret, q.locale());
+      if (r == convertOk)
+        return ret;
+      else if (r == convertFailed)
+        ConversionError::doThrow(name, n, typeName, v);
+
       std::istringstream s(v);
       s.imbue(q.locale());
-      Type ret;
       s >> ret;
       if (!s)
         ConversionError::doThrow(name, n, typeName, v);
@@ -308,20 +518,27 @@ namespace tnt
     template <typename Type>
     void QAdd<Type>::add(QueryParams& q, const std::string& name, const Type& value)
     {
+      std::string v;
+      if (formatParam(value, v))
+      {
+        q.add(name, v);
+        return;
+      }
+
       std::ostringstream s;
       s.imbue(q.locale());
       s << value;
-      static_cast<cxxtools::QueryParams&>(q).add(name, s.str());
+      q.add(name, s.str());
     }
 
     inline void QAdd<std::string>::add(QueryParams& q, const std::string& name, const std::string& value)
-      { static_cast<cxxtools::QueryParams&>(q).add(name, value); }
+      { q.add(name, value); }
 
     inline void QAdd<char>::add(QueryParams& q, const std::string& name, char value)
-      { static_cast<cxxtools::QueryParams&>(q).add(name, std::string(1, value)); }
+      { q.add(name, std::string(1, value)); }
 
     inline void QAdd<bool>::add(QueryParams& q, const std::string& name, bool value)
-      { static_cast<cxxtools::QueryParams&>(q).add(name, value ? std::string(1, '1') : std::string()); }
+      { q.add(name, value ? std::string(1, '1') : std::string()); }
   }
 }
 
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#ifndef TNT_REPLYCACHE_H
+#define TNT_REPLYCACHE_H
+
+#include <tnt/tntconfig.h>
+#include <cxxtools/condition.h>
+#include <cxxtools/mutex.h>
+#include <cxxtools/refcounted.h>
+#include <cxxtools/smartptr.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// @cond internal
+
+namespace tnt
+{
+  class HttpRequest;
+  class HttpReply;
+
+  /** A copy of a sent reply
+
+      The reply is stored with its headers, its body and the compressed
+      variants of the body, which were sent. It is used to answer other
+      requests without calling the component again.
+   */
+  class StoredReply : public cxxtools::AtomicRefCounted
+  {
+    public:
+      typedef std::vector<std::pair<std::string, std::string> > HeadersType;
+      typedef std::map<std::string, std::string> VariantsType;
+
+    private:
+      unsigned _httpReturn;
+      HeadersType _headers;
+      std::string _body;
+      std::string _etag;
+
+      // compressed bodies by content coding; added by later requests
+      mutable cxxtools::Mutex _variantsMutex;
+      VariantsType _variants;
+
+      StoredReply()
+        { }
+
+    public:
+      long long created;
+      long long expires;
+
+      /// Returns a copy of the reply or 0, when the reply may not be shared.
+      static StoredReply* create(const HttpReply& reply, unsigned httpReturn);
+
+      /// Checks whether a reply may be shared with other requests.
+      static bool isShareable(const HttpReply& reply, unsigned httpReturn);
+
+      /// Copies the reply into `reply` and returns its status.
+      unsigned fill(const HttpRequest& request, HttpReply& reply) const;
+
+      /// Adds the compressed body of the sent reply.
+      void addVariant(const HttpReply& reply);
+  };
+
+  typedef cxxtools::SmartPtr<StoredReply> StoredReplyPtr;
+
+  /** Keeps complete replies of a mapping for a short time
+
+      Only one request renews an expired or missing reply; concurrent
+      requests for the same reply get the expired one or wait for the new
+      one.
+   */
+  class ReplyCache
+  {
+      struct Slot
+      {
+        StoredReplyPtr entry;
+        bool renewing;
+        // The last reply was not shareable; until then requests call the
+        // component without waiting for each other.
+        long long uncacheableUntil;
+
+        Slot()
+          : renewing(false),
+            uncacheableUntil(0)
+          { }
+      };
+
+      typedef std::map<std::string, Slot> SlotsType;
+
+      TntConfig::Cache _config;
+      SlotsType _slots;
+      cxxtools::Mutex _mutex;
+      cxxtools::Condition _renewed;
+
+      void purge(long long now);
+
+    public:
+      explicit ReplyCache(const TntConfig::Cache& config)
+        : _config(config)
+        { }
+
+      /// Returns the key of the reply to a request.
+      std::string makeKey(const HttpRequest& request) const;
+
+      /** The lookup of a request in the cache
+
+          When no valid reply is found for a GET request, the lookup gets the
+          right to renew it until it is destroyed or the reply is stored.
+       */
+      class Lookup
+      {
+          ReplyCache* _cache;
+          std::string _key;
+          StoredReplyPtr _entry;
+          bool _renewing;
+
+          void release();
+
+          // disable copy and assignment
+          Lookup(const Lookup&);
+          Lookup& operator=(const Lookup&);
+
+        public:
+          /// A null cache gives an empty lookup.
+          Lookup(ReplyCache* cache, const HttpRequest& request);
+          ~Lookup()
+            { release(); }
+
+          bool found() const
+            { return _entry.getPointer() != 0; }
+
+          /// Copies the cached reply into the reply and returns its status.
+          unsigned fill(const HttpRequest& request, HttpReply& reply) const;
+
+          /// Stores the reply, when the lookup renews it and it is shareable.
+          /// A reply, which is not shareable, lets the following requests
+          /// bypass the cache for maxAge.
+          void store(const HttpReply& reply, unsigned httpReturn);
+
+          /// Adds the compressed body of the sent reply to the cached reply.
+          void storeVariant(const HttpReply& reply);
+      };
+  };
+}
+
+/// @endcond internal
+
+#endif // TNT_REPLYCACHE_H
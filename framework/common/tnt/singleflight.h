@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#ifndef TNT_SINGLEFLIGHT_H
+#define TNT_SINGLEFLIGHT_H
+
+#include <tnt/job.h>
+#include <tnt/replycache.h>
+#include <cxxtools/mutex.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/// @cond internal
+
+namespace tnt
+{
+  class Maptarget;
+
+  /** Coalesces identical concurrent requests
+
+      The first request for a key executes the component. Identical
+      requests arriving meanwhile are parked without holding a worker
+      thread. When the first request is done, the parked jobs are put back
+      into the job queue together with a copy of its reply.
+   */
+  class SingleFlight
+  {
+      typedef std::vector<Jobqueue::JobPtr> FollowersType;
+      typedef std::map<std::string, FollowersType> FlightsType;
+
+      FlightsType _flights;
+      cxxtools::Mutex _mutex;
+
+    public:
+      /// Checks whether a request may get the reply of another request.
+      static bool isCoalescable(const HttpRequest& request);
+
+      /// Returns the key of a request to a target; identical requests have the same key.
+      static std::string makeKey(const Maptarget& ci, const HttpRequest& request);
+
+      /// Starts a flight; returns false, when a flight for the key is in progress.
+      bool start(const std::string& key);
+
+      /// Parks a job until the flight lands; returns false, when it has landed already.
+      bool park(const std::string& key, Jobqueue::JobPtr& job);
+
+      /** Ends a flight
+
+          The parked jobs are resumed with the reply. A null reply lets
+          them process their requests themselves.
+       */
+      void land(const std::string& key, const StoredReplyPtr& reply, Jobqueue& queue);
+
+      /// Leads a flight and lands it at the latest when destroyed
+      class Leader
+      {
+          SingleFlight* _flight;
+          std::string _key;
+          Jobqueue* _queue;
+          StoredReplyPtr _reply;
+
+          // disable copy and assignment
+          Leader(const Leader&);
+          Leader& operator=(const Leader&);
+
+        public:
+          Leader()
+            : _flight(0),
+              _queue(0)
+            { }
+          ~Leader()
+            { land(); }
+
+          /// Starts a flight; returns false, when a flight for the key is in progress.
+          bool lead(SingleFlight& flight, const std::string& key, Jobqueue& queue);
+
+          /// Keeps a copy of the reply for the parked jobs.
+          void capture(const HttpReply& reply, unsigned httpReturn);
+
+          /// Adds the compressed body of the sent reply and lands the flight.
+          void land(const HttpReply& reply);
+
+          void land();
+      };
+  };
+}
+
+/// @endcond internal
+
+#endif // TNT_SINGLEFLIGHT_H
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef TNT_STATICMANIFEST_H
+#define TNT_STATICMANIFEST_H
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/// @cond internal
+
+namespace tnt
+{
+  /** The manifest of precompressed static files
+
+      tntnet-precompress writes compressed siblings like "style.css.gz" next
+      to the files of a document root and lists them in a manifest in the
+      document root. The static component reads the manifest to know, which
+      siblings exist, without probing the file system on each request.
+
+      The manifest is a text file with one line per file. The tab separated
+      fields are the path relative to the document root, the size, the
+      modification time and the hash of the file followed by one field per
+      sibling in the form "encoding:size:hash". Siblings are listed in the
+      order of preference. Empty lines and lines starting with '#' are
+      ignored. Hashes are 64 bit xxHash values in hex.
+   */
+  class StaticManifest
+  {
+    public:
+      struct Variant
+      {
+        std::string encoding;
+        uint64_t size;
+        uint64_t hash;
+
+        Variant()
+          : size(0),
+            hash(0)
+          { }
+      };
+
+      typedef std::vector<Variant> VariantsType;
+
+      struct Entry
+      {
+        uint64_t size;
+        int64_t mtime;
+        uint64_t hash;
+        VariantsType variants;
+
+        Entry()
+          : size(0),
+            mtime(0),
+            hash(0)
+          { }
+      };
+
+      typedef std::map<std::string, Entry> EntriesType;
+
+    private:
+      EntriesType _entries;
+
+    public:
+      /// The name of the manifest file in the document root.
+      static const char* fileName();
+
+      /// Returns the file name suffix of a sibling with the content coding
+      /// or 0 if the coding is unknown.
+      static const char* suffix(const std::string& encoding);
+
+      /// Reads a manifest; throws std::runtime_error on syntax errors.
+      void read(std::istream& in);
+      void write(std::ostream& out) const;
+
+      /// Returns the entry of a path relative to the document root or 0.
+      const Entry* find(const std::string& path) const;
+
+      Entry& add(const std::string& path)
+        { return _entries[path]; }
+
+      const EntriesType& entries() const
+        { return _entries; }
+
+      bool empty() const
+        { return _entries.empty(); }
+
+      void clear()
+        { _entries.clear(); }
+  };
+}
+
+/// @endcond internal
+
+#endif // TNT_STATICMANIFEST_H
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#ifndef TNT_THREADLOCAL_H
+#define TNT_THREADLOCAL_H
+
+#include <pthread.h>
+
+/// @cond internal
+
+namespace tnt
+{
+  /// Holds one instance of T per thread. The instance is created on first
+  /// access and destroyed, when the thread terminates.
+  template <typename T>
+  class ThreadLocal
+  {
+      pthread_key_t _key;
+
+      static void destroy(void* p)
+        { delete static_cast<T*>(p); }
+
+      ThreadLocal(const ThreadLocal&);
+      ThreadLocal& operator=(const ThreadLocal&);
+
+    public:
+      ThreadLocal()
+        { pthread_key_create(&_key, destroy); }
+
+      ~ThreadLocal()
+      {
+        // only the instance of the current thread can be released here
+        reset();
+        pthread_key_delete(_key);
+      }
+
+      T& get()
+      {
+        T* p = static_cast<T*>(pthread_getspecific(_key));
+        if (p == 0)
+        {
+          p = new T();
+          pthread_setspecific(_key, p);
+        }
+        return *p;
+      }
+
+      /// Destroys the instance of the current thread.
+      void reset()
+      {
+        T* p = static_cast<T*>(pthread_getspecific(_key));
+        if (p)
+        {
+          pthread_setspecific(_key, 0);
+          delete p;
+        }
+      }
+  };
+}
+
+#endif // TNT_THREADLOCAL_H
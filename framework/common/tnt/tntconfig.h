@@ -99,6 +99,29 @@ namespace tnt
    */
   struct TntConfig
   {
+    /// Settings of the reply cache of a mapping
+    struct Cache
+    {
+      /// How long a reply is served from the cache; 0 disables the cache
+      cxxtools::Milliseconds maxAge;
+      /// Request headers, query parameters and cookies, which select
+      /// different replies; without parameters the whole query string is used
+      std::vector<std::string> headers;
+      std::vector<std::string> params;
+      std::vector<std::string> cookies;
+      /// Whether requests get the expired reply while another request
+      /// renews it instead of waiting for the new one
+      bool serveStale;
+      /// The maximal number of cached replies of the mapping
+      unsigned maxEntries;
+
+      Cache()
+        : maxAge(0),
+          serveStale(true),
+          maxEntries(1000)
+        { }
+    };
+
     /// A mapping entry
     struct Mapping
     {
@@ -109,13 +132,24 @@ namespace tnt
       std::string pathinfo;
       unsigned httpreturn;
       int ssl;
+      /// Calculate an ETag from the body of buffered replies and answer
+      /// matching If-None-Match requests with 304
+      bool etag;
+      /// Overrides replyBufferLimit for this mapping, when not negative
+      int replyBufferLimit;
+      Cache cache;
+      /// Let identical concurrent GET requests share the reply of the first one
+      bool coalesce;
 
       typedef std::map<std::string, std::string> ArgsType;
 
       ArgsType args;
 
       Mapping()
-        : httpreturn(HTTP_OK)
+        : httpreturn(HTTP_OK),
+          etag(false),
+          replyBufferLimit(-1),
+          coalesce(false)
         { }
     };
 
@@ -133,7 +167,24 @@ namespace tnt
       std::string key;
     };
 
+    /// A compression method for http replies
+    struct Compression
+    {
+      /// The content coding: "gzip", "br" or "zstd"
+      std::string encoding;
+      /// The compression level; -1 selects the default of the method
+      int level;
+      /// Minimal body size for this method; 0 means minCompressSize
+      unsigned minSize;
+
+      Compression()
+        : level(-1),
+          minSize(0)
+        { }
+    };
+
     typedef std::vector<Mapping> MappingsType;
+    typedef std::vector<Compression> CompressionsType;
     typedef std::vector<Listener> ListenersType;
     typedef std::vector<SslListener> SslListenersType;
     typedef std::vector<std::string> CompPathType;
@@ -167,6 +218,25 @@ namespace tnt
      */
     unsigned maxRequestSize;
 
+    /** Whether compressed request bodies are decompressed
+
+        When set, request bodies with the Content-Encoding gzip or deflate
+        are inflated after reading. The decompressed size is limited by
+        maxRequestSize and maxInflateRatio.
+
+        default: false
+     */
+    bool inflateRequestBody;
+
+    /** The maximal ratio of the inflated to the compressed request body size
+
+        Applies also, when maxRequestSize is not set. A value of 0 disables
+        the check.
+
+        default: 100
+     */
+    unsigned maxInflateRatio;
+
     /** The maximal time (in seconds) a worker thread may use to answer an http request
 
         If answering the request takes longer, the whole tntnet server is restarted,
@@ -366,6 +436,50 @@ namespace tnt
      */
     unsigned minCompressSize;
 
+    /** The compression methods offered to clients in order of preference
+
+        The method with the highest quality value in the "Accept-Encoding"
+        header of the request is used. When the client rates several methods
+        equally, the one listed first here wins. Methods not compiled into
+        tntnet are ignored.
+
+        default: br, zstd, gzip (as far as supported)
+     */
+    CompressionsType compressions;
+
+    /** Whether the compression of replies adapts to load and client link
+
+        When enabled, replies are not compressed, when the content type is
+        compressed already, the cpu usage exceeds compressionCpuLimit or
+        the client round trip time is below compressionLanRtt (when set).
+        Under moderate load the fastest compression level is used. See
+        CompressionGovernor.
+
+        default: false
+     */
+    bool adaptiveCompression;
+
+    /** The cpu usage of the process in percent of all cpus above which
+        adaptive compression stops compressing replies
+
+        Above half of this value the fastest compression level is used.
+
+        default: 90
+     */
+    unsigned compressionCpuLimit;
+
+    /** The round trip time in microseconds below which a client is
+        considered to be on a local network, so that adaptive compression
+        does not compress replies to it
+
+        The time is measured to the peer of the connection. Behind a
+        reverse proxy it is always short, so the check must stay disabled
+        then. 0 disables the check.
+
+        default: 0
+     */
+    unsigned compressionLanRtt;
+
     /** Filename of the mime database
 
         The mime database is used to look up the mime-type that is sent in the http header.
@@ -384,6 +498,95 @@ namespace tnt
      */
     unsigned maxUrlMapCache;
 
+    /** The maximal number of unused reply objects kept per worker thread
+
+        Reply objects are recycled within a thread without locking. Unused
+        objects above this limit are freed.
+
+        default: 4
+     */
+    unsigned maxCachedReplies;
+
+    /** The maximal number of unused 32 KB output buffers kept per worker thread
+
+        Output buffers are recycled within a thread without locking. Unused
+        buffers above this limit are freed.
+
+        default: 8
+     */
+    unsigned maxCachedChunks;
+
+    /** The size in bytes, above which a buffered reply is streamed
+
+        When the body of a reply grows beyond this size while the component
+        is running, the headers are sent with status 200 and the body is
+        streamed from then on using chunked encoding (or direct mode with
+        closing the connection for http/1.0 clients). A body with a
+        Content-Length header is sent in direct mode keeping the length.
+        This limits the memory needed per request and lets the client
+        receive large pages early. The session cookie is sent with the
+        headers, but as with setChunkedEncoding, headers and cookies set
+        afterwards are lost. The limit can be changed per mapping. 0
+        disables the limit.
+
+        default: 0
+     */
+    unsigned replyBufferLimit;
+
+    /** The maximal number of files, the static component keeps metadata for
+
+        The cache is cleared, when the limit is reached. 0 disables the cache.
+
+        default: 1024
+     */
+    unsigned staticCacheSize;
+
+    /** The maximal number of cached static files, which are kept open
+
+        Other cached files are opened for each request.
+
+        default: 64
+     */
+    unsigned staticCacheOpenFiles;
+
+    /** Time (in milliseconds) after which cached metadata of a static file
+        is checked again
+
+        Changes of files are normally noticed immediately using inotify.
+        Since inotify misses changes of parent directories (like a swapped
+        symlink), entries of watched files are checked with stat after the
+        timeout too and kept, when the file is unchanged.
+
+        default: 2000 milliseconds
+     */
+    cxxtools::Milliseconds staticCacheTtl;
+
+    /** The number of bytes the static component may use for holding
+        small files in memory
+
+        Files up to staticMemoryCacheMaxFile bytes are read into memory on
+        first access together with a compressed variant for each configured
+        compression method. 0 disables holding files in memory.
+
+        default: 0
+     */
+    unsigned staticMemoryCache;
+
+    /** The maximal size in bytes of a file, the static component holds in memory
+
+        default: 65536
+     */
+    unsigned staticMemoryCacheMaxFile;
+
+    /** The number of bytes the fragments of `<%cache>` blocks may use
+
+        When the limit is reached, the least recently used fragments are
+        removed.
+
+        default: 16777216
+     */
+    unsigned fragmentCacheSize;
+
     /** The default mime-type for the http header
 
         Sets the content type header of the reply. The content type may be changed in
@@ -503,6 +706,17 @@ namespace tnt
      */
     std::string sslProtocols;
 
+    /** Enable kernel TLS for ssl connections
+
+        When OpenSSL and the kernel support it, encryption of outgoing data is
+        done in the kernel and static files are sent with SSL_sendfile without
+        copying them to user space. When the negotiated cipher is not
+        supported by the kernel, the connection uses OpenSSL as usual.
+
+        default: true
+     */
+    bool sslKtls;
+
     /// Create a %TntConfig object with default configuration
     TntConfig();
 
@@ -518,8 +732,12 @@ namespace tnt
     static TntConfig& it();
   };
 
+  /// Deserialization operator for TntConfig::Cache
+  void operator>>= (const cxxtools::SerializationInfo& si, TntConfig::Cache& cache);
   /// Deserialization operator for TntConfig::Mapping
   void operator>>= (const cxxtools::SerializationInfo& si, TntConfig::Mapping& mapping);
+  /// Deserialization operator for TntConfig::Compression
+  void operator>>= (const cxxtools::SerializationInfo& si, TntConfig::Compression& compression);
   /// Deserialization operator for TntConfig::Listener
   void operator>>= (const cxxtools::SerializationInfo& si, TntConfig::Listener& listener);
   /// Deserialization operator for TntConfig::SslListener
@@ -152,6 +152,13 @@ namespace tnt
       /// Tells whether a shutdown request was initiated
       static bool shouldStop();
 
+      /** Registers a function, which the timer thread calls about once per second
+
+          The function must return quickly. It is used for housekeeping,
+          which should not be done while answering requests.
+       */
+      static void addTimerCallback(void (*callback)());
+
       /// Get the minimum number of worker threads
       unsigned getMinThreads() const;
 
@@ -42,6 +42,10 @@ namespace tnt
       std::streambuf::int_type underflow();
       int sync();
 
+      // escapes whole blocks and passes runs without special characters
+      // to the sink unchanged
+      std::streamsize xsputn(const char* s, std::streamsize n);
+
     public:
       UrlEscStreamBuf(std::streambuf* sink)
         : _sink(sink)
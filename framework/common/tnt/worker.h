@@ -36,6 +36,7 @@
 #include <tnt/comploader.h>
 #include <tntnetimpl.h>
 #include <tnt/scope.h>
+#include <tnt/singleflight.h>
 #include <tnt/threadcontext.h>
 
 /// @cond internal
@@ -44,6 +45,7 @@ namespace tnt
 {
   class HttpRequest;
   class HttpReply;
+  class Maptarget;
 
   class Worker : public cxxtools::DetachedThread, private ThreadContext
   {
@@ -52,6 +54,7 @@ namespace tnt
       static cxxtools::Mutex _mutex;
       TntnetImpl& _application;
       static Comploader _comploader;
+      static SingleFlight _singleFlight;
 
       Scope _threadScope;
       pthread_t _threadId;
@@ -60,8 +63,20 @@ namespace tnt
 
       static workers_type _workers;
 
-      bool processRequest(HttpRequest& request, std::iostream& socket, unsigned keepAliveCount);
+      // set for a request, which got the reply of an identical request or
+      // failed to get it
+      bool _resumed;
+      StoredReplyPtr _sharedReply;
+      // set by dispatch, when the request waits for an identical request
+      std::string _parkKey;
+
+      bool processJob(Jobqueue::JobPtr& j, std::iostream& socket);
+      bool processRequest(HttpRequest& request, std::iostream& socket, int socketFd, unsigned keepAliveCount);
+      bool continueRequest(HttpRequest& request, std::iostream& socket);
+      unsigned checkExpectation(HttpRequest& request, HttpReply& reply);
+      Component* findComponent(const Maptarget& ci);
       void logRequest(const HttpRequest& request, const HttpReply& reply, unsigned httpReturn);
+      void sendStoredReply(const HttpRequest& request, HttpReply& reply, unsigned httpReturn);
       void healthCheck(time_t currentTime);
 
       // thread context methods
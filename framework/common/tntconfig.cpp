@@ -57,6 +57,16 @@ namespace tnt
 
   }
 
+  void operator>>= (const cxxtools::SerializationInfo& si, TntConfig::Cache& cache)
+  {
+    si.getMember("maxAge") >>= cache.maxAge;
+    si.getMember("headers", cache.headers);
+    si.getMember("params", cache.params);
+    si.getMember("cookies", cache.cookies);
+    si.getMember("serveStale", cache.serveStale);
+    si.getMember("maxEntries", cache.maxEntries);
+  }
+
   void operator>>= (const cxxtools::SerializationInfo& si, TntConfig::Mapping& mapping)
   {
     si.getMember("target") >>= mapping.target;
@@ -78,6 +88,11 @@ namespace tnt
         *psi >>= mapping.httpreturn;
     }
 
+    si.getMember("etag", mapping.etag);
+    si.getMember("replyBufferLimit", mapping.replyBufferLimit);
+    si.getMember("cache", mapping.cache);
+    si.getMember("coalesce", mapping.coalesce);
+
     bool ssl;
     if (si.getMember("ssl", ssl))
       mapping.ssl = ssl ? SSL_YES : SSL_NO;
@@ -96,6 +111,13 @@ namespace tnt
     }
   }
 
+  void operator>>= (const cxxtools::SerializationInfo& si, TntConfig::Compression& compression)
+  {
+    si.getMember("encoding") >>= compression.encoding;
+    si.getMember("level", compression.level);
+    si.getMember("minSize", compression.minSize);
+  }
+
   void operator>>= (const cxxtools::SerializationInfo& si, TntConfig::Listener& listener)
   {
     si.getMember("ip", listener.ip);
@@ -162,6 +184,8 @@ namespace tnt
     }
 
     si.getMember("maxRequestSize", config.maxRequestSize);
+    si.getMember("inflateRequestBody", config.inflateRequestBody);
+    si.getMember("maxInflateRatio", config.maxInflateRatio);
     si.getMember("maxRequestTime", config.maxRequestTime);
     si.getMember("user", config.user);
     si.getMember("group", config.group);
@@ -184,8 +208,21 @@ namespace tnt
     si.getMember("listenRetry", config.listenRetry);
     si.getMember("enableCompression", config.enableCompression);
     si.getMember("minCompressSize", config.minCompressSize);
+    si.getMember("compressions", config.compressions);
+    si.getMember("adaptiveCompression", config.adaptiveCompression);
+    si.getMember("compressionCpuLimit", config.compressionCpuLimit);
+    si.getMember("compressionLanRtt", config.compressionLanRtt);
     si.getMember("mimeDb", config.mimeDb);
     si.getMember("maxUrlMapCache", config.maxUrlMapCache);
+    si.getMember("maxCachedReplies", config.maxCachedReplies);
+    si.getMember("maxCachedChunks", config.maxCachedChunks);
+    si.getMember("replyBufferLimit", config.replyBufferLimit);
+    si.getMember("staticCacheSize", config.staticCacheSize);
+    si.getMember("staticCacheOpenFiles", config.staticCacheOpenFiles);
+    si.getMember("staticCacheTtl", config.staticCacheTtl);
+    si.getMember("staticMemoryCache", config.staticMemoryCache);
+    si.getMember("staticMemoryCacheMaxFile", config.staticMemoryCacheMaxFile);
+    si.getMember("fragmentCacheSize", config.fragmentCacheSize);
     si.getMember("defaultContentType", config.defaultContentType);
     si.getMember("accessLog", config.accessLog);
     si.getMember("errorLog", config.errorLog);
@@ -197,6 +234,7 @@ namespace tnt
     si.getMember("logging", config.logConfiguration);
     si.getMember("sslCipherList", config.sslCipherList);
     si.getMember("sslProtocols", config.sslProtocols);
+    si.getMember("sslKtls", config.sslKtls);
 
     config.config = si;
 
@@ -215,6 +253,8 @@ namespace tnt
 
   TntConfig::TntConfig()
     : maxRequestSize(0),
+      inflateRequestBody(false),
+      maxInflateRatio(100),
       maxRequestTime(600),
       daemon(false),
       minThreads(5),
@@ -231,13 +271,37 @@ namespace tnt
       listenRetry(5),
       enableCompression(true),
       minCompressSize(1024),
+      adaptiveCompression(false),
+      compressionCpuLimit(90),
+      compressionLanRtt(0),
       mimeDb("/etc/mime.types"),
       maxUrlMapCache(8192),
+      maxCachedReplies(4),
+      maxCachedChunks(8),
+      replyBufferLimit(0),
+      staticCacheSize(1024),
+      staticCacheOpenFiles(64),
+      staticCacheTtl(2000),
+      staticMemoryCache(0),
+      staticMemoryCacheMaxFile(65536),
+      fragmentCacheSize(16777216),
       defaultContentType("text/html; charset=UTF-8"),
       timerSleep(10),
       server("Tntnet/" VERSION),
-      reuseAddress(true)
-    { }
+      reuseAddress(true),
+      sslKtls(true)
+  {
+#ifdef WITH_BROTLI
+    compressions.push_back(Compression());
+    compressions.back().encoding = "br";
+#endif
+#ifdef WITH_ZSTD
+    compressions.push_back(Compression());
+    compressions.back().encoding = "zstd";
+#endif
+    compressions.push_back(Compression());
+    compressions.back().encoding = "gzip";
+  }
 
   TntConfig& TntConfig::it()
   {
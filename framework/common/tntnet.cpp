@@ -114,6 +114,11 @@ namespace tnt
     return TntnetImpl::shouldStop();
   }
 
+  void Tntnet::addTimerCallback(void (*callback)())
+  {
+    TntnetImpl::addTimerCallback(callback);
+  }
+
   Mapping& Tntnet::mapUrl(const std::string& url, const std::string& ci)
   {
     return _impl->mapUrl(url, Maptarget(ci));
@@ -32,6 +32,7 @@
 #include "tnt/listener.h"
 #include "tnt/http.h"
 #include "tnt/httpreply.h"
+#include "tnt/compressiongovernor.h"
 #include "tnt/sessionscope.h"
 #include "tnt/tntconfig.h"
 #include "tnt/util.h"
@@ -39,6 +40,8 @@
 #include <cxxtools/net/tcpstream.h>
 #include <cxxtools/log.h>
 
+#include <algorithm>
+#include <sstream>
 #include <unistd.h>
 #include <signal.h>
 
@@ -59,6 +62,11 @@ namespace tnt
         if (!it->pathinfo.empty())
           ci.setPathInfo(it->pathinfo);
         ci.setHttpReturn(it->httpreturn);
+        ci.setEtag(it->etag);
+        ci.setReplyBufferLimit(it->replyBufferLimit);
+        if (it->cache.maxAge.totalMSecs() > 0)
+          ci.setReplyCache(dis.addReplyCache(it->cache));
+        ci.setCoalesce(it->coalesce);
         ci.setArgs(it->args);
         dis.addUrlMapEntry(it->vhost, it->url, it->method, it->ssl, ci);
       }
@@ -83,6 +91,8 @@ namespace tnt
   bool TntnetImpl::_stop = false;
   cxxtools::Mutex TntnetImpl::_timeStopMutex;
   cxxtools::Condition TntnetImpl::_timerStopCondition;
+  TntnetImpl::TimerCallbacksType TntnetImpl::_timerCallbacks;
+  cxxtools::Mutex TntnetImpl::_timerCallbacksMutex;
 
   TntnetImpl::listeners_type TntnetImpl::_allListeners;
 
@@ -296,22 +306,70 @@ namespace tnt
   {
     log_debug("timer thread");
 
+    // The timer wakes up every second to refresh the date sent in replies.
+    // The other tasks run every timerSleep.
+    const cxxtools::Timespan dateInterval = cxxtools::Seconds(1);
+    cxxtools::Timespan sinceCheck = cxxtools::Seconds(0);
+
     while (true)
     {
+      HttpMessage::refreshHtdateCache();
+
+      TimerCallbacksType callbacks;
+      {
+        cxxtools::MutexLock lock(_timerCallbacksMutex);
+        callbacks = _timerCallbacks;
+      }
+
+      for (TimerCallbacksType::const_iterator it = callbacks.begin(); it != callbacks.end(); ++it)
+        (*it)();
+
+      if (TntConfig::it().adaptiveCompression)
+        CompressionGovernor::sample(_queue.size());
+
       {
+        cxxtools::Timespan wait = TntConfig::it().timerSleep - sinceCheck;
+        if (wait > dateInterval)
+          wait = dateInterval;
+
         cxxtools::MutexLock timeStopLock(_timeStopMutex);
-        if (_stop || _timerStopCondition.wait(timeStopLock, TntConfig::it().timerSleep))
+        if (_stop || _timerStopCondition.wait(timeStopLock, wait))
           break;
+
+        sinceCheck += wait;
       }
 
-      getScopemanager().checkSessionTimeout();
-      Worker::timer();
+      if (sinceCheck >= TntConfig::it().timerSleep)
+      {
+        sinceCheck = cxxtools::Seconds(0);
+        getScopemanager().checkSessionTimeout();
+        Worker::timer();
+
+        if (TntConfig::it().adaptiveCompression)
+        {
+          CompressionGovernor::Statistics st = CompressionGovernor::getStatistics();
+          std::ostringstream decisions;
+          for (unsigned n = 0; n < CompressionGovernor::decisionCount; ++n)
+            decisions << ", " << CompressionGovernor::decisionName(static_cast<CompressionGovernor::Decision>(n))
+                      << ' ' << st.decisions[n];
+          log_info("compression: cpu load " << st.cpuLoad / 10 << "%, queue " << st.queueDepth << decisions.str());
+        }
+      }
     }
 
+    HttpMessage::clearHtdateCache();
+
     _queue.noWaitThreads.signal();
     _minthreads = _maxthreads = 0;
   }
 
+  void TntnetImpl::addTimerCallback(void (*callback)())
+  {
+    cxxtools::MutexLock lock(_timerCallbacksMutex);
+    if (std::find(_timerCallbacks.begin(), _timerCallbacks.end(), callback) == _timerCallbacks.end())
+      _timerCallbacks.push_back(callback);
+  }
+
   void TntnetImpl::shutdown()
   {
     _stop = true;
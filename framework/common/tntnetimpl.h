@@ -15,6 +15,7 @@
 #include <cxxtools/mutex.h>
 #include <cxxtools/refcounted.h>
 #include <set>
+#include <vector>
 #include <fstream>
 
 namespace tnt
@@ -53,6 +54,10 @@ namespace tnt
       static cxxtools::Condition _timerStopCondition;
       static cxxtools::Mutex _timeStopMutex;
 
+      typedef std::vector<void (*)()> TimerCallbacksType;
+      static TimerCallbacksType _timerCallbacks;
+      static cxxtools::Mutex _timerCallbacksMutex;
+
       // non copyable and assignable
       TntnetImpl(const TntnetImpl&);
       TntnetImpl& operator= (const TntnetImpl&);
@@ -72,6 +77,7 @@ namespace tnt
 
       static void shutdown();
       static bool shouldStop()                { return _stop; }
+      static void addTimerCallback(void (*callback)());
 
       Jobqueue&   getQueue()                  { return _queue; }
       Poller&     getPoller()                 { return _poller; }
@@ -28,24 +28,137 @@
 
 
 #include "tnt/urlescostream.h"
-#include <sstream>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 namespace tnt
 {
+  namespace
+  {
+    inline bool needsEscape(char c)
+    {
+      unsigned char ch = static_cast<unsigned char>(c);
+      return ch <= 32 || ch >= 127 || ch == '%' || ch == '+' || ch == '=' || ch == '&';
+    }
+
+    // Returns the first character in [b, e), which must be escaped, or e.
+    // The characters from 33 to 126 are the only ones, which are greater
+    // than 32 and less than 127 in signed comparison too.
+    const char* findEscape(const char* b, const char* e)
+    {
+#if defined(__AVX2__)
+      {
+        const __m256i lo = _mm256_set1_epi8(32);
+        const __m256i hi = _mm256_set1_epi8(127);
+        const __m256i percent = _mm256_set1_epi8('%');
+        const __m256i plus = _mm256_set1_epi8('+');
+        const __m256i eq = _mm256_set1_epi8('=');
+        const __m256i amp = _mm256_set1_epi8('&');
+
+        for (; e - b >= 32; b += 32)
+        {
+          __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+          __m256i ok = _mm256_and_si256(_mm256_cmpgt_epi8(v, lo), _mm256_cmpgt_epi8(hi, v));
+          __m256i special = _mm256_or_si256(
+                              _mm256_or_si256(_mm256_cmpeq_epi8(v, percent), _mm256_cmpeq_epi8(v, plus)),
+                              _mm256_or_si256(_mm256_cmpeq_epi8(v, eq), _mm256_cmpeq_epi8(v, amp)));
+          unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_andnot_si256(special, ok)));
+          if (mask)
+            return b + __builtin_ctz(mask);
+        }
+      }
+#endif
+
+#if defined(__SSE2__)
+      {
+        const __m128i lo = _mm_set1_epi8(32);
+        const __m128i hi = _mm_set1_epi8(127);
+        const __m128i percent = _mm_set1_epi8('%');
+        const __m128i plus = _mm_set1_epi8('+');
+        const __m128i eq = _mm_set1_epi8('=');
+        const __m128i amp = _mm_set1_epi8('&');
+
+        for (; e - b >= 16; b += 16)
+        {
+          __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+          __m128i ok = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi));
+          __m128i special = _mm_or_si128(
+                              _mm_or_si128(_mm_cmpeq_epi8(v, percent), _mm_cmpeq_epi8(v, plus)),
+                              _mm_or_si128(_mm_cmpeq_epi8(v, eq), _mm_cmpeq_epi8(v, amp)));
+          unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_andnot_si128(special, ok))) & 0xffff;
+          if (mask)
+            return b + __builtin_ctz(mask);
+        }
+      }
+#endif
+
+      for (; b < e; ++b)
+        if (needsEscape(*b))
+          return b;
+
+      return e;
+    }
+
+    inline void putEscaped(std::streambuf* sink, char c)
+    {
+      static const char hex[] = "0123456789ABCDEF";
+      unsigned char ch = static_cast<unsigned char>(c);
+      if (ch == ' ')
+        sink->sputc('+');
+      else
+      {
+        char buffer[3] = { '%', hex[(ch >> 4) & 0x0f], hex[ch & 0x0f] };
+        sink->sputn(buffer, 3);
+      }
+    }
+
+    inline void putEscaped(std::string& s, char c)
+    {
+      static const char hex[] = "0123456789ABCDEF";
+      unsigned char ch = static_cast<unsigned char>(c);
+      if (ch == ' ')
+        s += '+';
+      else
+      {
+        s += '%';
+        s += hex[(ch >> 4) & 0x0f];
+        s += hex[ch & 0x0f];
+      }
+    }
+  }
+
   std::streambuf::int_type UrlEscStreamBuf::overflow(std::streambuf::int_type ch)
   {
-    static const char hex[] = "0123456789ABCDEF";
-    if (ch > 32 && ch < 127 && ch != '%' && ch != '+' && ch != '=' && ch != '&')
-      _sink->sputc(ch);
-    else if (ch == ' ')
-      _sink->sputc('+');
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+      return traits_type::not_eof(ch);
+
+    char c = traits_type::to_char_type(ch);
+    if (needsEscape(c))
+      putEscaped(_sink, c);
     else
+      _sink->sputc(c);
+    return 0;
+  }
+
+  std::streamsize UrlEscStreamBuf::xsputn(const char* s, std::streamsize n)
+  {
+    const char* e = s + n;
+    while (s < e)
     {
-      _sink->sputc('%');
-      _sink->sputc(hex[(ch >> 4) & 0x0f]);
-      _sink->sputc(hex[ch & 0x0f]);
+      const char* p = findEscape(s, e);
+      if (p > s)
+        _sink->sputn(s, p - s);
+
+      if (p == e)
+        break;
+
+      putEscaped(_sink, *p);
+      s = p + 1;
     }
-    return 0;
+
+    return n;
   }
 
   std::streambuf::int_type UrlEscStreamBuf::underflow()
@@ -56,10 +169,23 @@ namespace tnt
 
   std::string urlEscape(const std::string& str)
   {
-    std::ostringstream s;
-    UrlEscOstream e(s);
-    e << str;
-    return s.str();
+    std::string ret;
+    ret.reserve(str.size() + str.size() / 4);
+
+    const char* s = str.data();
+    const char* e = s + str.size();
+    while (s < e)
+    {
+      const char* p = findEscape(s, e);
+      ret.append(s, p);
+
+      if (p == e)
+        break;
+
+      putEscaped(ret, *p);
+      s = p + 1;
+    }
+
+    return ret;
   }
 }
-
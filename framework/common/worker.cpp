@@ -30,6 +30,8 @@
 #include "tnt/worker.h"
 #include "tnt/dispatcher.h"
 #include "tnt/job.h"
+#include "tnt/etag.h"
+#include "tnt/replycache.h"
 #include <tnt/httprequest.h>
 #include <tnt/httpreply.h>
 #include <tnt/httperror.h>
@@ -58,6 +60,7 @@ namespace
   static const char stateStarting[]          = "0 starting";
   static const char stateWaitingForJob[]     = "1 waiting for job";
   static const char stateParsing[]           = "2 parsing request";
+  static const char stateExpectContinue[]    = "2 expect continue";
   static const char statePostParsing[]       = "3 post parsing";
   static const char stateDispatch[]          = "4 dispatch";
   static const char stateProcessingRequest[] = "5 processing request";
@@ -65,6 +68,91 @@ namespace
   static const char stateSendReply[]         = "7 send reply";
   static const char stateSendError[]         = "8 send error";
   static const char stateStopping[]          = "9 stopping";
+
+  // A reply, which the client already has according to the validators
+  // If-None-Match or If-Modified-Since, is answered with 304 and no body.
+  bool isNotModified(const tnt::HttpRequest& request, tnt::HttpReply& reply)
+  {
+    if (!request.isMethodGET() && !request.isMethodHEAD())
+      return false;
+
+    // If-Modified-Since is ignored, when If-None-Match is sent (RFC 7232)
+    const char* ifNoneMatch = request.getHeader(tnt::httpheader::ifNoneMatch, 0);
+    if (ifNoneMatch)
+    {
+      const char* etag = reply.getHeader(tnt::httpheader::etag, 0);
+      return etag ? tnt::etagMatches(ifNoneMatch, etag)
+                  : reply.bodyEtagMatches(ifNoneMatch);
+    }
+
+    const char* ifModifiedSince = request.getHeader(tnt::httpheader::ifModifiedSince, 0);
+    const char* lastModified = reply.getHeader(tnt::httpheader::lastModified, 0);
+    time_t since, modified;
+    return ifModifiedSince && lastModified
+        && tnt::HttpMessage::parseHtdate(ifModifiedSince, since)
+        && tnt::HttpMessage::parseHtdate(lastModified, modified)
+        && modified <= since;
+  }
+
+  // Sets the ETag of the body, when enabled for the mapping.
+  void tagBody(const tnt::Maptarget& ci, const tnt::HttpRequest& request,
+    tnt::HttpReply& reply, unsigned http_return)
+  {
+    if (http_return == tnt::HTTP_OK
+      && !reply.isChunkedEncoding()
+      && ci.getEtag()
+      && !reply.hasHeader(tnt::httpheader::etag)
+      && (request.isMethodGET()
+          || (request.isMethodHEAD() && reply.getContentSize() > 0)))
+    {
+      // a component may skip the body of a HEAD request, which
+      // would give a wrong tag
+      reply.setBodyEtag();
+    }
+  }
+
+  // Turns the reply into 304, when the client has it already.
+  void checkNotModified(const tnt::HttpRequest& request, tnt::HttpReply& reply,
+    unsigned& http_return, const char*& http_msg)
+  {
+    if (http_return == tnt::HTTP_OK
+      && !reply.isChunkedEncoding()
+      && isNotModified(request, reply))
+    {
+      log_debug("not modified");
+      http_return = tnt::HTTP_NOT_MODIFIED;
+      http_msg = tnt::HttpReturn::httpMessage(http_return);
+      reply.resetContent();
+    }
+  }
+
+  // Completes the session handling, before a reply, which outgrew its
+  // buffer limit, sends the headers; the session cookie would be lost
+  // otherwise.
+  class PostCallOnSpill : public tnt::HttpReply::SpillListener
+  {
+      tnt::ScopeManager& _scopeManager;
+      tnt::HttpRequest& _request;
+      const std::string& _appname;
+      bool _called;
+
+    public:
+      PostCallOnSpill(tnt::ScopeManager& scopeManager, tnt::HttpRequest& request,
+          const std::string& appname)
+        : _scopeManager(scopeManager),
+          _request(request),
+          _appname(appname),
+          _called(false)
+        { }
+
+      void onSpill(tnt::HttpReply& reply)
+      {
+        _scopeManager.postCall(_request, reply, _appname);
+        _called = true;
+      }
+
+      bool called() const  { return _called; }
+  };
 }
 
 namespace tnt
@@ -72,12 +160,14 @@ namespace tnt
   cxxtools::Mutex Worker::_mutex;
   Worker::workers_type Worker::_workers;
   Comploader Worker::_comploader;
+  SingleFlight Worker::_singleFlight;
 
   Worker::Worker(TntnetImpl& app)
     : _application(app),
       _threadId(0),
       _state(stateStarting),
-      _lastWaitTime(0)
+      _lastWaitTime(0),
+      _resumed(false)
   {
     cxxtools::MutexLock lock(_mutex);
     _workers.insert(this);
@@ -114,32 +204,57 @@ namespace tnt
           _state = stateParsing;
           try
           {
-            j->getParser().parse(socket);
+            bool bodyRejected = false;
+
+            // a resumed job was parsed before it was parked
+            if (!j->isResumed())
+            {
+              j->getParser().parse(socket);
+
+              if (j->getParser().expectContinue() && socket.good())
+              {
+                _state = stateExpectContinue;
+                if (continueRequest(j->getRequest(), socket))
+                {
+                  j->getParser().continueBody();
+                  _state = stateParsing;
+                  j->getParser().parse(socket);
+                }
+                else
+                  bodyRejected = true;
+              }
+            }
+
             _state = statePostParsing;
 
-            if (socket.eof())
+            if (bodyRejected)
+              log_debug("request body rejected");
+            else if (socket.eof())
               log_debug("eof");
             else if (j->getParser().failed())
             {
               _state = stateSendError;
-              log_warn("bad request");
+              unsigned httpCode = j->getParser().getHttpCode();
+              if (httpCode != HTTP_REQUEST_ENTITY_TOO_LARGE)
+                httpCode = HTTP_BAD_REQUEST;
+              const char* httpMessage = HttpReturn::httpMessage(httpCode);
+              log_warn(httpMessage);
               tnt::HttpReply errorReply(socket);
               errorReply.setVersion(1, 0);
               errorReply.setContentType("text/html");
               errorReply.setKeepAliveCounter(0);
-              errorReply.out() << "<html><body><h1>Error</h1><p>bad request</p></body></html>\n";
-              errorReply.sendReply(400, "Bad Request");
-              logRequest(j->getRequest(), errorReply, 400);
+              errorReply.out() << "<html><body><h1>Error</h1><p>" << httpMessage << "</p></body></html>\n";
+              errorReply.sendReply(httpCode, httpMessage);
+              logRequest(j->getRequest(), errorReply, httpCode);
             }
             else if (socket.fail())
               log_debug("socket failed");
             else
             {
-              j->getRequest().doPostParse();
+              if (!j->isResumed())
+                j->getRequest().doPostParse();
 
-              j->setWrite();
-              keepAlive = processRequest(j->getRequest(), socket,
-                j->decrementKeepAliveCounter());
+              keepAlive = processJob(j, socket);
 
               if (keepAlive)
               {
@@ -165,6 +280,7 @@ namespace tnt
                     if (::poll(&fd, 1, TntConfig::it().socketReadTimeout) == 0)
                     {
                       log_debug("pass job to poll-thread");
+                      j->releaseRequestState();
                       _application.getPoller().addIdleJob(j);
                       keepAlive = false;
                     }
@@ -193,6 +309,7 @@ namespace tnt
       }
       catch (const cxxtools::IOTimeout& e)
       {
+        j->releaseRequestState();
         _application.getPoller().addIdleJob(j);
       }
       catch (const cxxtools::net::AcceptTerminated&)
@@ -218,8 +335,41 @@ namespace tnt
       << " waiting threads");
   }
 
+  bool Worker::processJob(Jobqueue::JobPtr& j, std::iostream& socket)
+  {
+    unsigned keepAliveCount = j->isResumed() ? j->getKeepAliveCounter()
+                                             : j->decrementKeepAliveCounter();
+
+    while (true)
+    {
+      _resumed = j->isResumed();
+      _sharedReply = j->getSharedReply();
+      _parkKey.clear();
+
+      j->setWrite();
+      bool keepAlive = processRequest(j->getRequest(), socket,
+        j->getRequest().isSsl() ? -1 : j->getFd(),
+        keepAliveCount);
+
+      _sharedReply = StoredReplyPtr();
+
+      if (_parkKey.empty())
+        return keepAlive;
+
+      // The job is resumed by another thread, so it must not be touched
+      // any more after parking.
+      if (_singleFlight.park(_parkKey, j))
+      {
+        log_debug("request parked");
+        return false;
+      }
+
+      log_debug("identical request finished already; process request");
+    }
+  }
+
   bool Worker::processRequest(HttpRequest& request, std::iostream& socket,
-         unsigned keepAliveCount)
+         int socketFd, unsigned keepAliveCount)
   {
     // log message
     log_info("request " << request.getMethod_cstr() << ' ' << request.getQuery()
@@ -229,6 +379,7 @@ namespace tnt
     // create reply-object
     HttpReply reply(socket);
     reply.setVersion(request.getMajorVersion(), request.getMinorVersion());
+    reply.setSocketFd(socketFd);
     if (request.isMethodHEAD())
       reply.setHeadRequest();
 
@@ -296,6 +447,131 @@ namespace tnt
     return keepAliveCount > 0;
   }
 
+  bool Worker::continueRequest(HttpRequest& request, std::iostream& socket)
+  {
+    log_debug("check expectation for " << request.getMethod_cstr() << ' ' << request.getUrl()
+      << " with " << request.getContentSize() << " bytes body");
+
+    HttpReply reply(socket);
+    reply.setVersion(request.getMajorVersion(), request.getMinorVersion());
+
+    unsigned http_return;
+    const char* http_msg;
+    std::string msg;
+    try
+    {
+      try
+      {
+        http_return = checkExpectation(request, reply);
+        http_msg = HttpReturn::httpMessage(http_return);
+      }
+      catch (const HttpReturn& e)
+      {
+        http_return = e.getReturnCode();
+        msg = e.getMessage();
+        http_msg = msg.c_str();
+      }
+      catch (const HttpError& e)
+      {
+        throw;
+      }
+      catch (const std::exception& e)
+      {
+        throw HttpError(HTTP_INTERNAL_SERVER_ERROR, e.what());
+      }
+      catch (...)
+      {
+        log_error("unknown exception");
+        throw HttpError(HTTP_INTERNAL_SERVER_ERROR, "unknown error");
+      }
+    }
+    catch (const HttpError& e)
+    {
+      log_warn("http-Error: " << e.what());
+      for (HttpMessage::header_type::const_iterator it = e.header_begin();
+           it != e.header_end(); ++it)
+        reply.setHeader(it->first, it->second);
+
+      reply.out() << e.getBody() << '\n';
+      http_return = e.getErrcode();
+      msg = e.getErrmsg();
+      http_msg = msg.c_str();
+    }
+
+    if (http_return == HTTP_CONTINUE || http_return == DEFAULT)
+    {
+      log_debug("send 100 Continue");
+      socket << "HTTP/" << request.getMajorVersion() << '.' << request.getMinorVersion()
+             << " 100 Continue\r\n\r\n" << std::flush;
+      return true;
+    }
+
+    // The body was not read, so the connection can't be reused.
+    log_info("request " << request.getMethod_cstr() << ' ' << request.getQuery()
+      << " rejected before reading body, returncode " << http_return << ' ' << http_msg);
+    reply.setKeepAliveCounter(0);
+    reply.sendReply(http_return, http_msg);
+    logRequest(request, reply, http_return);
+
+    return false;
+  }
+
+  unsigned Worker::checkExpectation(HttpRequest& request, HttpReply& reply)
+  {
+    const std::string& url = request.getUrl();
+
+    if (!HttpRequest::checkUrl(url))
+    {
+      log_info("illegal url <" << url << '>');
+      throw HttpError(HTTP_BAD_REQUEST, "illegal url");
+    }
+
+    request.setThreadContext(this);
+
+    Dispatcher::PosType pos(_application.getDispatcher(), request);
+    Maptarget ci;
+    while (pos.getNext(ci))
+    {
+      Component* comp = findComponent(ci);
+      if (comp == 0)
+        continue;
+
+      request.setPathInfo(ci.hasPathInfo() ? ci.getPathInfo() : url);
+      request.setArgs(ci.getArgs());
+
+      unsigned http_return = comp->expectContinue(request, reply);
+      if (http_return != DECLINED)
+        return http_return;
+
+      log_debug("component " << ci << " declined expectation");
+    }
+
+    // clients get a 404 before sending the body
+    throw NotFoundException(url, request.getHost());
+  }
+
+  Component* Worker::findComponent(const Maptarget& ci)
+  {
+    Component* comp = 0;
+
+    if (ci.libname == _application.getAppName())
+    {
+      // if the libname is the app name look first, if the component is
+      // linked directly
+      Compident cii = ci;
+      cii.libname = std::string();
+      comp = _comploader.findComp(cii, _application.getDispatcher());
+    }
+
+    if (comp == 0)
+      comp = _comploader.findComp(ci, _application.getDispatcher());
+
+    if (comp == 0)
+      log_debug("component " << ci << " not found - try next mapping");
+
+    return comp;
+  }
+
   void Worker::logRequest(const HttpRequest& request, const HttpReply& reply, unsigned httpReturn)
   {
     static cxxtools::atomic_t waitCount = 0;
@@ -390,112 +666,148 @@ namespace tnt
     request.setThreadContext(this);
 
     Dispatcher::PosType pos(_application.getDispatcher(), request);
-    while (true)
+    Maptarget ci;
+    while (pos.getNext(ci))
     {
       _state = stateDispatch;
 
-      // pos.getNext() throws NotFoundException at end
-      Maptarget ci = pos.getNext();
-      try
+      Component* comp = findComponent(ci);
+      if (comp == 0)
+        continue;
+
+      request.setPathInfo(ci.hasPathInfo() ? ci.getPathInfo() : url);
+      request.setArgs(ci.getArgs());
+
+      unsigned bufferLimit = ci.getReplyBufferLimit() >= 0
+        ? static_cast<unsigned>(ci.getReplyBufferLimit())
+        : TntConfig::it().replyBufferLimit;
+      reply.setBufferLimit(bufferLimit);
+
+      ReplyCache::Lookup cached(ci.getReplyCache(), request);
+      if (cached.found())
       {
-        Component* comp = 0;
-        try
-        {
-          if (ci.libname == _application.getAppName())
-          {
-            // if the libname is the app name look first, if the component is
-            // linked directly
-            try
-            {
-              Compident cii = ci;
-              cii.libname = std::string();
-              comp = &_comploader.fetchComp(cii, _application.getDispatcher());
-            }
-            catch (const NotFoundException&)
-            {
-              // if the component is not found in the binary, fetchComp throws
-              // NotFoundException and comp remains 0.
-              // so we can ignore the exceptioni and just continue
-            }
-          }
+        log_debug("send cached reply");
+        sendStoredReply(request, reply, cached.fill(request, reply));
+        cached.storeVariant(reply);
+        return;
+      }
 
-          if (comp == 0)
-            comp = &_comploader.fetchComp(ci, _application.getDispatcher());
-        }
-        catch (const NotFoundException& e)
+      if (ci.getCoalesce() && _sharedReply.getPointer() != 0)
+      {
+        log_debug("send reply of identical request");
+        sendStoredReply(request, reply, _sharedReply->fill(request, reply));
+        _sharedReply->addVariant(reply);
+        return;
+      }
+
+      SingleFlight::Leader leader;
+      if (ci.getCoalesce() && !_resumed && SingleFlight::isCoalescable(request))
+      {
+        std::string key = SingleFlight::makeKey(ci, request);
+        if (!leader.lead(_singleFlight, key, _application.getQueue()))
         {
-          log_debug("NotFoundException catched - url " << e.getUrl() << " try next mapping");
-          continue;
+          log_debug("identical request in progress; park request");
+          _parkKey = key;
+          return;
         }
+      }
 
-        request.setPathInfo(ci.hasPathInfo() ? ci.getPathInfo() : url);
-        request.setArgs(ci.getArgs());
+      std::string appname = _application.getAppName().empty() ? ci.libname : _application.getAppName();
 
-        std::string appname = _application.getAppName().empty() ? ci.libname : _application.getAppName();
+      _application.getScopemanager().preCall(request, appname);
 
-        _application.getScopemanager().preCall(request, appname);
+      PostCallOnSpill postCallOnSpill(_application.getScopemanager(), request, appname);
+      reply.setBufferLimit(bufferLimit, &postCallOnSpill);
 
-        _state = stateProcessingRequest;
-        unsigned http_return;
-        const char* http_msg;
-        std::string msg;
-        try
-        {
-          http_return = comp->topCall(request, reply, request.getQueryParams());
-          if (http_return == DEFAULT)
-            http_return = ci.getHttpReturn();
+      // the component may read the parameters through cxxtools::QueryParams
+      if (!comp->lazyQueryParams())
+        request.parseQueryParams();
 
-          http_msg = HttpReturn::httpMessage(http_return);
-        }
-        catch (const HttpReturn& e)
+      _state = stateProcessingRequest;
+      unsigned http_return;
+      const char* http_msg;
+      std::string msg;
+      try
+      {
+        http_return = comp->topCall(request, reply, request.getQueryParams());
+        if (http_return == DEFAULT)
+          http_return = ci.getHttpReturn();
+
+        http_msg = HttpReturn::httpMessage(http_return);
+      }
+      catch (const HttpReturn& e)
+      {
+        http_return = e.getReturnCode();
+        msg = e.getMessage();
+        http_msg = msg.c_str();
+      }
+
+      if (http_return != DECLINED)
+      {
+        if (reply.isDirectMode())
         {
-          http_return = e.getReturnCode();
-          msg = e.getMessage();
-          http_msg = msg.c_str();
+          log_info("request " << request.getMethod_cstr() << ' ' << request.getQuery() << " ready, returncode " << http_return << ' ' << http_msg);
+          _state = stateFlush;
+          // finishes a compressed stream and flushes the socket
+          reply.sendReply(http_return, http_msg);
         }
-
-        if (http_return != DECLINED)
+        else
         {
-          if (reply.isDirectMode())
-          {
-            log_info("request " << request.getMethod_cstr() << ' ' << request.getQuery() << " ready, returncode " << http_return << ' ' << http_msg);
-            _state = stateFlush;
-            reply.out().flush();
-          }
-          else
-          {
-            log_info_if(!reply.isChunkedEncoding(), "request " << request.getMethod_cstr() << ' ' << request.getQuery() << " ready, returncode " << http_return << ' ' << http_msg << " - ContentSize: " << reply.getContentSize());
+          log_info_if(!reply.isChunkedEncoding(), "request " << request.getMethod_cstr() << ' ' << request.getQuery() << " ready, returncode " << http_return << ' ' << http_msg << " - ContentSize: " << reply.getContentSize());
 
+          if (!postCallOnSpill.called())
             _application.getScopemanager().postCall(request, reply, appname);
 
-            _state = stateSendReply;
-            reply.sendReply(http_return, http_msg);
+          tagBody(ci, request, reply, http_return);
+          cached.store(reply, http_return);
+          leader.capture(reply, http_return);
 
-            log_info_if(reply.isChunkedEncoding(), "request " << request.getMethod_cstr() << ' ' << request.getQuery() << " ready, returncode " << http_return << ' ' << http_msg << " - ContentSize: " << reply.chunkedBytesWritten() << " (chunked)");
-          }
+          checkNotModified(request, reply, http_return, http_msg);
 
-          logRequest(request, reply, http_return);
+          _state = stateSendReply;
+          reply.sendReply(http_return, http_msg);
+          cached.storeVariant(reply);
+          leader.land(reply);
 
-          if (reply.out())
-            log_debug("reply sent");
-          else
-          {
-            reply.setKeepAliveCounter(0);
-            log_warn("sending failed");
-          }
-
-          return;
+          log_info_if(reply.isChunkedEncoding(), "request " << request.getMethod_cstr() << ' ' << request.getQuery() << " ready, returncode " << http_return << ' ' << http_msg << " - ContentSize: " << reply.chunkedBytesWritten() << " (chunked)");
         }
+
+        logRequest(request, reply, http_return);
+
+        if (reply.out())
+          log_debug("reply sent");
         else
-          log_debug("component " << ci << " returned DECLINED");
-      }
-      catch (const LibraryNotFound& e)
-      {
-        log_warn("library " << e.getLibname() << " not found");
+        {
+          reply.setKeepAliveCounter(0);
+          log_warn("sending failed");
+        }
+
+        return;
       }
+      else
+        log_debug("component " << ci << " returned DECLINED");
     }
 
-    throw NotFoundException(request.getUrl());
+    throw NotFoundException(url, request.getHost());
+  }
+
+  void Worker::sendStoredReply(const HttpRequest& request, HttpReply& reply, unsigned http_return)
+  {
+    _state = stateSendReply;
+
+    const char* http_msg = HttpReturn::httpMessage(http_return);
+    log_info("request " << request.getMethod_cstr() << ' ' << request.getQuery() << " ready from stored reply, returncode " << http_return << ' ' << http_msg << " - ContentSize: " << reply.getContentSize());
+
+    checkNotModified(request, reply, http_return, http_msg);
+    reply.sendReply(http_return, http_msg);
+
+    logRequest(request, reply, http_return);
+
+    if (!reply.out())
+    {
+      reply.setKeepAliveCounter(0);
+      log_warn("sending failed");
+    }
   }
 
   void Worker::timer()
@@ -50,6 +50,7 @@ namespace tnt
       Empty() { }
 
       virtual unsigned operator() (tnt::HttpRequest&, tnt::HttpReply&, tnt::QueryParams&);
+      virtual bool lazyQueryParams() const  { return true; }
   };
 
   ////////////////////////////////////////////////////////////////////////
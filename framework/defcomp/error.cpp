@@ -51,6 +51,7 @@ namespace tnt
       Error() { }
 
       virtual unsigned operator() (tnt::HttpRequest&, tnt::HttpReply&, tnt::QueryParams&);
+      virtual bool lazyQueryParams() const  { return true; }
   };
 
   ////////////////////////////////////////////////////////////////////////
@@ -60,6 +60,7 @@ namespace tnt
         { }
 
       virtual unsigned operator() (tnt::HttpRequest& request, tnt::HttpReply& reply, tnt::QueryParams& qparam);
+      virtual bool lazyQueryParams() const  { return true; }
   };
 
   ////////////////////////////////////////////////////////////////////////
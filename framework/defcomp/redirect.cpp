@@ -48,6 +48,7 @@ namespace tnt
 
     public:
       virtual unsigned operator() (tnt::HttpRequest&, tnt::HttpReply&, tnt::QueryParams&);
+      virtual bool lazyQueryParams() const  { return true; }
   };
 
   static ComponentFactoryImpl<Redirect> redirectFactory("redirect");
@@ -29,15 +29,20 @@
 
 #include "static.h"
 #include "mimehandler.h"
+#include "staticcache.h"
 #include <tnt/httprequest.h>
 #include <tnt/httpreply.h>
 #include <tnt/httperror.h>
 #include <tnt/http.h>
 #include <tnt/httpheader.h>
+#include <tnt/encoding.h>
 #include <tnt/comploader.h>
+#include <tnt/etag.h>
+#include <tnt/byterange.h>
 #include <tnt/tntconfig.h>
-#include <fstream>
+#include <tnt/ssl.h>
 #include <cxxtools/log.h>
+#include <cxxtools/atomicity.h>
 #include <cxxtools/systemerror.h>
 #include <cxxtools/ioerror.h>
 #include <cxxtools/convert.h>
@@ -45,6 +50,12 @@
 #include <sys/stat.h>
 #include <config.h>
 #include <limits>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <errno.h>
 
 #if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
 #include <fcntl.h>
@@ -54,9 +65,7 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/poll.h>
-#include <unistd.h>
 #include <typeinfo>
-#include <errno.h>
 #endif
 
 log_define("tntnet.static")
@@ -65,143 +74,65 @@ namespace tnt
 {
   namespace
   {
-    bool parseRange(const char* range, off_t& offset, off_t& count)
+    // A boundary for multipart replies, which is unlikely to occur in the file.
+    std::string makeBoundary(const std::string& etag)
     {
-      enum
-      {
-        state_0,
-        state_1,
-        state_from0,
-        state_from,
-        state_from_e,
-        state_to0,
-        state_to,
-        state_e
-      } state = state_0;
-
-      const char* prefix = "bytes=";
-      off_t firstPos = 0;
-      off_t lastPos = count;
-      for (const char* p = range; *p && state != state_e; ++p)
-      {
-        char ch = *p;
-        switch (state)
-        {
-          case state_0:
-          case state_1:
-            if (ch == *prefix)
-            {
-              ++prefix;
-              if (*prefix == '\0')
-              {
-                log_debug("prefix ends");
-                state = state_from0;
-              }
-              else
-                state = state_1;
-            }
-            else if (state == state_1 || ch != ' ')
-              return false;
-            break;
+      static cxxtools::atomic_t counter = 0;
 
-          case state_from0:
-            if (std::isdigit(ch))
-            {
-              log_debug("from found");
-              firstPos = ch - '0';
-              state = state_from;
-            }
-            else if (ch == '-')
-              state = state_to0;
-            else if (ch != ' ')
-              return false;
-            break;
-
-          case state_from:
-            if (std::isdigit(ch))
-              firstPos = firstPos * 10 + ch - '0';
-            else if (ch == '-')
-              state = state_to0;
-            else if (ch == ' ')
-              state = state_from_e;
-            else
-              return false;
-            break;
+      XxHash64 hash(static_cast<uint64_t>(::time(0)));
+      hash.update(etag.data(), etag.size());
+      cxxtools::atomic_t n = cxxtools::atomicIncrement(counter);
+      hash.update(reinterpret_cast<const char*>(&n), sizeof(n));
 
-          case state_from_e:
-            if (ch == '-')
-              state = state_to0;
-            else if (ch != ' ')
-              return false;
-            break;
-
-          case state_to0:
-            if (std::isdigit(ch))
-            {
-              lastPos = ch - '0';
-              state = state_to;
-            }
-            else if (ch != ' ')
-              return false;
-            break;
+      std::ostringstream s;
+      s << "tntnet-" << std::hex << hash.digest();
+      return s.str();
+    }
 
-          case state_to:
-            if (std::isdigit(ch))
-              lastPos = lastPos * 10 + ch - '0';
-            else if (ch == ' ')
-              state = state_e;
-            else
-              return false;
-            break;
+    // Copies a part of a file using pread, so that the shared descriptor
+    // needs no seek.
+    void copyFile(std::ostream& out, const StaticFile& file, off_t offset, off_t count)
+    {
+      char buffer[16384];
+      while (count > 0 && out)
+      {
+        ssize_t n = ::pread(file.getFd(), buffer, std::min(count, static_cast<off_t>(sizeof(buffer))), offset);
+        if (n < 0 && errno == EINTR)
+          continue;
 
-          case state_e: // not reachable but to satisfy the compiler we put it here
-            break;
-        }
-      }
+        if (n <= 0)
+          throw std::runtime_error("failed to send file \"" + file.getPath() + '"');
 
-      switch (state)
-      {
-        case state_to0:
-        case state_to:
-        case state_e:
-          if (lastPos > firstPos)
-          {
-            offset = firstPos;
-            count = lastPos - firstPos;
-            log_debug("firstPos=" << firstPos << " lastPos=" << lastPos << " offset=" << offset << " count=" << count);
-            return true;
-          }
-          break;
-
-        default:
-          break;
+        out.write(buffer, n);
+        offset += n;
+        count -= n;
       }
-
-      return false;
     }
 
-#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
-    class Fdfile
+    // Returns the variant or sibling with the best quality according to
+    // Accept-Encoding or 0.
+    template <typename VariantsType>
+    const typename VariantsType::value_type* selectEncoding(const VariantsType& variants, const Encoding& encoding)
     {
-      private:
-        int _fd;
-      public:
-        Fdfile(const char* pathname, int flags)
-          : _fd(open(pathname, flags))
-        {
-          if (_fd < 0)
-            throw cxxtools::SystemError("open");
-        }
-
-        ~Fdfile()
+      // the variants are in the order of preference, so the first one wins
+      // on equal quality
+      const typename VariantsType::value_type* best = 0;
+      unsigned bestQuality = 0;
+      for (typename VariantsType::const_iterator it = variants.begin();
+        it != variants.end(); ++it)
+      {
+        unsigned quality = encoding.accept(it->encoding);
+        if (quality > bestQuality)
         {
-          if (_fd >= 0)
-            ::close(_fd);
+          best = &*it;
+          bestQuality = quality;
         }
+      }
 
-        int getFd() const { return _fd; }
-    };
+      return best;
+    }
 
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
     void pollout(int fd, int timeout)
     {
       struct pollfd fds;
@@ -226,6 +157,35 @@ namespace tnt
       }
     }
 
+    // Sends a part of a file with sendfile. The descriptor is shared, so
+    // the offset is passed explicitly.
+    void sendFile(cxxtools::net::iostream& out, int fd, off_t offset, off_t count)
+    {
+      off_t end = offset + count;
+      while (offset < end && out)
+      {
+        ssize_t s;
+        do
+        {
+          log_debug("sendfile offset " << offset << " size " << (end - offset));
+          s = ::sendfile(out.getFd(), fd, &offset, end - offset);
+          log_debug("sendfile returns " << s);
+        } while (s < 0 && errno == EINTR);
+
+        if (s < 0 && errno != EAGAIN)
+          throw cxxtools::SystemError("sendfile");
+
+        if (s == 0)
+          throw std::runtime_error("file truncated while sending");
+
+        if (offset < end)
+        {
+          log_debug("poll");
+          pollout(out.getFd(), out.getTimeout());
+        }
+      }
+    }
+
 #endif
   }
 
@@ -271,46 +231,78 @@ namespace tnt
     if (!file.empty() && *file.rbegin() != '/')
       file += '/';
 
+    std::string root = file;
     file += request.getPathInfo();
 
     log_debug("file: " << file);
 
-    struct stat st;
+    StaticEntryPtr entry = StaticCache::it().get(file, root, _handler);
+    StaticFilePtr sf = entry->file;
 
-    bool localEnableGzip = false;
-    if (request.getEncoding().accept("gzip") && TntConfig::it().enableCompression)
+    if (!entry->siblings.empty())
     {
-      std::string gzfile = file + ".gz";
-      if (stat(gzfile.c_str(), &st) == 0 && S_ISREG(st.st_mode))
-      {
-        log_debug("enable compression");
-        file = gzfile;
-        localEnableGzip = true;
-        reply.setHeader(httpheader::contentEncoding, "gzip");
-      }
-      else
+      // the reply depends on Accept-Encoding as soon as a compressed
+      // variant exists, whether it is sent or not
+      reply.setHeader(httpheader::vary, "Accept-Encoding");
+
+      const StaticEntry::Sibling* sibling = selectEncoding(entry->siblings, request.getEncoding());
+      if (sibling)
       {
-        log_debug("compressed file \"" << gzfile << "\" not found or not a regular file");
+        log_debug("send precompressed " << sibling->encoding << " file");
+        sf = sibling->file;
+        reply.setHeader(httpheader::contentEncoding, sibling->encoding);
       }
     }
 
-    if (!localEnableGzip)
+    if (sf.getPointer() == 0)
+    {
+      log_debug("no regular file \"" << file << "\"");
+      return DECLINED;
+    }
+
+    // small files are sent from memory, possibly in a precompressed variant
+    StaticContentPtr content;
+    if (top && sf.getPointer() == entry->file.getPointer())
+      content = StaticCache::it().getContent(entry);
+
+    // The cache keeps only some files open; the others are opened for
+    // this request. The reply describes the file, which is actually sent.
+    if (content.getPointer() == 0 && sf->getFd() < 0)
     {
-      if (stat(file.c_str(), &st) != 0)
+      sf = StaticFile::open(sf->getPath());
+      if (sf.getPointer() == 0)
       {
-        log_debug("can't stat file \"" << file << "\"");
+        log_debug("file \"" << file << "\" vanished");
         return DECLINED;
       }
+    }
+
+    file = sf->getPath();
+    const struct stat& st = sf->getStat();
+
+    const std::string* body = 0;
+    const std::string* etag = &sf->getEtag();
+    if (content.getPointer() != 0)
+    {
+      body = &content->data;
 
-      if (!S_ISREG(st.st_mode))
+      if (!content->variants.empty() && !reply.hasHeader(httpheader::vary))
+        reply.setHeader(httpheader::vary, "Accept-Encoding");
+
+      const StaticContent::Variant* variant = selectEncoding(content->variants, request.getEncoding());
+      if (variant)
       {
-        log_debug("no regular file \"" << file << "\"");
-        return DECLINED;
+        log_debug("send " << variant->encoding << " variant from memory");
+        body = &variant->data;
+        etag = &variant->etag;
+        reply.setHeader(httpheader::contentEncoding, variant->encoding);
       }
     }
 
-    off_t offset = 0;
-    off_t count = st.st_size;
+    off_t size = body ? static_cast<off_t>(body->size()) : st.st_size;
+    ByteRangesType ranges;                    // the parts to send
+    std::vector<std::string> partHeaders; // headers of the parts of a multipart reply
+    std::string trailer;
     unsigned httpOkReturn = HTTP_OK;
 
     if (top)
@@ -322,18 +314,32 @@ namespace tnt
         log_debug("content type is \"" << contentType << '"');
         reply.setContentType(contentType.c_str());
       }
+      else if (!entry->contentType.empty())
+        reply.setContentType(entry->contentType.c_str());
       else
         setContentType(request, reply);
 
-      std::string lastModified = HttpMessage::htdate(st.st_ctime);
+      // validators; a 304 reply carries them too
+      reply.setHeader(httpheader::etag, *etag);
+      reply.setHeader(httpheader::lastModified, sf->getLastModified());
 
+      // If-Modified-Since is ignored, when If-None-Match is sent (RFC 7232)
+      const char* ifNoneMatch = request.getHeader(httpheader::ifNoneMatch, 0);
+      if (ifNoneMatch)
+      {
+        if (etagMatches(ifNoneMatch, *etag))
+          return HTTP_NOT_MODIFIED;
+      }
+      else
       {
-        std::string s = request.getHeader(httpheader::ifModifiedSince);
-        if (s == lastModified)
+        const char* ifModifiedSince = request.getHeader(httpheader::ifModifiedSince, 0);
+        time_t since;
+        if (ifModifiedSince
+          && HttpMessage::parseHtdate(ifModifiedSince, since)
+          && st.st_mtime <= since)
           return HTTP_NOT_MODIFIED;
       }
 
-      reply.setHeader(httpheader::lastModified, lastModified);
       reply.setKeepAliveHeader();
       reply.setHeader(httpheader::acceptRanges, "bytes");
 
@@ -344,34 +350,67 @@ namespace tnt
         reply.setMaxAgeHeader(maxAge);
       }
 
-      // check for byte range (only "bytes=from-" or "bytes=from-to" are supported)
+      // check for byte ranges; the whole file is sent, when the file
+      // changed since the client got its part (If-Range)
       const char* range = request.getHeader(httpheader::range, 0);
+      const char* ifRange = request.getHeader(httpheader::ifRange, 0);
+      if (range && ifRange && !ifRangeMatches(ifRange, *etag, st.st_mtime))
+      {
+        log_debug("If-Range " << ifRange << " does not match; send whole file");
+        range = 0;
+      }
+
       if (range)
       {
-        if (parseRange(range, offset, count))
+        if (!parseByteRanges(range, size, ranges))
+        {
+          log_debug("ignore invalid byte range " << range);
+        }
+        else if (ranges.empty())
+        {
+          log_debug("byte range " << range << " not satisfiable");
+          std::ostringstream s;
+          s << "bytes */" << size;
+          reply.setHeader(httpheader::contentRange, s.str());
+          return HTTP_RANGE_NOT_SATISFIABLE;
+        }
+        else
         {
-          if (offset > st.st_size)
-            return HTTP_RANGE_NOT_SATISFIABLE;
-
-          if (offset + count > st.st_size)
-            count = st.st_size - offset;
-
           reply.setHeader(httpheader::contentLocation, request.getUrl());
-          std::ostringstream contentRange;
-          contentRange << offset << '-' << (offset+count)-1 << '/' << st.st_size;
-          reply.setHeader(httpheader::contentRange, contentRange.str());
-
           httpOkReturn = HTTP_PARTIAL_CONTENT;
         }
-        else
+      }
+
+      off_t contentLength = size;
+      if (ranges.size() == 1)
+      {
+        reply.setHeader(httpheader::contentRange, contentRange(ranges[0], size));
+        contentLength = ranges[0].count;
+      }
+      else if (ranges.size() > 1)
+      {
+        // multipart/byteranges (RFC 7233 appendix A)
+        std::string boundary = makeBoundary(*etag);
+        std::string partContentType = reply.getContentType();
+
+        contentLength = 0;
+        for (ByteRangesType::const_iterator it = ranges.begin(); it != ranges.end(); ++it)
         {
-          log_debug("invalid byte range " << range);
-          return HTTP_RANGE_NOT_SATISFIABLE;
+          partHeaders.push_back("\r\n--" + boundary
+            + "\r\nContent-Type: " + partContentType
+            + "\r\nContent-Range: " + contentRange(*it, size)
+            + "\r\n\r\n");
+          contentLength += partHeaders.back().size() + it->count;
         }
+
+        trailer = "\r\n--" + boundary + "--\r\n";
+        contentLength += trailer.size();
+
+        reply.setContentType(("multipart/byteranges; boundary=" + boundary).c_str());
       }
 
       // set Content-Length
-      reply.setContentLengthHeader(reply.getContentSize() + count);
+      reply.setContentLengthHeader(reply.getContentSize() + contentLength);
 
       if (request.isMethodHEAD())
       {
@@ -382,9 +421,53 @@ namespace tnt
       {
         log_debug("no head request");
       }
+    }
+
+    if (ranges.empty())
+      ranges.push_back(ByteRange(0, size));
+
+    // send data
+    log_info("send file \"" << file << "\" size " << size << " bytes; " << ranges.size() << " range(s)" << (body ? " from memory" : ""));
+
+    if (body)
+    {
+      // the buffered reply passes header and body to the kernel in one write
+      for (unsigned n = 0; n < ranges.size(); ++n)
+      {
+        if (!partHeaders.empty())
+          reply.out() << partHeaders[n];
+        reply.out().write(body->data() + ranges[n].offset, ranges[n].count);
+      }
+
+      reply.out() << trailer;
+      return httpOkReturn;
+    }
 
-      // send data
-      log_info("send file \"" << file << "\" size " << st.st_size << " bytes; offset=" << offset << " count=" << count);
+    if (top)
+    {
+#ifdef USE_SSL
+      ssl_iostream* sslStream = dynamic_cast<ssl_iostream*>(&reply.getDirectStream());
+      if (sslStream)
+      {
+        // the tls layer reads the file itself in large blocks or passes it
+        // to the kernel with kernel tls
+        std::ostream& out = *sslStream;
+        reply.setDirectMode(httpOkReturn, HttpReturn::httpMessage(httpOkReturn));
+
+        for (unsigned n = 0; n < ranges.size(); ++n)
+        {
+          if (!partHeaders.empty())
+            out << partHeaders[n];
+          if (!out.flush())
+            break;
+          sslStream->sslSendFile(sf->getFd(), ranges[n].offset, ranges[n].count);
+        }
+
+        out << trailer << std::flush;
+
+        return httpOkReturn;
+      }
+#endif
 
 #if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
       int on = 1;
@@ -404,27 +487,15 @@ namespace tnt
         reply.setDirectMode(httpOkReturn, HttpReturn::httpMessage(httpOkReturn));
         tcpStream.flush();
 
-        Fdfile in(file.c_str(), O_RDONLY);
-        ssize_t s;
-        while(tcpStream)
+        for (unsigned n = 0; n < ranges.size(); ++n)
         {
-          do
-          {
-            log_debug("sendfile offset " << offset << " size " << count);
-            s = sendfile(tcpStream.getFd(), in.getFd(), &offset, count);
-            log_debug("sendfile returns " << s);
-          } while (s < 0 && errno == EINTR);
-
-          if (s < 0 && errno != EAGAIN)
-            throw cxxtools::SystemError("sendfile");
-
-          if (offset >= count || s == 0)
-            break;
-
-          log_debug("poll");
-          pollout(tcpStream.getFd(), tcpStream.getTimeout());
+          if (!partHeaders.empty())
+            tcpStream << partHeaders[n] << std::flush;
+          sendFile(tcpStream, sf->getFd(), ranges[n].offset, ranges[n].count);
         }
 
+        tcpStream << trailer << std::flush;
+
         if (::setsockopt(tcpStream.getFd(), SOL_TCP, TCP_CORK,
             &off, sizeof(off)) < 0)
           throw cxxtools::SystemError("setsockopt(TCP_CORK)");
@@ -445,31 +516,15 @@ namespace tnt
 #endif
     }
 
-    std::ifstream in(file.c_str());
-    in.seekg(offset);
-    if (!in)
+    for (unsigned n = 0; n < ranges.size(); ++n)
     {
-      log_debug("can't open file \"" << file << '"');
-      return DECLINED;
+      if (!partHeaders.empty())
+        reply.out() << partHeaders[n];
+      copyFile(reply.out(), *sf, ranges[n].offset, ranges[n].count);
     }
 
-    if (offset == 0 && count == st.st_size && count > 0)
-    {
-      reply.out() << in.rdbuf() << std::flush;
-      if (in.fail())
-        throw std::runtime_error("failed to send file \"" + file + '"');
-    }
-    else
-    {
-      char ch;
-      off_t o;
-      for (o = 0; in.get(ch) && o < count; ++o)
-        reply.out().put(ch);
-      if (o < count)
-        throw std::runtime_error("failed to send file \"" + file + '"');
-    }
+    reply.out() << trailer << std::flush;
 
     return httpOkReturn;
   }
 }
-
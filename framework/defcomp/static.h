@@ -57,6 +57,7 @@ namespace tnt
       virtual void configure(const TntConfig&);
       virtual unsigned topCall(HttpRequest&, HttpReply&, QueryParams&);
       virtual unsigned operator() (HttpRequest&, HttpReply&, QueryParams&);
+      virtual bool lazyQueryParams() const  { return true; }
   };
 }
 
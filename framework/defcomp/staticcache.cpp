@@ -0,0 +1,675 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#include "staticcache.h"
+#include "mimehandler.h"
+#include <tnt/etag.h>
+#include <tnt/httpmessage.h>
+#include <tnt/tntconfig.h>
+#include <tnt/tntnet.h>
+#include <tnt/compressor.h>
+#include <tnt/compressiongovernor.h>
+#include <cxxtools/log.h>
+#include <config.h>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+log_define("tntnet.staticcache")
+
+namespace tnt
+{
+  namespace
+  {
+    uint64_t currentMSecs()
+    {
+      struct timespec ts;
+      ::clock_gettime(CLOCK_MONOTONIC, &ts);
+      return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    // the directory part of a path including the trailing slash
+    std::string dirPrefix(const std::string& path)
+    {
+      std::string::size_type slash = path.rfind('/');
+      return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // StaticFile
+  //
+  cxxtools::atomic_t StaticFile::_keptFds = 0;
+
+  StaticFile::StaticFile(const std::string& path, const struct stat& st, int fd)
+    : _path(path),
+      _st(st),
+      _fd(fd),
+      _kept(false),
+      _etag(makeEtag(st)),
+      _lastModified(HttpMessage::htdate(st.st_mtime))
+  { }
+
+  StaticFile::~StaticFile()
+  {
+    if (_fd >= 0)
+      ::close(_fd);
+    if (_kept)
+      cxxtools::atomicDecrement(_keptFds);
+  }
+
+  void StaticFile::keepFd(unsigned max)
+  {
+    if (_kept || _fd < 0)
+      return;
+
+    if (cxxtools::atomicIncrement(_keptFds) <= static_cast<cxxtools::atomic_t>(max))
+    {
+      _kept = true;
+      return;
+    }
+
+    cxxtools::atomicDecrement(_keptFds);
+    log_debug("close \"" << _path << "\"; " << max << " cached files are open already");
+    ::close(_fd);
+    _fd = -1;
+  }
+
+  StaticFile* StaticFile::open(const std::string& path)
+  {
+    // O_NONBLOCK keeps a fifo from blocking the worker until the type is
+    // checked; cached descriptors must not leak into child processes
+    int fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+    {
+      log_debug("can't open file \"" << path << "\"; errno=" << errno);
+      return 0;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+      log_debug("no regular file \"" << path << '"');
+      ::close(fd);
+      return 0;
+    }
+
+    int flags = ::fcntl(fd, F_GETFL);
+    if (flags >= 0)
+      ::fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+
+    return new StaticFile(path, st, fd);
+  }
+
+  bool StaticFile::isSameFile(const struct stat& st) const
+  {
+    return st.st_dev == _st.st_dev
+        && st.st_ino == _st.st_ino
+        && st.st_size == _st.st_size
+        && st.st_mtime == _st.st_mtime;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // StaticContent
+  //
+  std::string::size_type StaticContent::memorySize() const
+  {
+    std::string::size_type size = data.size();
+    for (VariantsType::const_iterator it = variants.begin(); it != variants.end(); ++it)
+      size += it->data.size();
+    return size;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // StaticCache
+  //
+  StaticCache::StaticCache()
+    : _generation(0),
+      _inotifyFd(-1),
+      _lastEvents(0),
+      _maxEntries(TntConfig::it().staticCacheSize),
+      _maxOpenFiles(TntConfig::it().staticCacheOpenFiles),
+      _ttl(static_cast<uint64_t>(TntConfig::it().staticCacheTtl.totalMSecs())),
+      _memoryUsed(0),
+      _maxMemory(TntConfig::it().staticMemoryCache),
+      _maxMemoryFile(TntConfig::it().staticMemoryCacheMaxFile)
+  {
+#ifdef HAVE_SYS_INOTIFY_H
+    if (_maxEntries > 0)
+    {
+      _inotifyFd = ::inotify_init();
+      if (_inotifyFd < 0)
+        log_warn("inotify not available; cached static files expire after " << _ttl << " ms");
+      else
+      {
+        ::fcntl(_inotifyFd, F_SETFL, ::fcntl(_inotifyFd, F_GETFL) | O_NONBLOCK);
+        Tntnet::addTimerCallback(&StaticCache::timer);
+      }
+    }
+#endif
+  }
+
+  StaticCache::~StaticCache()
+  {
+    if (_inotifyFd >= 0)
+      ::close(_inotifyFd);
+  }
+
+  StaticCache& StaticCache::it()
+  {
+    static StaticCache theCache;
+    return theCache;
+  }
+
+  void StaticCache::timer()
+  {
+    it().processEvents();
+  }
+
+  StaticEntryPtr StaticCache::create(const std::string& path, const std::string& root, const MimeHandler* handler)
+  {
+    StaticEntryPtr entry = new StaticEntry();
+    entry->file = StaticFile::open(path);
+
+    if (TntConfig::it().enableCompression)
+      addSiblings(*entry, path, root);
+
+    if (handler)
+      entry->contentType = handler->getMimeType(path);
+
+    return entry;
+  }
+
+  StaticCache::ManifestPtr StaticCache::getManifest(const std::string& root)
+  {
+    uint64_t now = currentMSecs();
+    unsigned generation;
+
+    {
+      cxxtools::ReadLock lock(_mutex);
+      ManifestsType::const_iterator it = _manifests.find(root);
+      if (it != _manifests.end() && it->second->expires > now)
+        return it->second;
+
+      generation = _generation;
+    }
+
+    std::string fileName = root + StaticManifest::fileName();
+    watch(fileName);
+
+    // the manifest is read again after staticCacheTtl, even when it is
+    // watched, since inotify misses a swapped symlink to the document root
+    ManifestPtr manifest = new Manifest();
+    manifest->expires = now + _ttl;
+
+    std::ifstream in(fileName.c_str());
+    if (in)
+    {
+      try
+      {
+        manifest->manifest.read(in);
+        manifest->found = true;
+        log_debug("manifest \"" << fileName << "\" lists " << manifest->manifest.entries().size() << " files");
+      }
+      catch (const std::exception& e)
+      {
+        log_warn("ignore manifest \"" << fileName << "\": " << e.what());
+        manifest->manifest.clear();
+      }
+    }
+
+    cxxtools::WriteLock lock(_mutex);
+    if (generation == _generation)
+      _manifests[root] = manifest;
+
+    return manifest;
+  }
+
+  void StaticCache::addSiblings(StaticEntry& entry, const std::string& path, const std::string& root)
+  {
+    ManifestPtr manifest;
+    if (!root.empty() && path.compare(0, root.size(), root) == 0)
+      manifest = getManifest(root);
+
+    if (manifest.getPointer() == 0 || !manifest->found)
+    {
+      StaticFilePtr gzfile = StaticFile::open(path + ".gz");
+      if (gzfile.getPointer() != 0)
+      {
+        entry.siblings.push_back(StaticEntry::Sibling());
+        entry.siblings.back().encoding = "gzip";
+        entry.siblings.back().file = gzfile;
+      }
+
+      return;
+    }
+
+    std::string::size_type b = root.size();
+    while (b < path.size() && path[b] == '/')
+      ++b;
+
+    const StaticManifest::Entry* me = manifest->manifest.find(path.substr(b));
+    if (me == 0)
+      return;
+
+    // the siblings were made from another version of the file
+    const StaticFile* file = entry.file.getPointer();
+    if (file == 0
+      || static_cast<uint64_t>(file->getSize()) != me->size
+      || static_cast<int64_t>(file->getMtime()) != me->mtime)
+    {
+      log_debug("manifest entry of \"" << path << "\" is outdated");
+      return;
+    }
+
+    for (StaticManifest::VariantsType::const_iterator it = me->variants.begin();
+      it != me->variants.end(); ++it)
+    {
+      const char* suffix = StaticManifest::suffix(it->encoding);
+      if (suffix == 0)
+        continue;
+
+      StaticFilePtr sibling = StaticFile::open(path + suffix);
+      if (sibling.getPointer() == 0 || static_cast<uint64_t>(sibling->getSize()) != it->size)
+      {
+        log_debug("compressed file \"" << path << suffix << "\" missing or changed");
+        continue;
+      }
+
+      entry.siblings.push_back(StaticEntry::Sibling());
+      entry.siblings.back().encoding = it->encoding;
+      entry.siblings.back().file = sibling;
+    }
+  }
+
+  StaticEntryPtr StaticCache::get(const std::string& path, const std::string& root, const MimeHandler* handler)
+  {
+    if (_maxEntries == 0)
+      return create(path, root, handler);
+
+    uint64_t now = currentMSecs();
+    unsigned generation;
+
+    // The timer thread reads the inotify events every second. Without a
+    // running timer the requests have to do it.
+    if (_inotifyFd >= 0
+      && static_cast<cxxtools::atomic_t>(now / 1000) > cxxtools::atomicGet(_lastEvents) + 2)
+      processEvents();
+
+    StaticEntryPtr expired;
+
+    {
+      cxxtools::ReadLock lock(_mutex);
+      EntriesType::const_iterator it = _entries.find(path);
+      if (it != _entries.end())
+      {
+        if (it->second->expires > now)
+        {
+          log_debug("file \"" << path << "\" found in cache");
+          return it->second;
+        }
+
+        if (it->second->watched && it->second->file.getPointer() != 0)
+          expired = it->second;
+      }
+
+      generation = _generation;
+    }
+
+    // Inotify reports changes in the directory of a file, but not of its
+    // parents, so a watched entry is checked after staticCacheTtl too. An
+    // unchanged file keeps its entry and the content held in memory.
+    if (expired.getPointer() != 0)
+    {
+      struct stat st;
+      if (::stat(path.c_str(), &st) == 0 && expired->file->isSameFile(st))
+      {
+        cxxtools::WriteLock lock(_mutex);
+        if (generation == _generation)
+        {
+          log_debug("file \"" << path << "\" unchanged; renew cache entry");
+          expired->expires = now + _ttl;
+          return expired;
+        }
+      }
+    }
+
+    // the directory is watched before the file is opened, so that no
+    // change gets lost in between
+    bool watched = watch(path);
+
+    StaticEntryPtr entry = create(path, root, handler);
+    entry->expires = now + _ttl;
+    entry->watched = watched;
+
+    cxxtools::WriteLock lock(_mutex);
+
+    // a file may have been changed while we were reading it
+    if (generation != _generation)
+    {
+      log_debug("file \"" << path << "\" changed while reading; don't cache");
+      return entry;
+    }
+
+    if (_entries.size() >= _maxEntries)
+    {
+      log_info("clear static file cache");
+      clearEntries();
+    }
+
+    EntriesType::iterator it = _entries.find(path);
+    if (it != _entries.end())
+      erase(it);
+
+    if (entry->file.getPointer() != 0)
+      entry->file->keepFd(_maxOpenFiles);
+    for (StaticEntry::SiblingsType::iterator s = entry->siblings.begin(); s != entry->siblings.end(); ++s)
+      s->file->keepFd(_maxOpenFiles);
+
+    _entries.insert(EntriesType::value_type(path, entry));
+
+    return entry;
+  }
+
+  StaticContentPtr StaticCache::getContent(const StaticEntryPtr& entry)
+  {
+    const StaticFile* file = entry->file.getPointer();
+    if (_maxMemory == 0 || _maxEntries == 0 || file == 0
+      || static_cast<std::string::size_type>(file->getSize()) > _maxMemoryFile)
+      return StaticContentPtr();
+
+    {
+      cxxtools::ReadLock lock(_mutex);
+      if (entry->content.getPointer() != 0)
+        return entry->content;
+
+      if (_memoryUsed + file->getSize() > _maxMemory)
+      {
+        log_debug("memory for static files exhausted; don't load \"" << file->getPath() << '"');
+        return StaticContentPtr();
+      }
+    }
+
+    StaticContentPtr content = load(*entry);
+    if (content.getPointer() == 0)
+      return content;
+
+    cxxtools::WriteLock lock(_mutex);
+
+    if (entry->content.getPointer() != 0)
+      return entry->content;
+
+    // Only entries in the cache keep their content. Others are released
+    // after the current request.
+    EntriesType::iterator it = _entries.find(file->getPath());
+    if (it != _entries.end() && it->second.getPointer() == entry.getPointer()
+      && _memoryUsed + content->memorySize() <= _maxMemory)
+    {
+      entry->content = content;
+      _memoryUsed += content->memorySize();
+      log_debug("static file memory " << _memoryUsed << " bytes");
+    }
+
+    return content;
+  }
+
+  StaticContentPtr StaticCache::load(const StaticEntry& entry)
+  {
+    const StaticFile& file = *entry.file;
+    log_debug("load \"" << file.getPath() << "\" into memory");
+
+    // the cache may have closed the descriptor
+    StaticFilePtr reopened;
+    int fd = file.getFd();
+    if (fd < 0)
+    {
+      reopened = StaticFile::open(file.getPath());
+      if (reopened.getPointer() == 0 || !file.isSameFile(reopened->getStat()))
+      {
+        log_debug("file \"" << file.getPath() << "\" changed; don't load");
+        return StaticContentPtr();
+      }
+
+      fd = reopened->getFd();
+    }
+
+    StaticContentPtr content = new StaticContent();
+    content->data.resize(file.getSize());
+
+    off_t offset = 0;
+    while (offset < file.getSize())
+    {
+      ssize_t n = ::pread(fd, &content->data[offset], file.getSize() - offset, offset);
+      if (n < 0 && errno == EINTR)
+        continue;
+
+      if (n <= 0)
+      {
+        log_warn("failed to read file \"" << file.getPath() << "\"; errno=" << errno);
+        return StaticContentPtr();
+      }
+
+      offset += n;
+    }
+
+    const TntConfig& config = TntConfig::it();
+    const std::string& contentType = entry.contentType.empty() ? config.defaultContentType : entry.contentType;
+    if (!config.enableCompression || CompressionGovernor::isCompressedContentType(contentType.c_str()))
+      return content;
+
+    Compressor compressor;
+    for (TntConfig::CompressionsType::const_iterator it = config.compressions.begin();
+      it != config.compressions.end(); ++it)
+    {
+      Compressor::Codec codec = Compressor::parseCodec(it->encoding);
+      if (!Compressor::isSupported(codec))
+        continue;
+
+      unsigned minSize = it->minSize > 0 ? it->minSize : config.minCompressSize;
+      if (content->data.size() < minSize)
+        continue;
+
+      compressor.clear();
+      compressor.init(codec, it->level);
+      compressor.compress(content->data.data(), content->data.size());
+      compressor.finalize();
+
+      if (compressor.zsize() >= content->data.size())
+        continue;
+
+      // every content coding is a representation of its own
+      const std::string& etag = file.getEtag();
+
+      content->variants.push_back(StaticContent::Variant());
+      StaticContent::Variant& variant = content->variants.back();
+      variant.encoding = Compressor::encodingName(codec);
+      variant.etag.assign(etag, 0, etag.size() - 1);
+      variant.etag += '-';
+      variant.etag += variant.encoding;
+      variant.etag += '"';
+      variant.data = compressor.str();
+
+      log_debug(variant.encoding << " variant of \"" << file.getPath() << "\" " << content->data.size() << " bytes to " << variant.data.size() << " bytes");
+    }
+
+    return content;
+  }
+
+  bool StaticCache::watch(const std::string& path)
+  {
+#ifdef HAVE_SYS_INOTIFY_H
+    if (_inotifyFd < 0)
+      return false;
+
+    std::string prefix = dirPrefix(path);
+
+    cxxtools::MutexLock lock(_watchMutex);
+
+    if (_watches.find(prefix) != _watches.end())
+      return true;
+
+    int wd = ::inotify_add_watch(_inotifyFd, prefix.empty() ? "." : prefix.c_str(),
+      IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MODIFY
+        | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+    if (wd < 0)
+    {
+      log_debug("can't watch directory \"" << prefix << "\"; errno=" << errno);
+      return false;
+    }
+
+    log_debug("watch directory \"" << prefix << "\" wd=" << wd);
+    _watches[prefix] = wd;
+    _prefixes.insert(PrefixesType::value_type(wd, prefix));
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  void StaticCache::processEvents()
+  {
+#ifdef HAVE_SYS_INOTIFY_H
+    if (_inotifyFd < 0)
+      return;
+
+    cxxtools::atomicSet(_lastEvents, static_cast<cxxtools::atomic_t>(currentMSecs() / 1000));
+
+    // inotify_event is aligned to int
+    long buffer[4096 / sizeof(long)];
+
+    while (true)
+    {
+      ssize_t n = ::read(_inotifyFd, buffer, sizeof(buffer));
+      if (n <= 0)
+        break;
+
+      cxxtools::WriteLock lock(_mutex);
+      ++_generation;
+
+      const char* p = reinterpret_cast<const char*>(buffer);
+      const char* e = p + n;
+      while (p < e)
+      {
+        const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(p);
+        p += sizeof(struct inotify_event) + ev->len;
+
+        if (ev->mask & (IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF))
+        {
+          log_debug("directory of wd " << ev->wd << " gone or events lost; clear static file cache");
+          clearEntries();
+          _manifests.clear();
+
+          cxxtools::MutexLock wlock(_watchMutex);
+          if (ev->mask & IN_MOVE_SELF)
+          {
+            // the directory prefixes do not match the watched directory any more
+            ::inotify_rm_watch(_inotifyFd, ev->wd);
+          }
+          else if (ev->mask & IN_IGNORED)
+          {
+            std::pair<PrefixesType::iterator, PrefixesType::iterator> r = _prefixes.equal_range(ev->wd);
+            for (PrefixesType::iterator it = r.first; it != r.second; ++it)
+              _watches.erase(it->second);
+            _prefixes.erase(r.first, r.second);
+          }
+        }
+        else if (ev->len > 0)
+        {
+          std::string name(ev->name);
+          cxxtools::MutexLock wlock(_watchMutex);
+          std::pair<PrefixesType::iterator, PrefixesType::iterator> r = _prefixes.equal_range(ev->wd);
+          for (PrefixesType::iterator it = r.first; it != r.second; ++it)
+            invalidate(it->second + name);
+        }
+      }
+    }
+#endif
+  }
+
+  void StaticCache::invalidate(const std::string& path)
+  {
+    log_debug("invalidate \"" << path << '"');
+
+    // the siblings of all cached files of the document root may have changed
+    std::string prefix = dirPrefix(path);
+    if (path.compare(prefix.size(), std::string::npos, StaticManifest::fileName()) == 0)
+    {
+      _manifests.erase(prefix);
+      clearEntries();
+      return;
+    }
+
+    EntriesType::iterator it = _entries.find(path);
+    if (it != _entries.end())
+      erase(it);
+
+    // the entry of a file knows about its compressed siblings
+    static const char* const suffixes[] = { ".gz", ".br", ".zst", 0 };
+    for (unsigned n = 0; suffixes[n]; ++n)
+    {
+      std::string::size_type len = ::strlen(suffixes[n]);
+      if (path.size() > len && path.compare(path.size() - len, len, suffixes[n]) == 0)
+      {
+        it = _entries.find(path.substr(0, path.size() - len));
+        if (it != _entries.end())
+          erase(it);
+        break;
+      }
+    }
+  }
+
+  void StaticCache::erase(EntriesType::iterator it)
+  {
+    if (it->second->content.getPointer() != 0)
+      _memoryUsed -= it->second->content->memorySize();
+    _entries.erase(it);
+  }
+
+  void StaticCache::clearEntries()
+  {
+    _entries.clear();
+    _memoryUsed = 0;
+  }
+
+  void StaticCache::clear()
+  {
+    cxxtools::WriteLock lock(_mutex);
+    ++_generation;
+    clearEntries();
+    _manifests.clear();
+  }
+}
@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#ifndef TNT_STATICCACHE_H
+#define TNT_STATICCACHE_H
+
+#include <tnt/staticmanifest.h>
+#include <cxxtools/refcounted.h>
+#include <cxxtools/smartptr.h>
+#include <cxxtools/mutex.h>
+#include <cxxtools/atomicity.h>
+#include <cxxtools/timespan.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace tnt
+{
+  class MimeHandler;
+
+  /// A regular file together with its validators; opened for reading,
+  /// unless the cache dropped the descriptor.
+  class StaticFile : public cxxtools::AtomicRefCounted
+  {
+      std::string _path;
+      struct stat _st;
+      int _fd;
+      bool _kept;
+      std::string _etag;
+      std::string _lastModified;
+
+      // number of files, which keep their descriptor for the cache
+      static cxxtools::atomic_t _keptFds;
+
+      StaticFile(const std::string& path, const struct stat& st, int fd);
+
+      // noncopyable
+      StaticFile(const StaticFile&);
+      StaticFile& operator=(const StaticFile&);
+
+    public:
+      ~StaticFile();
+
+      /// Opens the file; returns 0, if it is no readable regular file.
+      static StaticFile* open(const std::string& path);
+
+      /// Keeps the descriptor of a new file, while less than `max` files
+      /// do so; closes it otherwise.
+      void keepFd(unsigned max);
+
+      const std::string& getPath() const          { return _path; }
+      const struct stat& getStat() const          { return _st; }
+      off_t getSize() const                       { return _st.st_size; }
+      time_t getMtime() const                     { return _st.st_mtime; }
+      /// Returns the descriptor or -1, when it was closed by keepFd.
+      int getFd() const                           { return _fd; }
+      const std::string& getEtag() const          { return _etag; }
+      const std::string& getLastModified() const  { return _lastModified; }
+
+      /// Returns true, if `st` describes this file in the same version.
+      bool isSameFile(const struct stat& st) const;
+  };
+
+  typedef cxxtools::SmartPtr<StaticFile> StaticFilePtr;
+
+  /// The content of a small file held in memory together with its
+  /// compressed variants.
+  struct StaticContent : public cxxtools::AtomicRefCounted
+  {
+    struct Variant
+    {
+      std::string encoding;
+      std::string etag;
+      std::string data;
+    };
+
+    typedef std::vector<Variant> VariantsType;
+
+    std::string data;
+    VariantsType variants;  // in the order of the configured compressions
+
+    std::string::size_type memorySize() const;
+  };
+
+  typedef cxxtools::SmartPtr<StaticContent> StaticContentPtr;
+
+  /// Everything the static component needs to know about a requested file.
+  struct StaticEntry : public cxxtools::AtomicRefCounted
+  {
+    /// A precompressed file next to the requested one like "site.css.gz".
+    struct Sibling
+    {
+      std::string encoding;
+      StaticFilePtr file;
+    };
+
+    typedef std::vector<Sibling> SiblingsType;
+
+    StaticFilePtr file;       // 0 if there is no such regular file
+    SiblingsType siblings;    // in the order of preference
+    std::string contentType;  // empty if no mime handler was passed
+    uint64_t expires;         // milliseconds of the monotonic clock
+    bool watched;             // invalidated by inotify; checked on expiry
+    StaticContentPtr content; // loaded on demand by StaticCache::getContent
+
+    StaticEntry()
+      : expires(0),
+        watched(false)
+      { }
+  };
+
+  typedef cxxtools::SmartPtr<StaticEntry> StaticEntryPtr;
+
+  /** Cache for file metadata and open descriptors of static files.
+
+      Only staticCacheOpenFiles files keep their descriptor; the others
+      are opened again for each request.
+
+      Entries are invalidated using inotify on the directories of the
+      cached files. The events are read by the timer thread of tntnet.
+      Entries expire after staticCacheTtl. Since inotify misses changes of
+      parent directories like a swapped symlink, a watched entry is then
+      kept only, when a stat of its path still gives the same file. The
+      cache is cleared, when it grows beyond staticCacheSize entries.
+
+      The precompressed siblings of a file are taken from the manifest of
+      the document root written by tntnet-precompress. Without manifest
+      only a ".gz" sibling is looked up.
+
+      Files up to staticMemoryCacheMaxFile bytes are additionally held in
+      memory with precompressed variants as long as the content of all
+      cached entries fits into staticMemoryCache bytes.
+   */
+  class StaticCache
+  {
+      typedef std::map<std::string, StaticEntryPtr> EntriesType;
+      typedef std::map<std::string, int> WatchesType;
+      typedef std::multimap<int, std::string> PrefixesType;
+
+      struct Manifest : public cxxtools::AtomicRefCounted
+      {
+        StaticManifest manifest;
+        bool found;       // false, if the document root has no valid manifest
+        uint64_t expires; // like StaticEntry::expires
+
+        Manifest()
+          : found(false),
+            expires(0)
+          { }
+      };
+
+      typedef cxxtools::SmartPtr<Manifest> ManifestPtr;
+      typedef std::map<std::string, ManifestPtr> ManifestsType;
+
+      cxxtools::ReadWriteMutex _mutex;
+      EntriesType _entries;
+      ManifestsType _manifests; // document root => manifest
+      unsigned _generation;   // incremented on each invalidation
+
+      cxxtools::Mutex _watchMutex;
+      WatchesType _watches;   // directory prefix => watch descriptor
+      PrefixesType _prefixes; // watch descriptor => directory prefixes
+
+      int _inotifyFd;
+      cxxtools::atomic_t _lastEvents;  // seconds of the monotonic clock
+      unsigned _maxEntries;
+      unsigned _maxOpenFiles;
+      uint64_t _ttl;
+
+      std::string::size_type _memoryUsed;   // content of the entries in _entries
+      std::string::size_type _maxMemory;
+      std::string::size_type _maxMemoryFile;
+
+      StaticCache();
+      ~StaticCache();
+
+      // noncopyable
+      StaticCache(const StaticCache&);
+      StaticCache& operator=(const StaticCache&);
+
+      StaticEntryPtr create(const std::string& path, const std::string& root, const MimeHandler* handler);
+      ManifestPtr getManifest(const std::string& root);
+      void addSiblings(StaticEntry& entry, const std::string& path, const std::string& root);
+      StaticContentPtr load(const StaticEntry& entry);
+      bool watch(const std::string& path);
+      void processEvents();
+      static void timer();
+      void invalidate(const std::string& path);
+      void erase(EntriesType::iterator it);
+      void clearEntries();
+
+    public:
+      static StaticCache& it();
+
+      /// Returns the entry for a file; the file system is only consulted on a cache miss.
+      /// The path starts with the document root `root`, which holds the manifest.
+      StaticEntryPtr get(const std::string& path, const std::string& root, const MimeHandler* handler);
+
+      /// Returns the content of the file of a cached entry from memory; loads
+      /// it if needed. Returns 0, if the file is too large or the memory
+      /// budget is exhausted.
+      StaticContentPtr getContent(const StaticEntryPtr& entry);
+
+      void clear();
+  };
+}
+
+#endif // TNT_STATICCACHE_H
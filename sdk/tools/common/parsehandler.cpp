@@ -125,5 +125,12 @@ namespace tnt
 
     void ParseHandler::endI18n()
       { }
+
+    void ParseHandler::startCache(const std::string& /* key */, const std::string& /* vary */,
+                                  unsigned /* ttl */, const std::string& /* tag */)
+      { }
+
+    void ParseHandler::endCache()
+      { }
   }
 }
@@ -32,6 +32,7 @@
 #include <sstream>
 #include <fstream>
 #include <cctype>
+#include <map>
 #include <cxxtools/log.h>
 
 log_define("tntnet.parser")
@@ -187,7 +188,12 @@ namespace tnt
         state_endcall,
         state_endcalle,
         state_doc,  // 90
-        state_doce
+        state_doce,
+        state_cachearg0,
+        state_cachearg,
+        state_cacheargeq,
+        state_cacheargval0,
+        state_cacheargval
       };
 
       state_type state = state_nl;
@@ -208,7 +214,9 @@ namespace tnt
       bool inClose = false;
       bool htmlExpr = false;
       bool splitBar = false;
+      bool inCache = false;
       std::vector<std::string> scopeIncludes;
+      std::map<std::string, std::string> cacheArgs;
 
       _handler.start();
 
@@ -457,11 +465,20 @@ namespace tnt
               }
               else if (tag == "doc")
                 state = state_doc;
+              else if (tag == "cache")
+                throw parse_error("key expected", state, _curfile, _curline);
               else
                 state = state_cpp;
             }
             else if (!inComp && tag == "def" && std::isspace(ch))
               state = state_tagarg0;
+            else if (tag == "cache" && std::isspace(ch))
+            {
+              if (inCache)
+                throw parse_error("nested <%cache> not allowed", state, _curfile, _curline);
+              cacheArgs.clear();
+              state = state_cachearg0;
+            }
             else if (std::isspace(ch))
             {
               if (tag == "application")
@@ -1541,6 +1558,13 @@ namespace tnt
                 _handler.endI18n();
                 state = state_html0;
               }
+              else if (inCache && tag == "cache")
+              {
+                log_debug("endCache()");
+                _handler.endCache();
+                inCache = false;
+                state = state_html0;
+              }
               else
               {
                 html += "</%";
@@ -1964,6 +1988,76 @@ namespace tnt
               etag += ch;
             break;
 
+          case state_cachearg0:
+            if (ch == '>')
+            {
+              if (cacheArgs.find("key") == cacheArgs.end())
+                throw parse_error("key expected", state, _curfile, _curline);
+
+              unsigned ttl = 0;
+              const std::string& ttlArg = cacheArgs["ttl"];
+              for (std::string::const_iterator it = ttlArg.begin(); it != ttlArg.end(); ++it)
+              {
+                if (!std::isdigit(*it))
+                  throw parse_error("ttl must be a number of seconds", state, _curfile, _curline);
+                ttl = ttl * 10 + (*it - '0');
+              }
+
+              log_debug("startCache(\"" << cacheArgs["key"] << "\", \"" << cacheArgs["vary"] << "\", " << ttl << ", \"" << cacheArgs["tag"] << "\")");
+              _handler.startCache(cacheArgs["key"], cacheArgs["vary"], ttl, cacheArgs["tag"]);
+              inCache = true;
+              state = state_html0;
+            }
+            else if (!std::isspace(ch))
+            {
+              tagarg = ch;
+              state = state_cachearg;
+            }
+            break;
+
+          case state_cachearg:
+            if (ch == '=' || std::isspace(ch))
+            {
+              if (tagarg != "key" && tagarg != "vary" && tagarg != "ttl" && tagarg != "tag")
+                throw parse_error("\"key\", \"vary\", \"ttl\" or \"tag\" expected; \"" + tagarg + "\" found", state, _curfile, _curline);
+              if (cacheArgs.find(tagarg) != cacheArgs.end())
+                throw parse_error(tagarg + " already set", state, _curfile, _curline);
+              state = (ch == '=' ? state_cacheargval0 : state_cacheargeq);
+            }
+            else
+              tagarg += ch;
+            break;
+
+          case state_cacheargeq:
+            if (ch == '=')
+              state = state_cacheargval0;
+            else if (!std::isspace(ch))
+              throw parse_error("\"=\" expected", state, _curfile, _curline);
+            break;
+
+          case state_cacheargval0:
+            if (ch == '"')
+            {
+              value.clear();
+              state = state_cacheargval;
+            }
+            else if (!std::isspace(ch))
+              throw parse_error("'\"' expected", state, _curfile, _curline);
+            break;
+
+          case state_cacheargval:
+            if (ch == '"')
+            {
+              cacheArgs[tagarg] = value;
+              value.clear();
+              state = state_cachearg0;
+            }
+            else if (ch == '\n')
+              throw parse_error("'\"' expected", state, _curfile, _curline);
+            else
+              value += ch;
+            break;
+
         }  // switch(state)
 
         log_debug("line " << _curline << " char " << ch << " state " << state << " bc " << bracketCount);
@@ -1985,6 +2079,9 @@ namespace tnt
       if (inClose)
         throw parse_error("</%close> missing", state, _curfile, _curline);
 
+      if (inCache)
+        throw parse_error("</%cache> missing", state, _curfile, _curline);
+
       if (!html.empty())
       {
         log_debug("onHtml(\"" << html << "\")");
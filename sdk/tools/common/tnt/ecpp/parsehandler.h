@@ -81,6 +81,9 @@ namespace tnt
         virtual void onIncludeEnd(const std::string& file);
         virtual void startI18n();
         virtual void endI18n();
+        virtual void startCache(const std::string& key, const std::string& vary,
+                                unsigned ttl, const std::string& tag);
+        virtual void endCache();
     };
   }
 }
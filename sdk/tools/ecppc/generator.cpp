@@ -96,6 +96,7 @@ namespace tnt
         _currentComp(&_maincomp),
         _externData(false),
         _compress(false),
+        _fragmentCache(false),
         _c_time(0),
         _linenumbersEnabled(true)
     {
@@ -291,6 +292,49 @@ namespace tnt
     void Generator::startI18n()
       { _externData = true; }
 
+    void Generator::startCache(const std::string& key, const std::string& vary,
+                               unsigned ttl, const std::string& tag)
+    {
+      _fragmentCache = true;
+
+      // The block renders into a reply of its own, which shadows the reply
+      // of the component. The output is then stored and written at once.
+      std::ostringstream m;
+      printLine(m);
+      m << "  // <%cache key=\"" << key << "\">\n"
+           "  {\n";
+      if (vary.empty())
+        m << "    std::string _tnt_fragmentkey = \"" << stringescaper::escape(key, stringescaper()) << "\";\n";
+      else
+        m << "    std::ostringstream _tnt_fragmentkeys;\n"
+             "    _tnt_fragmentkeys << \"" << stringescaper::escape(key, stringescaper()) << "\" << '\\n' << (" << vary << ");\n"
+             "    std::string _tnt_fragmentkey = _tnt_fragmentkeys.str();\n";
+      m << "    tnt::FragmentCache::ContentPtr _tnt_fragment = tnt::FragmentCache::get(_tnt_fragmentkey);\n"
+           "    if (_tnt_fragment.getPointer() == 0)\n"
+           "    {\n"
+           "      std::ostringstream _tnt_fragmentout;\n"
+           "      {\n"
+           "        tnt::HttpReply _tnt_fragmentreply(_tnt_fragmentout);\n"
+           "        _tnt_fragmentreply.setDirectModeNoFlush();\n"
+           "        _tnt_fragmentreply.setLocale(reply.out().getloc());\n"
+           "        tnt::HttpReply& reply = _tnt_fragmentreply;\n";
+      _currentComp->addHtml(m.str());
+
+      std::ostringstream e;
+      e << "      }\n"
+           "      _tnt_fragment = new tnt::FragmentCache::Content(_tnt_fragmentout.str());\n"
+           "      tnt::FragmentCache::put(_tnt_fragmentkey, _tnt_fragment, " << ttl << ", \""
+        << stringescaper::escape(tag, stringescaper()) << "\");\n"
+           "    }\n"
+           "    reply.out().write(_tnt_fragment->str().data(), _tnt_fragment->str().size());\n"
+           "  }\n"
+           "  // </%cache>\n";
+      _cacheEnd = e.str();
+    }
+
+    void Generator::endCache()
+      { _currentComp->addHtml(_cacheEnd); }
+
     void Generator::getIntro(std::ostream& out, const std::string& filename) const
     {
       out << "////////////////////////////////////////////////////////////////////////\n"
@@ -383,6 +427,10 @@ namespace tnt
       if (_compress)
         out << "#include <tnt/zdata.h>\n";
 
+      if (_fragmentCache)
+        out << "#include <tnt/fragmentcache.h>\n"
+               "#include <sstream>\n";
+
       out << "#include <cxxtools/log.h>\n"
              "#include <stdexcept>\n\n";
     }
@@ -75,6 +75,8 @@ namespace tnt
 
         bool _externData;
         bool _compress;
+        bool _fragmentCache;
+        std::string _cacheEnd;
 
         time_t _c_time;
         const char* _gentime;
@@ -162,6 +164,9 @@ namespace tnt
         virtual void onInclude(const std::string& file);
         virtual void onIncludeEnd(const std::string& file);
         virtual void startI18n();
+        virtual void startCache(const std::string& key, const std::string& vary,
+                                unsigned ttl, const std::string& tag);
+        virtual void endCache();
 
         void getCpp(std::ostream& out, const std::string& filename) const;
     };
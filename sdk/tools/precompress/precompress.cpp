@@ -0,0 +1,539 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <tnt/compressor.h>
+#include <tnt/etag.h>
+#include <tnt/staticmanifest.h>
+#include <cxxtools/arg.h>
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "config.h"
+
+namespace
+{
+  typedef std::vector<tnt::Compressor::Codec> CodecsType;
+
+  // variants, which save less than 1/minSavings of the size, are dropped
+  const unsigned minSavings = 20;
+
+  // compressing these rarely saves anything
+  const char* const compressedExtensions[] = {
+    ".gz", ".br", ".zst", ".zip", ".bz2", ".xz", ".7z",
+    ".png", ".jpg", ".jpeg", ".gif", ".webp", ".avif",
+    ".woff", ".woff2", ".mp3", ".mp4", ".ogg", ".webm",
+    0
+  };
+
+  int maxLevel(tnt::Compressor::Codec codec)
+  {
+    switch (codec)
+    {
+      case tnt::Compressor::codecBrotli: return 11;
+      case tnt::Compressor::codecZstd:   return 19;
+      default:                           return 9;
+    }
+  }
+
+  bool endsWith(const std::string& s, const char* suffix)
+  {
+    std::string::size_type len = ::strlen(suffix);
+    return s.size() >= len && s.compare(s.size() - len, len, suffix) == 0;
+  }
+
+  void throwSystemError(const char* fn, const std::string& path)
+  {
+    throw std::runtime_error(std::string(fn) + " \"" + path + "\" failed: " + ::strerror(errno));
+  }
+
+  // The file is written to a hidden temporary file first, so that neither
+  // tntnet nor a later run sees a partially written file.
+  void writeFile(const std::string& path, const tnt::Compressor& compressor)
+  {
+    std::string::size_type slash = path.rfind('/');
+    std::string tmp = slash == std::string::npos
+      ? '.' + path + ".tmp"
+      : path.substr(0, slash + 1) + '.' + path.substr(slash + 1) + ".tmp";
+
+    {
+      std::ofstream out(tmp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+      compressor.output(out);
+      out.close();
+      if (!out)
+      {
+        ::unlink(tmp.c_str());
+        throw std::runtime_error("failed to write \"" + tmp + '"');
+      }
+    }
+
+    if (::rename(tmp.c_str(), path.c_str()) != 0)
+    {
+      ::unlink(tmp.c_str());
+      throwSystemError("rename", path);
+    }
+  }
+
+  void readFile(int fd, const std::string& path, std::string& data)
+  {
+    std::string::size_type offset = 0;
+    while (offset < data.size())
+    {
+      ssize_t n = ::pread(fd, &data[offset], data.size() - offset, offset);
+      if (n < 0 && errno == EINTR)
+        continue;
+
+      if (n < 0)
+        throwSystemError("read", path);
+
+      if (n == 0)
+        throw std::runtime_error("file \"" + path + "\" truncated while reading");
+
+      offset += n;
+    }
+  }
+
+  uint64_t hash(const std::string& data)
+  {
+    tnt::XxHash64 h;
+    h.update(data.data(), data.size());
+    return h.digest();
+  }
+
+  class Precompressor
+  {
+      std::string _root;
+      CodecsType _codecs;
+      unsigned _minSize;
+      bool _force;
+      bool _verbose;
+
+      tnt::StaticManifest _oldManifest;
+      tnt::StaticManifest _manifest;
+      std::set<std::string> _processed;
+
+      unsigned _compressed;
+      unsigned _reused;
+
+      const tnt::StaticManifest::Variant* findVariant(const tnt::StaticManifest::Entry* entry,
+        const std::string& encoding) const;
+      void removeSiblings(const std::string& path, const tnt::StaticManifest::Entry& entry,
+        const tnt::StaticManifest::Entry* keep);
+
+    public:
+      Precompressor(const std::string& root, const CodecsType& codecs,
+        unsigned minSize, bool force, bool verbose);
+
+      /// Compresses all files below the directory (relative to the root).
+      void processDirectory(const std::string& dir);
+      /// Compresses a file (relative to the root).
+      void processFile(const std::string& file);
+      /// Writes the manifest and removes siblings, which are not needed any more.
+      /// When `all` is set, the whole document root was processed.
+      void finish(bool all);
+  };
+
+  Precompressor::Precompressor(const std::string& root, const CodecsType& codecs,
+      unsigned minSize, bool force, bool verbose)
+    : _root(root),
+      _codecs(codecs),
+      _minSize(minSize),
+      _force(force),
+      _verbose(verbose),
+      _compressed(0),
+      _reused(0)
+  {
+    if (!_root.empty() && *_root.rbegin() != '/')
+      _root += '/';
+
+    std::string manifestFile = _root + tnt::StaticManifest::fileName();
+    std::ifstream in(manifestFile.c_str());
+    if (in)
+    {
+      try
+      {
+        _oldManifest.read(in);
+      }
+      catch (const std::exception& e)
+      {
+        std::cerr << "warning: ignore manifest \"" << manifestFile << "\": " << e.what() << std::endl;
+        _oldManifest.clear();
+      }
+    }
+  }
+
+  const tnt::StaticManifest::Variant* Precompressor::findVariant(const tnt::StaticManifest::Entry* entry,
+    const std::string& encoding) const
+  {
+    if (entry == 0)
+      return 0;
+
+    for (tnt::StaticManifest::VariantsType::const_iterator it = entry->variants.begin();
+      it != entry->variants.end(); ++it)
+    {
+      if (it->encoding == encoding)
+        return &*it;
+    }
+
+    return 0;
+  }
+
+  void Precompressor::removeSiblings(const std::string& path, const tnt::StaticManifest::Entry& entry,
+    const tnt::StaticManifest::Entry* keep)
+  {
+    for (tnt::StaticManifest::VariantsType::const_iterator it = entry.variants.begin();
+      it != entry.variants.end(); ++it)
+    {
+      const char* suffix = tnt::StaticManifest::suffix(it->encoding);
+      if (suffix == 0 || findVariant(keep, it->encoding) != 0)
+        continue;
+
+      std::string sibling = _root + path + suffix;
+      if (::unlink(sibling.c_str()) == 0 && _verbose)
+        std::cout << "remove " << sibling << std::endl;
+    }
+  }
+
+  void Precompressor::processDirectory(const std::string& dir)
+  {
+    std::string path = _root + dir;
+    DIR* d = ::opendir(path.empty() ? "." : path.c_str());
+    if (d == 0)
+      throwSystemError("opendir", path);
+
+    std::vector<std::string> names;
+    struct dirent* ent;
+    while ((ent = ::readdir(d)) != 0)
+    {
+      // hidden files include "." and "..", the manifest and temporary files
+      if (ent->d_name[0] != '.')
+        names.push_back(ent->d_name);
+    }
+
+    ::closedir(d);
+
+    std::sort(names.begin(), names.end());
+
+    for (std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it)
+    {
+      std::string rel = dir + *it;
+      std::string file = _root + rel;
+
+      struct stat st;
+      if (::lstat(file.c_str(), &st) != 0)
+        continue;
+
+      // symbolic links to directories are not followed to avoid loops
+      if (S_ISDIR(st.st_mode))
+      {
+        processDirectory(rel + '/');
+        continue;
+      }
+
+      bool compressed = false;
+      for (unsigned n = 0; compressedExtensions[n]; ++n)
+        if (endsWith(*it, compressedExtensions[n]))
+          compressed = true;
+
+      if (!compressed)
+        processFile(rel);
+    }
+  }
+
+  void Precompressor::processFile(const std::string& file)
+  {
+    if (file.find_first_of("\t\r\n") != std::string::npos)
+    {
+      std::cerr << "warning: skip \"" << file << "\"; tab or newline in file name" << std::endl;
+      return;
+    }
+
+    std::string path = _root + file;
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throwSystemError("open", path);
+
+    std::string data;
+    struct stat st;
+
+    try
+    {
+      if (::fstat(fd, &st) != 0)
+        throwSystemError("stat", path);
+
+      if (!S_ISREG(st.st_mode))
+      {
+        ::close(fd);
+        return;
+      }
+
+      _processed.insert(file);
+
+      if (static_cast<uint64_t>(st.st_size) < _minSize)
+      {
+        ::close(fd);
+        return;
+      }
+
+      data.resize(st.st_size);
+      readFile(fd, path, data);
+      ::close(fd);
+    }
+    catch (...)
+    {
+      ::close(fd);
+      throw;
+    }
+
+    tnt::StaticManifest::Entry entry;
+    entry.size = data.size();
+    entry.mtime = st.st_mtime;
+    entry.hash = hash(data);
+
+    // siblings of unchanged files are kept
+    const tnt::StaticManifest::Entry* old = _oldManifest.find(file);
+    if (old && (_force || old->size != entry.size || old->hash != entry.hash))
+      old = 0;
+
+    tnt::Compressor compressor;
+    for (CodecsType::const_iterator it = _codecs.begin(); it != _codecs.end(); ++it)
+    {
+      std::string encoding = tnt::Compressor::encodingName(*it);
+      std::string sibling = path + tnt::StaticManifest::suffix(encoding);
+
+      const tnt::StaticManifest::Variant* oldVariant = findVariant(old, encoding);
+      struct stat sst;
+      if (oldVariant
+        && ::stat(sibling.c_str(), &sst) == 0
+        && static_cast<uint64_t>(sst.st_size) == oldVariant->size)
+      {
+        if (_verbose)
+          std::cout << "keep " << sibling << std::endl;
+        entry.variants.push_back(*oldVariant);
+        ++_reused;
+        continue;
+      }
+
+      compressor.clear();
+      compressor.init(*it, maxLevel(*it));
+
+      // Compressor takes unsigned sizes
+      for (std::string::size_type offset = 0; offset < data.size(); offset += 0x1000000)
+        compressor.compress(data.data() + offset, std::min<std::string::size_type>(0x1000000, data.size() - offset));
+
+      compressor.finalize();
+
+      if (compressor.zsize() * minSavings > data.size() * (minSavings - 1))
+      {
+        if (_verbose)
+          std::cout << "skip " << sibling << "; " << data.size() << " bytes compress to " << compressor.zsize() << " bytes" << std::endl;
+        continue;
+      }
+
+      writeFile(sibling, compressor);
+
+      tnt::StaticManifest::Variant variant;
+      variant.encoding = encoding;
+      variant.size = compressor.zsize();
+      variant.hash = hash(compressor.str());
+      entry.variants.push_back(variant);
+      ++_compressed;
+
+      if (_verbose)
+        std::cout << "write " << sibling << "; " << data.size() << " => " << variant.size << " bytes" << std::endl;
+    }
+
+    if (!entry.variants.empty())
+      _manifest.add(file) = entry;
+  }
+
+  void Precompressor::finish(bool all)
+  {
+    typedef tnt::StaticManifest::EntriesType EntriesType;
+
+    for (EntriesType::const_iterator it = _oldManifest.entries().begin();
+      it != _oldManifest.entries().end(); ++it)
+    {
+      if (all || _processed.count(it->first))
+      {
+        // remove siblings, which the new manifest does not list any more
+        removeSiblings(it->first, it->second, _manifest.find(it->first));
+      }
+      else if (_manifest.find(it->first) == 0)
+      {
+        // files not passed on the command line keep their entry
+        _manifest.add(it->first) = it->second;
+      }
+    }
+
+    std::string manifestFile = _root + tnt::StaticManifest::fileName();
+    std::string tmp = manifestFile + ".tmp";
+
+    {
+      std::ofstream out(tmp.c_str(), std::ios::out | std::ios::trunc);
+      _manifest.write(out);
+      out.close();
+      if (!out)
+      {
+        ::unlink(tmp.c_str());
+        throw std::runtime_error("failed to write \"" + tmp + '"');
+      }
+    }
+
+    if (::rename(tmp.c_str(), manifestFile.c_str()) != 0)
+    {
+      ::unlink(tmp.c_str());
+      throwSystemError("rename", manifestFile);
+    }
+
+    if (_verbose)
+      std::cout << _manifest.entries().size() << " files in manifest; "
+                << _compressed << " compressed files written; "
+                << _reused << " kept" << std::endl;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  std::ios::sync_with_stdio(false);
+  try
+  {
+    CodecsType codecs;
+    while (true)
+    {
+      cxxtools::Arg<std::string> encoding(argc, argv, 'e');
+      if (!encoding.isSet())
+        break;
+
+      tnt::Compressor::Codec codec = tnt::Compressor::parseCodec(encoding.getValue());
+      if (codec == tnt::Compressor::codecNone || !tnt::StaticManifest::suffix(encoding.getValue()))
+        throw std::runtime_error("unknown encoding \"" + encoding.getValue() + '"');
+
+      if (!tnt::Compressor::isSupported(codec))
+      {
+        std::cerr << "warning: encoding \"" << encoding.getValue() << "\" not supported" << std::endl;
+        continue;
+      }
+
+      if (std::find(codecs.begin(), codecs.end(), codec) == codecs.end())
+        codecs.push_back(codec);
+    }
+
+    cxxtools::Arg<unsigned> minSize(argc, argv, 'm', 256);
+
+    cxxtools::Arg<bool> version(argc, argv, 'V');
+    cxxtools::Arg<bool> versionLong(argc, argv, "--version");
+    if (version || versionLong)
+    {
+      std::cout << PACKAGE_STRING << std::endl;
+      return 0;
+    }
+
+    cxxtools::Arg<bool> help(argc, argv, 'h');
+    cxxtools::Arg<bool> helpLong(argc, argv, "--help");
+    if (help || helpLong)
+    {
+      std::cout << PACKAGE_STRING "\n\n"
+        "usage: " << argv[0] << " [options] document-root [file...]\n\n"
+        "Writes compressed siblings of static files and a manifest used by tntnet.\n"
+        "When no files are given, all files below document-root are compressed.\n\n"
+        "  -e encoding       compress with encoding (br, zstd or gzip); may be\n"
+        "                    passed multiple times (default: all supported)\n"
+        "  -m bytes          minimum size of files to compress (default: 256)\n"
+        "  -f                compress all files, even if they did not change\n"
+        "  -v                verbose\n"
+        "\n"
+        "  -h, --help        display this information\n"
+        "  -V, --version     display program version\n";
+
+      return 0;
+    }
+
+    cxxtools::Arg<bool> force(argc, argv, 'f');
+    cxxtools::Arg<bool> verbose(argc, argv, 'v');
+
+    if (argc < 2)
+    {
+      std::cerr << "error: document root expected\n"
+                   "usage: " << argv[0] << " [options] document-root [file...]\n"
+                   "more info with -h / --help" << std::endl;
+      return 1;
+    }
+
+    if (codecs.empty())
+    {
+      // best compression first; tntnet prefers the first one on equal quality
+      tnt::Compressor::Codec all[] = {
+        tnt::Compressor::codecBrotli,
+        tnt::Compressor::codecZstd,
+        tnt::Compressor::codecGzip
+      };
+
+      for (unsigned n = 0; n < sizeof(all) / sizeof(all[0]); ++n)
+        if (tnt::Compressor::isSupported(all[n]))
+          codecs.push_back(all[n]);
+    }
+
+    Precompressor precompressor(argv[1], codecs, minSize, force, verbose);
+
+    if (argc == 2)
+    {
+      precompressor.processDirectory(std::string());
+    }
+    else
+    {
+      for (int a = 2; a < argc; ++a)
+      {
+        std::string file = argv[a];
+        while (!file.empty() && file[0] == '/')
+          file.erase(0, 1);
+        precompressor.processFile(file);
+      }
+    }
+
+    precompressor.finish(argc == 2);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#include <cxxtools/unit/testsuite.h>
+#include <cxxtools/unit/registertest.h>
+#include <tnt/byterange.h>
+#include <tnt/httpmessage.h>
+#include <limits>
+#include <sstream>
+
+class ByteRangeTest : public cxxtools::unit::TestSuite
+{
+  public:
+    ByteRangeTest()
+      : cxxtools::unit::TestSuite("byterange")
+    {
+      registerMethod("single", *this, &ByteRangeTest::testSingle);
+      registerMethod("suffix", *this, &ByteRangeTest::testSuffix);
+      registerMethod("openEnded", *this, &ByteRangeTest::testOpenEnded);
+      registerMethod("multiple", *this, &ByteRangeTest::testMultiple);
+      registerMethod("overlap", *this, &ByteRangeTest::testOverlap);
+      registerMethod("maxRanges", *this, &ByteRangeTest::testMaxRanges);
+      registerMethod("saturate", *this, &ByteRangeTest::testSaturate);
+      registerMethod("notSatisfiable", *this, &ByteRangeTest::testNotSatisfiable);
+      registerMethod("malformed", *this, &ByteRangeTest::testMalformed);
+      registerMethod("ifRange", *this, &ByteRangeTest::testIfRange);
+      registerMethod("contentRange", *this, &ByteRangeTest::testContentRange);
+    }
+
+    static bool parse(const char* header, off_t size, tnt::ByteRangesType& ranges)
+    {
+      return tnt::parseByteRanges(header, size, ranges);
+    }
+
+    void testSingle()
+    {
+      tnt::ByteRangesType ranges;
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=0-99", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), 1u);
+      CXXTOOLS_UNIT_ASSERT(ranges[0] == tnt::ByteRange(0, 100));
+
+      CXXTOOLS_UNIT_ASSERT(parse(" Bytes = 10 - 19 ", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), 1u);
+      CXXTOOLS_UNIT_ASSERT(ranges[0] == tnt::ByteRange(10, 10));
+
+      // the last position is limited to the size of the file
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=900-2000", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), 1u);
+      CXXTOOLS_UNIT_ASSERT(ranges[0] == tnt::ByteRange(900, 100));
+    }
+
+    void testSuffix()
+    {
+      tnt::ByteRangesType ranges;
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=-100", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), 1u);
+      CXXTOOLS_UNIT_ASSERT(ranges[0] == tnt::ByteRange(900, 100));
+
+      // a suffix longer than the file selects the whole file
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=-5000", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), 1u);
+      CXXTOOLS_UNIT_ASSERT(ranges[0] == tnt::ByteRange(0, 1000));
+    }
+
+    void testOpenEnded()
+    {
+      tnt::ByteRangesType ranges;
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=100-", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), 1u);
+      CXXTOOLS_UNIT_ASSERT(ranges[0] == tnt::ByteRange(100, 900));
+
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=999-", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), 1u);
+      CXXTOOLS_UNIT_ASSERT(ranges[0] == tnt::ByteRange(999, 1));
+    }
+
+    void testMultiple()
+    {
+      tnt::ByteRangesType ranges;
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=500-599, 0-99,,-10", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), 3u);
+      // ranges, which do not overlap, keep the order of the request
+      CXXTOOLS_UNIT_ASSERT(ranges[0] == tnt::ByteRange(500, 100));
+      CXXTOOLS_UNIT_ASSERT(ranges[1] == tnt::ByteRange(0, 100));
+      CXXTOOLS_UNIT_ASSERT(ranges[2] == tnt::ByteRange(990, 10));
+    }
+
+    void testOverlap()
+    {
+      tnt::ByteRangesType ranges;
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=50-150,0-99,200-299", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), 2u);
+      CXXTOOLS_UNIT_ASSERT(ranges[0] == tnt::ByteRange(0, 151));
+      CXXTOOLS_UNIT_ASSERT(ranges[1] == tnt::ByteRange(200, 100));
+
+      // adjacent ranges are coalesced too
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=100-199,0-99", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), 1u);
+      CXXTOOLS_UNIT_ASSERT(ranges[0] == tnt::ByteRange(0, 200));
+
+      // a range inside another one
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=0-,10-20,-5", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), 1u);
+      CXXTOOLS_UNIT_ASSERT(ranges[0] == tnt::ByteRange(0, 1000));
+    }
+
+    static std::string rangeList(unsigned count)
+    {
+      std::ostringstream s;
+      s << "bytes=";
+      for (unsigned n = 0; n < count; ++n)
+        s << (n ? "," : "") << n * 10 << '-' << n * 10 + 4;
+      return s.str();
+    }
+
+    void testMaxRanges()
+    {
+      tnt::ByteRangesType ranges;
+      CXXTOOLS_UNIT_ASSERT(parse(rangeList(tnt::maxByteRanges).c_str(), 10000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), tnt::maxByteRanges);
+
+      CXXTOOLS_UNIT_ASSERT(!parse(rangeList(tnt::maxByteRanges + 1).c_str(), 10000, ranges));
+      CXXTOOLS_UNIT_ASSERT(ranges.empty());
+    }
+
+    void testSaturate()
+    {
+      const off_t max = std::numeric_limits<off_t>::max();
+
+      tnt::ByteRangesType ranges;
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=0-99999999999999999999999999999", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), 1u);
+      CXXTOOLS_UNIT_ASSERT(ranges[0] == tnt::ByteRange(0, 1000));
+
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=-99999999999999999999999999999", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), 1u);
+      CXXTOOLS_UNIT_ASSERT(ranges[0] == tnt::ByteRange(0, 1000));
+
+      // a saturated first position is beyond any file
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=99999999999999999999999999999-", max, ranges));
+      CXXTOOLS_UNIT_ASSERT(ranges.empty());
+    }
+
+    void testNotSatisfiable()
+    {
+      tnt::ByteRangesType ranges;
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=1000-1999", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(ranges.empty());
+
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=-0", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(ranges.empty());
+
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=0-,-10", 0, ranges));
+      CXXTOOLS_UNIT_ASSERT(ranges.empty());
+
+      // a single satisfiable range is enough
+      CXXTOOLS_UNIT_ASSERT(parse("bytes=2000-,10-19", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(ranges.size(), 1u);
+      CXXTOOLS_UNIT_ASSERT(ranges[0] == tnt::ByteRange(10, 10));
+    }
+
+    void testMalformed()
+    {
+      tnt::ByteRangesType ranges;
+      CXXTOOLS_UNIT_ASSERT(!parse("", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(!parse("bytes", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(!parse("bytes=", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(!parse("bytes=,", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(!parse("items=0-99", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(!parse("bytes 0-99", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(!parse("bytes=99-0", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(!parse("bytes=-", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(!parse("bytes=a-b", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(!parse("bytes=0-99x", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(!parse("bytes=0-99 100-199", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(!parse("bytes=0-99,-", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(!parse("bytes=--5", 1000, ranges));
+
+      // ranges parsed before the error are dropped
+      CXXTOOLS_UNIT_ASSERT(!parse("bytes=0-9,x", 1000, ranges));
+      CXXTOOLS_UNIT_ASSERT(ranges.empty());
+    }
+
+    void testIfRange()
+    {
+      std::string etag = "\"1234abcd\"";
+      time_t mtime = 784111777;
+
+      CXXTOOLS_UNIT_ASSERT(tnt::ifRangeMatches("\"1234abcd\"", etag, mtime));
+      CXXTOOLS_UNIT_ASSERT(tnt::ifRangeMatches("  \"1234abcd\"", etag, mtime));
+      CXXTOOLS_UNIT_ASSERT(!tnt::ifRangeMatches("\"1234abce\"", etag, mtime));
+      CXXTOOLS_UNIT_ASSERT(!tnt::ifRangeMatches("W/\"1234abcd\"", etag, mtime));
+
+      CXXTOOLS_UNIT_ASSERT(tnt::ifRangeMatches("Sun, 06 Nov 1994 08:49:37 GMT", etag, mtime));
+      CXXTOOLS_UNIT_ASSERT(!tnt::ifRangeMatches("Sun, 06 Nov 1994 08:49:38 GMT", etag, mtime));
+      CXXTOOLS_UNIT_ASSERT(!tnt::ifRangeMatches("yesterday", etag, mtime));
+      CXXTOOLS_UNIT_ASSERT(!tnt::ifRangeMatches("", etag, mtime));
+    }
+
+    void testContentRange()
+    {
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::contentRange(tnt::ByteRange(0, 100), 1000), "bytes 0-99/1000");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::contentRange(tnt::ByteRange(999, 1), 1000), "bytes 999-999/1000");
+    }
+};
+
+cxxtools::unit::RegisterTest<ByteRangeTest> register_ByteRangeTest;
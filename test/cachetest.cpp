@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#include <cxxtools/unit/testsuite.h>
+#include <cxxtools/unit/registertest.h>
+#include <tnt/cache.h>
+#include <unistd.h>
+
+namespace
+{
+  struct Compute
+  {
+    unsigned& calls;
+    explicit Compute(unsigned& c)
+      : calls(c)
+      { }
+    int operator() () const
+      { return ++calls * 10; }
+  };
+}
+
+class CacheTest : public cxxtools::unit::TestSuite
+{
+  public:
+    CacheTest()
+      : cxxtools::unit::TestSuite("cache")
+    {
+      registerMethod("getPut", *this, &CacheTest::testGetPut);
+      registerMethod("getOrCompute", *this, &CacheTest::testGetOrCompute);
+      registerMethod("evict", *this, &CacheTest::testEvict);
+      registerMethod("expire", *this, &CacheTest::testExpire);
+      registerMethod("erasePrefix", *this, &CacheTest::testErasePrefix);
+    }
+
+    void testGetPut()
+    {
+      tnt::Cache<std::string> cache(1000, 4);
+      std::string value;
+
+      CXXTOOLS_UNIT_ASSERT(!cache.get("a", value));
+
+      cache.put("a", "A");
+      cache.put("b", "B");
+      CXXTOOLS_UNIT_ASSERT(cache.get("a", value));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(value, "A");
+
+      cache.put("a", "AA");
+      CXXTOOLS_UNIT_ASSERT(cache.get("a", value));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(value, "AA");
+
+      CXXTOOLS_UNIT_ASSERT(cache.erase("a"));
+      CXXTOOLS_UNIT_ASSERT(!cache.erase("a"));
+
+      tnt::CacheStatistics s = cache.getStatistics();
+      CXXTOOLS_UNIT_ASSERT_EQUALS(s.hits, 2u);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(s.misses, 1u);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(s.insertions, 3u);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(s.entries, 1u);
+    }
+
+    void testGetOrCompute()
+    {
+      tnt::Cache<int> cache(1000);
+      unsigned calls = 0;
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getOrCompute("x", Compute(calls)), 10);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getOrCompute("x", Compute(calls)), 10);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(calls, 1u);
+    }
+
+    void testEvict()
+    {
+      // a single shard, so that the order of eviction is predictable
+      tnt::Cache<int> cache(300, 1);
+      int value;
+
+      cache.put("a", 1, cxxtools::Milliseconds(0), 100);
+      cache.put("b", 2, cxxtools::Milliseconds(0), 100);
+      cache.put("c", 3, cxxtools::Milliseconds(0), 100);
+      CXXTOOLS_UNIT_ASSERT(cache.get("a", value));   // b is least recently used now
+
+      cache.put("d", 4, cxxtools::Milliseconds(0), 100);
+      CXXTOOLS_UNIT_ASSERT(!cache.get("b", value));
+      CXXTOOLS_UNIT_ASSERT(cache.get("a", value));
+      CXXTOOLS_UNIT_ASSERT(cache.get("c", value));
+      CXXTOOLS_UNIT_ASSERT(cache.get("d", value));
+
+      // too large for the cache
+      cache.put("e", 5, cxxtools::Milliseconds(0), 301);
+      CXXTOOLS_UNIT_ASSERT(!cache.get("e", value));
+
+      tnt::CacheStatistics s = cache.getStatistics();
+      CXXTOOLS_UNIT_ASSERT_EQUALS(s.evictions, 1u);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(s.bytes, 300u);
+    }
+
+    void testExpire()
+    {
+      tnt::Cache<int> cache(1000);
+      int value;
+
+      cache.put("a", 1, cxxtools::Milliseconds(1));
+      cache.put("b", 2, cxxtools::Milliseconds(60000));
+      ::usleep(10000);
+
+      CXXTOOLS_UNIT_ASSERT(!cache.get("a", value));
+      CXXTOOLS_UNIT_ASSERT(cache.get("b", value));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(cache.getStatistics().expirations, 1u);
+    }
+
+    void testErasePrefix()
+    {
+      tnt::Cache<int> cache(1000);
+      int value;
+
+      cache.put("user:1", 1);
+      cache.put("user:2", 2);
+      cache.put("group:1", 3);
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(cache.erasePrefix("user:"), 2u);
+      CXXTOOLS_UNIT_ASSERT(!cache.get("user:1", value));
+      CXXTOOLS_UNIT_ASSERT(cache.get("group:1", value));
+    }
+};
+
+cxxtools::unit::RegisterTest<CacheTest> register_CacheTest;
@@ -29,7 +29,9 @@
 
 #include <cxxtools/unit/testsuite.h>
 #include <cxxtools/unit/registertest.h>
+#include <cxxtools/convert.h>
 #include <tnt/cmd.h>
+#include <tnt/fragmentcache.h>
 #include <tnt/httpheader.h>
 #include <sstream>
 
@@ -42,6 +44,7 @@ class ComponentTest : public cxxtools::unit::TestSuite
       registerMethod("testOutput", *this, &ComponentTest::testOutput);
       registerMethod("testArg", *this, &ComponentTest::testArg);
       registerMethod("testScope", *this, &ComponentTest::testScope);
+      registerMethod("testCache", *this, &ComponentTest::testCache);
     }
 
     void testOutput()
@@ -113,6 +116,36 @@ class ComponentTest : public cxxtools::unit::TestSuite
       CXXTOOLS_UNIT_ASSERT_EQUALS(content, "session=1 securesession=1 application=1 request=1\nsession=2 securesession=1 application=2 request=1\n");
     }
 
+    std::string callCache(int n)
+    {
+      tnt::QueryParams params;
+      params.set("n", cxxtools::convert<std::string>(n));
+
+      std::ostringstream s;
+      tnt::Cmd cmd(s);
+      cmd.call(tnt::Compident("cache"), params);
+      return s.str();
+    }
+
+    void testCache()
+    {
+      tnt::FragmentCache::clear();
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(callCache(0), "n=0\n");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(callCache(1), "n=1\n");
+
+      // the key varies with n % 2 only
+      CXXTOOLS_UNIT_ASSERT_EQUALS(callCache(2), "n=0\n");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(callCache(3), "n=1\n");
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::FragmentCache::invalidate("cachetest\n0"), 1u);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(callCache(2), "n=2\n");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(callCache(3), "n=1\n");
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::FragmentCache::invalidateTag("test"), 2u);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(callCache(3), "n=3\n");
+    }
+
 };
 
 cxxtools::unit::RegisterTest<ComponentTest> register_ComponentTest;
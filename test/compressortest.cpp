@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <cxxtools/unit/testsuite.h>
+#include <cxxtools/unit/registertest.h>
+#include <tnt/compressor.h>
+#include <sstream>
+#include <zlib.h>
+
+namespace
+{
+  // Decompresses gzip data. Incomplete streams are decoded as far as
+  // possible, so that flushed parts can be checked.
+  std::string gunzip(const std::string& zdata, bool& complete)
+  {
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = 0;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+    inflateInit2(&stream, MAX_WBITS + 16);
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(zdata.data()));
+    stream.avail_in = zdata.size();
+
+    std::string ret;
+    int r;
+    do
+    {
+      char buffer[8192];
+      stream.next_out = reinterpret_cast<Bytef*>(buffer);
+      stream.avail_out = sizeof(buffer);
+      r = inflate(&stream, Z_SYNC_FLUSH);
+      ret.append(buffer, sizeof(buffer) - stream.avail_out);
+    } while (r == Z_OK && stream.avail_out == 0);
+
+    complete = r == Z_STREAM_END;
+    inflateEnd(&stream);
+    return ret;
+  }
+
+  std::string testData(unsigned lines)
+  {
+    std::ostringstream s;
+    for (unsigned n = 0; n < lines; ++n)
+      s << n << ";line " << n % 13 << ";some text to compress\n";
+    return s.str();
+  }
+}
+
+class CompressorTest : public cxxtools::unit::TestSuite
+{
+  public:
+    CompressorTest()
+      : cxxtools::unit::TestSuite("compressor")
+    {
+      registerMethod("gzip", *this, &CompressorTest::testGzip);
+      registerMethod("streamFlush", *this, &CompressorTest::testStreamFlush);
+      registerMethod("reuse", *this, &CompressorTest::testReuse);
+    }
+
+    void testGzip()
+    {
+      std::string data = testData(10000);
+
+      tnt::Compressor compressor;
+      compressor.init();
+      compressor.compress(data.data(), data.size());
+      compressor.finalize();
+
+      CXXTOOLS_UNIT_ASSERT(compressor.zsize() < data.size());
+
+      bool complete;
+      CXXTOOLS_UNIT_ASSERT_EQUALS(gunzip(compressor.str(), complete), data);
+      CXXTOOLS_UNIT_ASSERT(complete);
+    }
+
+    void testStreamFlush()
+    {
+      std::string data = testData(5000);
+      std::ostringstream sink;
+
+      tnt::Compressor compressor;
+      tnt::CompressOStream out(compressor);
+      out.begin(sink.rdbuf(), tnt::Compressor::codecGzip, -1);
+
+      // after each flush everything written so far must be decodable
+      std::string::size_type step = data.size() / 7;
+      for (std::string::size_type pos = 0; pos < data.size(); pos += step)
+      {
+        std::string::size_type end = std::min(pos + step, data.size());
+        out.write(data.data() + pos, end - pos);
+        out.flush();
+
+        bool complete;
+        CXXTOOLS_UNIT_ASSERT_EQUALS(gunzip(sink.str(), complete), data.substr(0, end));
+        CXXTOOLS_UNIT_ASSERT(!complete);
+      }
+
+      out.finish();
+      CXXTOOLS_UNIT_ASSERT(out);
+      CXXTOOLS_UNIT_ASSERT(!out.isActive());
+
+      bool complete;
+      CXXTOOLS_UNIT_ASSERT_EQUALS(gunzip(sink.str(), complete), data);
+      CXXTOOLS_UNIT_ASSERT(complete);
+    }
+
+    void testReuse()
+    {
+      std::string data = testData(1000);
+      tnt::Compressor compressor;
+      tnt::CompressOStream out(compressor);
+
+      for (unsigned n = 0; n < 3; ++n)
+      {
+        std::ostringstream sink;
+        out.begin(sink.rdbuf(), tnt::Compressor::codecGzip, n);
+        out << data;
+        out.flush();
+        out.flush();
+        out.finish();
+
+        bool complete;
+        CXXTOOLS_UNIT_ASSERT_EQUALS(gunzip(sink.str(), complete), data);
+        CXXTOOLS_UNIT_ASSERT(complete);
+      }
+    }
+};
+
+cxxtools::unit::RegisterTest<CompressorTest> register_CompressorTest;
@@ -30,6 +30,7 @@ class cstreamTest : public cxxtools::unit::TestSuite
       {
         registerMethod("testWrite", *this, &cstreamTest::testWrite);
         registerMethod("testRollback", *this, &cstreamTest::testRollback);
+        registerMethod("testDrain", *this, &cstreamTest::testDrain);
       }
 
       void doTestWrite(const char* testString, unsigned size, unsigned chunksize, unsigned chunkcount)
@@ -80,6 +81,41 @@ class cstreamTest : public cxxtools::unit::TestSuite
         CXXTOOLS_UNIT_ASSERT_EQUALS("", str(s));
       }
 
+      class Collector : public tnt::cstreambuf::Drain
+      {
+        public:
+          std::string data;
+          unsigned calls;
+
+          Collector()
+            : calls(0)
+            { }
+
+          void drain(tnt::cstreambuf& buf)
+          {
+            ++calls;
+            for (tnt::cstreambuf::size_type n = 0; n < buf.chunkcount(); ++n)
+              data.append(buf.chunk(n), buf.chunksize(n));
+            buf.makeEmpty();
+          }
+      };
+
+      void testDrain()
+      {
+        Collector collector;
+        tnt::ocstream s(4);
+        s.setDrain(&collector, 8);
+
+        s << "0123456";
+        CXXTOOLS_UNIT_ASSERT_EQUALS(collector.calls, 0);
+        CXXTOOLS_UNIT_ASSERT_EQUALS("0123456", str(s));
+
+        s << "789abcdefghij";
+        CXXTOOLS_UNIT_ASSERT_EQUALS(collector.calls, 2);
+        CXXTOOLS_UNIT_ASSERT(s.size() <= 8);
+        CXXTOOLS_UNIT_ASSERT_EQUALS("0123456789abcdefghij", collector.data + str(s));
+      }
+
 };
 
 cxxtools::unit::RegisterTest<cstreamTest> register_cstreamTest;
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <cxxtools/unit/testsuite.h>
+#include <cxxtools/unit/registertest.h>
+#include <tnt/encoding.h>
+#include <stdexcept>
+
+class EncodingTest : public cxxtools::unit::TestSuite
+{
+  public:
+    EncodingTest()
+      : cxxtools::unit::TestSuite("encoding")
+    {
+      registerMethod("plainList", *this, &EncodingTest::testPlainList);
+      registerMethod("quality", *this, &EncodingTest::testQuality);
+      registerMethod("wildcard", *this, &EncodingTest::testWildcard);
+      registerMethod("invalid", *this, &EncodingTest::testInvalid);
+    }
+
+    void testPlainList()
+    {
+      tnt::Encoding e("gzip, deflate, br");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e.accept("gzip"), 10u);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e.accept("deflate"), 10u);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e.accept("br"), 10u);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e.accept("zstd"), 0u);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e.accept("identity"), 10u);
+    }
+
+    void testQuality()
+    {
+      tnt::Encoding e("gzip;q=0.8, br;q=1.0, zstd ; Q=0.05");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e.accept("gzip"), 8u);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e.accept("br"), 10u);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e.accept("zstd"), 1u);
+
+      e.parse("GZIP;q=0, identity;q=0.5");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e.accept("gzip"), 0u);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e.accept("identity"), 5u);
+    }
+
+    void testWildcard()
+    {
+      tnt::Encoding e("br, *;q=0.3");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e.accept("br"), 10u);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e.accept("gzip"), 3u);
+
+      e.parse("*;q=0");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e.accept("gzip"), 0u);
+    }
+
+    void testInvalid()
+    {
+      tnt::Encoding e;
+      CXXTOOLS_UNIT_ASSERT_THROW(e.parse("gzip;q=x"), std::runtime_error);
+      CXXTOOLS_UNIT_ASSERT_THROW(e.parse("gzip;q=1.5"), std::runtime_error);
+    }
+};
+
+cxxtools::unit::RegisterTest<EncodingTest> register_EncodingTest;
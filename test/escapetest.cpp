@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <cxxtools/unit/testsuite.h>
+#include <cxxtools/unit/registertest.h>
+#include <tnt/htmlescostream.h>
+#include <tnt/urlescostream.h>
+#include <sstream>
+#include <cstdlib>
+
+namespace
+{
+  // byte wise reference implementations of the escaping
+
+  std::string htmlEscapeRef(const std::string& s)
+  {
+    std::string ret;
+    for (std::string::size_type n = 0; n < s.size(); ++n)
+    {
+      switch (s[n])
+      {
+        case '<': ret += "&lt;"; break;
+        case '>': ret += "&gt;"; break;
+        case '&': ret += "&amp;"; break;
+        case '"': ret += "&quot;"; break;
+        case '\'': ret += "&#39;"; break;
+        default: ret += s[n];
+      }
+    }
+    return ret;
+  }
+
+  std::string urlEscapeRef(const std::string& s)
+  {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string ret;
+    for (std::string::size_type n = 0; n < s.size(); ++n)
+    {
+      int ch = static_cast<unsigned char>(s[n]);
+      if (ch > 32 && ch < 127 && ch != '%' && ch != '+' && ch != '=' && ch != '&')
+        ret += static_cast<char>(ch);
+      else if (ch == ' ')
+        ret += '+';
+      else
+      {
+        ret += '%';
+        ret += hex[(ch >> 4) & 0x0f];
+        ret += hex[ch & 0x0f];
+      }
+    }
+    return ret;
+  }
+
+  std::string htmlEscape(const std::string& s)
+  {
+    std::ostringstream out;
+    tnt::HtmlEscOstream e(out);
+    e << s;
+    return out.str();
+  }
+
+  std::string htmlEscapeBytewise(const std::string& s)
+  {
+    std::ostringstream out;
+    tnt::HtmlEscOstream e(out);
+    for (std::string::size_type n = 0; n < s.size(); ++n)
+      e << s[n];
+    return out.str();
+  }
+
+  std::string urlEscapeStream(const std::string& s)
+  {
+    std::ostringstream out;
+    tnt::UrlEscOstream e(out);
+    e << s;
+    return out.str();
+  }
+
+  std::string urlEscapeBytewise(const std::string& s)
+  {
+    std::ostringstream out;
+    tnt::UrlEscOstream e(out);
+    for (std::string::size_type n = 0; n < s.size(); ++n)
+      e << s[n];
+    return out.str();
+  }
+}
+
+class EscapeTest : public cxxtools::unit::TestSuite
+{
+  public:
+    EscapeTest()
+      : cxxtools::unit::TestSuite("escape")
+    {
+      registerMethod("singleChars", *this, &EscapeTest::testSingleChars);
+      registerMethod("positions", *this, &EscapeTest::testPositions);
+      registerMethod("random", *this, &EscapeTest::testRandom);
+    }
+
+    void check(const std::string& s)
+    {
+      std::string html = htmlEscapeRef(s);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(htmlEscape(s), html);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(htmlEscapeBytewise(s), html);
+
+      std::string url = urlEscapeRef(s);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(urlEscapeStream(s), url);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(urlEscapeBytewise(s), url);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::urlEscape(s), url);
+    }
+
+    // every byte value alone and embedded in a block of clean characters
+    void testSingleChars()
+    {
+      for (unsigned ch = 0; ch < 256; ++ch)
+      {
+        std::string s(1, static_cast<char>(ch));
+        check(s);
+        check(std::string(40, 'a') + s + std::string(40, 'b'));
+      }
+    }
+
+    // every byte value at every position of strings crossing the block sizes
+    void testPositions()
+    {
+      for (unsigned len = 0; len <= 70; ++len)
+      {
+        std::string clean(len, 'x');
+        check(clean);
+
+        for (unsigned pos = 0; pos < len; ++pos)
+        {
+          for (unsigned ch = 0; ch < 256; ++ch)
+          {
+            std::string s = clean;
+            s[pos] = static_cast<char>(ch);
+            check(s);
+          }
+        }
+      }
+    }
+
+    void testRandom()
+    {
+      std::srand(42);
+      for (unsigned n = 0; n < 2000; ++n)
+      {
+        std::string s(std::rand() % 300, ' ');
+        // mostly clean text with some special characters
+        for (std::string::size_type i = 0; i < s.size(); ++i)
+          s[i] = std::rand() % 8 == 0 ? static_cast<char>(std::rand() % 256)
+                                      : static_cast<char>('a' + std::rand() % 26);
+        check(s);
+      }
+    }
+};
+
+cxxtools::unit::RegisterTest<EscapeTest> register_EscapeTest;
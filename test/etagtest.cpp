@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+
+#include <cxxtools/unit/testsuite.h>
+#include <cxxtools/unit/registertest.h>
+#include <tnt/etag.h>
+#include <tnt/httpmessage.h>
+#include <algorithm>
+#include <cstring>
+
+class EtagTest : public cxxtools::unit::TestSuite
+{
+  public:
+    EtagTest()
+      : cxxtools::unit::TestSuite("etag")
+    {
+      registerMethod("xxhash", *this, &EtagTest::testXxHash);
+      registerMethod("xxhashIncremental", *this, &EtagTest::testXxHashIncremental);
+      registerMethod("match", *this, &EtagTest::testMatch);
+      registerMethod("matchCoding", *this, &EtagTest::testMatchCoding);
+      registerMethod("parseHtdate", *this, &EtagTest::testParseHtdate);
+    }
+
+    static uint64_t xxhash(const char* s)
+    {
+      tnt::XxHash64 h;
+      h.update(s, std::strlen(s));
+      return h.digest();
+    }
+
+    void testXxHash()
+    {
+      CXXTOOLS_UNIT_ASSERT(xxhash("") == 0xef46db3751d8e999ULL);
+      CXXTOOLS_UNIT_ASSERT(xxhash("a") == 0xd24ec4f1a98c6e5bULL);
+      CXXTOOLS_UNIT_ASSERT(xxhash("abc") == 0x44bc2cf5ad770999ULL);
+      CXXTOOLS_UNIT_ASSERT(xxhash("Nobody inspects the spammish repetition") == 0xfbcea83c8a378bf1ULL);
+    }
+
+    void testXxHashIncremental()
+    {
+      std::string data;
+      for (unsigned n = 0; n < 1000; ++n)
+        data += static_cast<char>(n * 7);
+
+      tnt::XxHash64 h;
+      h.update(data.data(), data.size());
+      uint64_t expected = h.digest();
+
+      for (unsigned step = 1; step < 70; step += 3)
+      {
+        h.reset();
+        for (unsigned n = 0; n < data.size(); n += step)
+          h.update(data.data() + n, std::min<std::string::size_type>(step, data.size() - n));
+        CXXTOOLS_UNIT_ASSERT(h.digest() == expected);
+      }
+    }
+
+    void testMatch()
+    {
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::makeEtag(0x1234abcdULL), "\"1234abcd\"");
+
+      std::string etag = "\"1234abcd\"";
+      CXXTOOLS_UNIT_ASSERT(tnt::etagMatches("\"1234abcd\"", etag));
+      CXXTOOLS_UNIT_ASSERT(tnt::etagMatches("\"xyz\", W/\"1234abcd\"", etag));
+      CXXTOOLS_UNIT_ASSERT(tnt::etagMatches("*", etag));
+      CXXTOOLS_UNIT_ASSERT(!tnt::etagMatches("\"1234abc\"", etag));
+      CXXTOOLS_UNIT_ASSERT(!tnt::etagMatches("\"1234abcd-br\"", etag));
+      CXXTOOLS_UNIT_ASSERT(!tnt::etagMatches("", etag));
+      CXXTOOLS_UNIT_ASSERT(!tnt::etagMatches("\"1234abcd", etag));
+    }
+
+    void testMatchCoding()
+    {
+      std::string etag = "\"1234abcd\"";
+      std::string matched;
+      CXXTOOLS_UNIT_ASSERT(tnt::etagMatches("\"1234abcd-br\"", etag, true, &matched));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(matched, "\"1234abcd-br\"");
+
+      CXXTOOLS_UNIT_ASSERT(tnt::etagMatches("\"1234abcd\"", etag, true, &matched));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(matched, etag);
+
+      CXXTOOLS_UNIT_ASSERT(!tnt::etagMatches("\"1234abcd-\"", etag, true));
+      CXXTOOLS_UNIT_ASSERT(!tnt::etagMatches("\"1234abcdef\"", etag, true));
+    }
+
+    void testParseHtdate()
+    {
+      time_t t;
+      CXXTOOLS_UNIT_ASSERT(tnt::HttpMessage::parseHtdate("Sun, 06 Nov 1994 08:49:37 GMT", t));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(t, 784111777);
+
+      CXXTOOLS_UNIT_ASSERT(tnt::HttpMessage::parseHtdate("Sunday, 06-Nov-94 08:49:37 GMT", t));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(t, 784111777);
+
+      CXXTOOLS_UNIT_ASSERT(tnt::HttpMessage::parseHtdate("Sun Nov  6 08:49:37 1994", t));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(t, 784111777);
+
+      CXXTOOLS_UNIT_ASSERT(tnt::HttpMessage::parseHtdate(tnt::HttpMessage::htdate(1700000000).c_str(), t));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(t, 1700000000);
+
+      CXXTOOLS_UNIT_ASSERT(!tnt::HttpMessage::parseHtdate("", t));
+      CXXTOOLS_UNIT_ASSERT(!tnt::HttpMessage::parseHtdate("Sun, 06 Foo 1994 08:49:37 GMT", t));
+      CXXTOOLS_UNIT_ASSERT(!tnt::HttpMessage::parseHtdate("Sun, 06 Nov 1994 08:49 GMT", t));
+    }
+};
+
+cxxtools::unit::RegisterTest<EtagTest> register_EtagTest;
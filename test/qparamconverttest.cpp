@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include <cxxtools/unit/testsuite.h>
+#include <cxxtools/unit/registertest.h>
+#include <tnt/query_params.h>
+#include <sstream>
+#include <limits>
+
+namespace
+{
+  const char* samples[] = {
+    "0", "1", "-1", "+1", "42", " 42", "\t\n42", "42 ", "42abc", "042",
+    "-0", "+-1", "-+1", "-", "+", "", " ", "abc", "0x1f", "1.5", "1e3",
+    "127", "128", "-128", "-129", "255", "256",
+    "32767", "32768", "-32768", "-32769", "65535", "65536",
+    "2147483647", "2147483648", "-2147483648", "-2147483649",
+    "4294967295", "4294967296",
+    "9223372036854775807", "9223372036854775808",
+    "-9223372036854775808", "-9223372036854775809",
+    "18446744073709551615", "18446744073709551616",
+    "99999999999999999999999999"
+  };
+
+  const char* floatSamples[] = {
+    "0", "1", "-1", "+1", "1.5", "-1.5", ".5", "-.5", "5.", "1e3", "1E-3",
+    "-2.5e+10", " 3.25", "3.25abc", "0.1", "123456789.123456789",
+    "1e-300", "", "abc", "-", ".", "+-1", "1e", "1E+", "1ex", "1.5e3x",
+    "1.e2", "00001.25", "1..2", ".e1", "1e400"
+  };
+
+  template <typename Type>
+  bool streamConvert(const std::string& s, Type& value)
+  {
+    std::istringstream in(s);
+    in.imbue(std::locale::classic());
+    in >> value;
+    return !in.fail();
+  }
+
+  template <typename Type>
+  std::string streamFormat(Type value)
+  {
+    std::ostringstream out;
+    out.imbue(std::locale::classic());
+    out << value;
+    return out.str();
+  }
+}
+
+class QParamConvertTest : public cxxtools::unit::TestSuite
+{
+  public:
+    QParamConvertTest()
+      : cxxtools::unit::TestSuite("qparamconvert")
+    {
+      registerMethod("integers", *this, &QParamConvertTest::testIntegers);
+      registerMethod("floats", *this, &QParamConvertTest::testFloats);
+      registerMethod("format", *this, &QParamConvertTest::testFormat);
+      registerMethod("conversionError", *this, &QParamConvertTest::testConversionError);
+      registerMethod("defaultValue", *this, &QParamConvertTest::testDefaultValue);
+    }
+
+    template <typename Type>
+    void checkInteger(const std::string& s)
+    {
+      Type fast = 0;
+      Type slow = 0;
+      bool slowOk = streamConvert(s, slow);
+      tnt::qhelper::ConvertResult r = tnt::qhelper::convertParam(s, fast, std::locale::classic());
+
+      CXXTOOLS_UNIT_ASSERT(r != tnt::qhelper::convertUnsupported);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(r == tnt::qhelper::convertOk, slowOk);
+      if (slowOk)
+        CXXTOOLS_UNIT_ASSERT_EQUALS(fast, slow);
+    }
+
+    template <typename Type>
+    void checkFloat(const std::string& s)
+    {
+      Type fast = 0;
+      Type slow = 0;
+      bool slowOk = streamConvert(s, slow);
+      tnt::qhelper::ConvertResult r = tnt::qhelper::convertParam(s, fast, std::locale::classic());
+
+      if (r == tnt::qhelper::convertUnsupported)
+        return;
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(r == tnt::qhelper::convertOk, slowOk);
+      if (slowOk)
+        CXXTOOLS_UNIT_ASSERT_EQUALS(fast, slow);
+    }
+
+    template <typename Type>
+    void checkFormat(Type value)
+    {
+      std::string s;
+      CXXTOOLS_UNIT_ASSERT(tnt::qhelper::formatParam(value, s));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(s, streamFormat(value));
+    }
+
+    template <typename Type>
+    void checkFormatLimits()
+    {
+      checkFormat<Type>(0);
+      checkFormat<Type>(1);
+      checkFormat<Type>(10);
+      checkFormat<Type>(std::numeric_limits<Type>::min());
+      checkFormat<Type>(std::numeric_limits<Type>::max());
+      checkFormat<Type>(std::numeric_limits<Type>::max() / 3);
+      checkFormat<Type>(std::numeric_limits<Type>::min() / 3);
+    }
+
+    void testIntegers()
+    {
+      for (unsigned n = 0; n < sizeof(samples) / sizeof(samples[0]); ++n)
+      {
+        std::string s = samples[n];
+        checkInteger<short>(s);
+        checkInteger<unsigned short>(s);
+        checkInteger<int>(s);
+        checkInteger<unsigned>(s);
+        checkInteger<long>(s);
+        checkInteger<unsigned long>(s);
+        checkInteger<long long>(s);
+        checkInteger<unsigned long long>(s);
+      }
+    }
+
+    void testFloats()
+    {
+      for (unsigned n = 0; n < sizeof(floatSamples) / sizeof(floatSamples[0]); ++n)
+      {
+        std::string s = floatSamples[n];
+        checkFloat<float>(s);
+        checkFloat<double>(s);
+      }
+    }
+
+    void testFormat()
+    {
+      checkFormatLimits<short>();
+      checkFormatLimits<unsigned short>();
+      checkFormatLimits<int>();
+      checkFormatLimits<unsigned>();
+      checkFormatLimits<long>();
+      checkFormatLimits<unsigned long>();
+      checkFormatLimits<long long>();
+      checkFormatLimits<unsigned long long>();
+
+      tnt::QueryParams q;
+      q.add("a", -1234567);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(q.param("a"), "-1234567");
+    }
+
+    void testConversionError()
+    {
+      tnt::QueryParams q("a=42&b=abc&c=99999999999&d=");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(q.argt<int>("a", "int"), 42);
+      CXXTOOLS_UNIT_ASSERT_THROW(q.argt<int>("b", "int"), tnt::ConversionError);
+      CXXTOOLS_UNIT_ASSERT_THROW(q.argt<int>("c", "int"), tnt::ConversionError);
+      CXXTOOLS_UNIT_ASSERT_THROW(q.argt<int>("d", "int"), tnt::ConversionError);
+      CXXTOOLS_UNIT_ASSERT_THROW(q.argt<double>("b", "double"), tnt::ConversionError);
+    }
+
+    void testDefaultValue()
+    {
+      tnt::QueryParams q("a=abc&b=70000&c=12");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(q.arg<int>("a", 5), 5);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(q.arg<short>("b", 5), 5);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(q.arg<short>("c", 5), 12);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(q.arg<double>("a", 1.5), 1.5);
+    }
+};
+
+cxxtools::unit::RegisterTest<QParamConvertTest> register_QParamConvertTest;
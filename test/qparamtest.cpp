@@ -30,6 +30,9 @@
 #include <cxxtools/unit/testsuite.h>
 #include <cxxtools/unit/registertest.h>
 #include <tnt/query_params.h>
+#include <tnt/httprequest.h>
+#include <tnt/tntnet.h>
+#include <sstream>
 
 class QParamTest : public cxxtools::unit::TestSuite
 {
@@ -43,6 +46,10 @@ class QParamTest : public cxxtools::unit::TestSuite
       registerMethod("defaultValue", *this, &QParamTest::testDefaultValue);
       registerMethod("addValue", *this, &QParamTest::testAddValue);
       registerMethod("multipleValues", *this, &QParamTest::testMultipleValues);
+      registerMethod("unescape", *this, &QParamTest::testUnescape);
+      registerMethod("lazyParse", *this, &QParamTest::testLazyParse);
+      registerMethod("baseReference", *this, &QParamTest::testBaseReference);
+      registerMethod("requestBaseReference", *this, &QParamTest::testRequestBaseReference);
     }
 
     void testQParam()
@@ -112,6 +119,89 @@ class QParamTest : public cxxtools::unit::TestSuite
       CXXTOOLS_UNIT_ASSERT_EQUALS(a[1], 4);
       CXXTOOLS_UNIT_ASSERT_EQUALS(a[2], 28);
     }
+
+    void testUnescape()
+    {
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::urlUnescape("Hi+there"), "Hi there");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::urlUnescape("%48%69%2b%2B"), "Hi++");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::urlUnescape("a rather long value without escapes"), "a rather long value without escapes");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::urlUnescape("a rather long value with%20escape"), "a rather long value with escape");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::urlUnescape("100%"), "100%");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::urlUnescape("%zz%4"), "%zz%4");
+    }
+
+    void testLazyParse()
+    {
+      std::string get = "a=17&b=Hi+there";
+      std::string post = "a=4&c=%41";
+
+      tnt::QueryParams q;
+      q.parseLazy(get);
+      q.parseLazy(post);
+      CXXTOOLS_UNIT_ASSERT(!q.isParsed());
+
+      CXXTOOLS_UNIT_ASSERT(!q.mightHave("LANG"));
+      CXXTOOLS_UNIT_ASSERT(!q.isParsed());
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(q.paramcount("a"), 2);
+      CXXTOOLS_UNIT_ASSERT(q.isParsed());
+      CXXTOOLS_UNIT_ASSERT_EQUALS(q.arg<int>("a"), 17);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(q.argn<int>("a", 1), 4);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(q.arg<std::string>("b"), "Hi there");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(q.arg<std::string>("c"), "A");
+
+      tnt::QueryParams q2;
+      q2.parseLazy(get);
+      tnt::QueryParams q3(q2);
+      CXXTOOLS_UNIT_ASSERT(q3.isParsed());
+      CXXTOOLS_UNIT_ASSERT_EQUALS(q3.arg<int>("a"), 17);
+    }
+
+    void testBaseReference()
+    {
+      std::string get = "a=17&b=Hi+there";
+
+      tnt::QueryParams q;
+      q.parseLazy(get);
+      q.parse();
+      CXXTOOLS_UNIT_ASSERT(q.isParsed());
+
+      const cxxtools::QueryParams& base = q;
+      CXXTOOLS_UNIT_ASSERT_EQUALS(base.paramcount(), 2);
+      CXXTOOLS_UNIT_ASSERT(base.has("a"));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(base.param("a"), "17");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(base.param("b"), "Hi there");
+    }
+
+    void testRequestBaseReference()
+    {
+      tnt::Tntnet app;
+      tnt::HttpRequest request(app);
+      std::istringstream in(
+        "POST /page?a=17 HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "Content-Type: application/x-www-form-urlencoded\r\n"
+        "Content-Length: 7\r\n"
+        "\r\n"
+        "b=4&c=5");
+      request.parse(in);
+
+      // done by the worker before calling a component
+      request.parseQueryParams();
+
+      const cxxtools::QueryParams& qparam = request.getQueryParams();
+      CXXTOOLS_UNIT_ASSERT_EQUALS(qparam.paramcount(), 3);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(qparam.param("a"), "17");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(qparam.param("c"), "5");
+
+      const cxxtools::QueryParams& getparam = request.getGetParams();
+      CXXTOOLS_UNIT_ASSERT_EQUALS(getparam.paramcount(), 1);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(getparam.param("a"), "17");
+
+      const cxxtools::QueryParams& postparam = request.getPostParams();
+      CXXTOOLS_UNIT_ASSERT_EQUALS(postparam.paramcount(), 2);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(postparam.param("b"), "4");
+    }
 };
 
 cxxtools::unit::RegisterTest<QParamTest> register_QParamTest;
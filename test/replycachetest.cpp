@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cxxtools/unit/testsuite.h>
+#include <cxxtools/unit/registertest.h>
+#include <tnt/replycache.h>
+#include <tnt/httprequest.h>
+#include <tnt/httpreply.h>
+#include <tnt/httpheader.h>
+#include <tnt/encoding.h>
+#include <tnt/tntnet.h>
+#include <tnt/http.h>
+#include <sstream>
+#include <unistd.h>
+
+class ReplyCacheTest : public cxxtools::unit::TestSuite
+{
+    tnt::Tntnet _app;
+
+    void parse(tnt::HttpRequest& request, const std::string& msg)
+    {
+      std::istringstream in(msg);
+      request.parse(in);
+    }
+
+    std::string key(tnt::ReplyCache& cache, const std::string& msg)
+    {
+      tnt::HttpRequest request(_app);
+      parse(request, msg);
+      return cache.makeKey(request);
+    }
+
+    // Looks up the request and stores a reply with the body, when the
+    // lookup renews it; returns the body sent to the client.
+    std::string get(tnt::ReplyCache& cache, const std::string& body,
+      const char* cacheControl = 0)
+    {
+      tnt::HttpRequest request(_app);
+      parse(request, "GET /page HTTP/1.1\r\nHost: example.com\r\n\r\n");
+
+      tnt::ReplyCache::Lookup lookup(&cache, request);
+
+      std::ostringstream out;
+      tnt::HttpReply reply(out);
+      if (lookup.found())
+        lookup.fill(request, reply);
+      else
+      {
+        if (cacheControl)
+          reply.setHeader(tnt::httpheader::cacheControl, cacheControl);
+        reply.out() << body;
+        lookup.store(reply, HTTP_OK);
+      }
+
+      return reply.getContent();
+    }
+
+  public:
+    ReplyCacheTest()
+      : cxxtools::unit::TestSuite("replycache")
+    {
+      registerMethod("key", *this, &ReplyCacheTest::testKey);
+      registerMethod("keyQueryString", *this, &ReplyCacheTest::testKeyQueryString);
+      registerMethod("notShareable", *this, &ReplyCacheTest::testNotShareable);
+      registerMethod("hit", *this, &ReplyCacheTest::testHit);
+      registerMethod("expiry", *this, &ReplyCacheTest::testExpiry);
+      registerMethod("serveStale", *this, &ReplyCacheTest::testServeStale);
+      registerMethod("bypassUncacheable", *this, &ReplyCacheTest::testBypassUncacheable);
+      registerMethod("variants", *this, &ReplyCacheTest::testVariants);
+    }
+
+    void testKey()
+    {
+      tnt::TntConfig::Cache config;
+      config.maxAge = cxxtools::Seconds(10);
+      config.params.push_back("a");
+      config.headers.push_back("Accept-Language");
+      config.cookies.push_back("lang");
+      tnt::ReplyCache cache(config);
+
+      std::string k = key(cache, "GET /page?a=1&b=2 HTTP/1.1\r\nHost: example.com\r\n"
+        "Accept-Language: de\r\nCookie: lang=x\r\n\r\n");
+
+      // other parameters do not select a different reply
+      CXXTOOLS_UNIT_ASSERT_EQUALS(k, key(cache, "GET /page?b=3&a=1 HTTP/1.1\r\nHost: example.com\r\n"
+        "Accept-Language: de\r\nCookie: lang=x\r\n\r\n"));
+
+      CXXTOOLS_UNIT_ASSERT(k != key(cache, "GET /page?a=2&b=2 HTTP/1.1\r\nHost: example.com\r\n"
+        "Accept-Language: de\r\nCookie: lang=x\r\n\r\n"));
+      CXXTOOLS_UNIT_ASSERT(k != key(cache, "GET /page?a=1&b=2 HTTP/1.1\r\nHost: example.com\r\n"
+        "Accept-Language: en\r\nCookie: lang=x\r\n\r\n"));
+      CXXTOOLS_UNIT_ASSERT(k != key(cache, "GET /page?a=1&b=2 HTTP/1.1\r\nHost: example.com\r\n"
+        "Accept-Language: de\r\nCookie: lang=y\r\n\r\n"));
+      CXXTOOLS_UNIT_ASSERT(k != key(cache, "GET /other?a=1&b=2 HTTP/1.1\r\nHost: example.com\r\n"
+        "Accept-Language: de\r\nCookie: lang=x\r\n\r\n"));
+      CXXTOOLS_UNIT_ASSERT(k != key(cache, "GET /page?a=1&b=2 HTTP/1.1\r\nHost: example.org\r\n"
+        "Accept-Language: de\r\nCookie: lang=x\r\n\r\n"));
+
+      // a missing parameter differs from an empty one
+      CXXTOOLS_UNIT_ASSERT(key(cache, "GET /page HTTP/1.1\r\nHost: example.com\r\n\r\n")
+        != key(cache, "GET /page?a= HTTP/1.1\r\nHost: example.com\r\n\r\n"));
+    }
+
+    void testKeyQueryString()
+    {
+      tnt::TntConfig::Cache config;
+      config.maxAge = cxxtools::Seconds(10);
+      tnt::ReplyCache cache(config);
+
+      // without configured parameters the whole query string is used
+      CXXTOOLS_UNIT_ASSERT(key(cache, "GET /page?a=1&b=2 HTTP/1.1\r\nHost: example.com\r\n\r\n")
+        != key(cache, "GET /page?a=1&b=3 HTTP/1.1\r\nHost: example.com\r\n\r\n"));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(key(cache, "GET /page?a=1 HTTP/1.1\r\nHost: example.com\r\n\r\n"),
+        key(cache, "GET /page?a=1 HTTP/1.1\r\nHost: example.com\r\nAccept-Language: de\r\n\r\n"));
+    }
+
+    void testNotShareable()
+    {
+      std::ostringstream out;
+
+      {
+        tnt::HttpReply reply(out);
+        reply.out() << "body";
+        CXXTOOLS_UNIT_ASSERT(tnt::StoredReply::isShareable(reply, HTTP_OK));
+        CXXTOOLS_UNIT_ASSERT(!tnt::StoredReply::isShareable(reply, HTTP_NOT_FOUND));
+      }
+
+      {
+        tnt::HttpReply reply(out);
+        reply.setHeader(tnt::httpheader::cacheControl, "max-age=60, Private");
+        CXXTOOLS_UNIT_ASSERT(!tnt::StoredReply::isShareable(reply, HTTP_OK));
+        CXXTOOLS_UNIT_ASSERT(tnt::StoredReply::create(reply, HTTP_OK) == 0);
+      }
+
+      {
+        tnt::HttpReply reply(out);
+        reply.setHeader(tnt::httpheader::cacheControl, "no-store");
+        CXXTOOLS_UNIT_ASSERT(!tnt::StoredReply::isShareable(reply, HTTP_OK));
+      }
+
+      {
+        tnt::HttpReply reply(out);
+        reply.setHeader(tnt::httpheader::cacheControl, "public, max-age=60");
+        CXXTOOLS_UNIT_ASSERT(tnt::StoredReply::isShareable(reply, HTTP_OK));
+      }
+
+      {
+        tnt::HttpReply reply(out);
+        reply.setCookie("session", "42", 60);
+        CXXTOOLS_UNIT_ASSERT(!tnt::StoredReply::isShareable(reply, HTTP_OK));
+      }
+
+      {
+        tnt::HttpReply reply(out);
+        reply.setHeader(tnt::httpheader::contentEncoding, "gzip");
+        CXXTOOLS_UNIT_ASSERT(!tnt::StoredReply::isShareable(reply, HTTP_OK));
+      }
+    }
+
+    void testHit()
+    {
+      tnt::TntConfig::Cache config;
+      config.maxAge = cxxtools::Seconds(10);
+      tnt::ReplyCache cache(config);
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(get(cache, "one"), "one");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(get(cache, "two"), "one");
+    }
+
+    void testExpiry()
+    {
+      tnt::TntConfig::Cache config;
+      config.maxAge = cxxtools::Milliseconds(50);
+      tnt::ReplyCache cache(config);
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(get(cache, "one"), "one");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(get(cache, "two"), "one");
+
+      ::usleep(100000);
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(get(cache, "three"), "three");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(get(cache, "four"), "three");
+    }
+
+    void testServeStale()
+    {
+      tnt::TntConfig::Cache config;
+      config.maxAge = cxxtools::Milliseconds(50);
+      tnt::ReplyCache cache(config);
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(get(cache, "one"), "one");
+
+      ::usleep(100000);
+
+      tnt::HttpRequest request(_app);
+      parse(request, "GET /page HTTP/1.1\r\nHost: example.com\r\n\r\n");
+
+      {
+        // this lookup renews the reply
+        tnt::ReplyCache::Lookup renewing(&cache, request);
+        CXXTOOLS_UNIT_ASSERT(!renewing.found());
+
+        // others get the expired one meanwhile
+        CXXTOOLS_UNIT_ASSERT_EQUALS(get(cache, "two"), "one");
+
+        std::ostringstream out;
+        tnt::HttpReply reply(out);
+        reply.out() << "three";
+        renewing.store(reply, HTTP_OK);
+      }
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(get(cache, "four"), "three");
+    }
+
+    void testBypassUncacheable()
+    {
+      tnt::TntConfig::Cache config;
+      config.maxAge = cxxtools::Seconds(10);
+      tnt::ReplyCache cache(config);
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(get(cache, "one", "private"), "one");
+
+      tnt::HttpRequest request(_app);
+      parse(request, "GET /page HTTP/1.1\r\nHost: example.com\r\n\r\n");
+
+      // Without the marker the second lookup would wait for the first
+      // one; it gets no reply and calls the component instead.
+      tnt::ReplyCache::Lookup first(&cache, request);
+      CXXTOOLS_UNIT_ASSERT(!first.found());
+      CXXTOOLS_UNIT_ASSERT_EQUALS(get(cache, "two"), "two");
+
+      // a shareable reply is not stored, while the cache is bypassed
+      std::ostringstream out;
+      tnt::HttpReply reply(out);
+      reply.out() << "three";
+      first.store(reply, HTTP_OK);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(get(cache, "four"), "four");
+    }
+
+    void testVariants()
+    {
+      tnt::TntConfig::Cache config;
+      config.maxAge = cxxtools::Seconds(10);
+      tnt::ReplyCache cache(config);
+
+      std::string body(4096, 'a');
+
+      tnt::HttpRequest request(_app);
+      parse(request, "GET /page HTTP/1.1\r\nHost: example.com\r\nAccept-Encoding: gzip\r\n\r\n");
+
+      std::ostringstream out;
+      {
+        tnt::ReplyCache::Lookup lookup(&cache, request);
+        CXXTOOLS_UNIT_ASSERT(!lookup.found());
+
+        tnt::HttpReply reply(out);
+        reply.setAcceptEncoding(request.getEncoding());
+        reply.out() << body;
+        lookup.store(reply, HTTP_OK);
+        reply.sendReply(HTTP_OK);
+        lookup.storeVariant(reply);
+      }
+
+      {
+        tnt::ReplyCache::Lookup lookup(&cache, request);
+        CXXTOOLS_UNIT_ASSERT(lookup.found());
+
+        tnt::HttpReply reply(out);
+        lookup.fill(request, reply);
+        CXXTOOLS_UNIT_ASSERT_EQUALS(reply.getHeader(tnt::httpheader::contentEncoding, ""), std::string("gzip"));
+        CXXTOOLS_UNIT_ASSERT(reply.getContent().size() < body.size());
+      }
+
+      // clients, which do not accept gzip, get the plain body
+      tnt::HttpRequest plainRequest(_app);
+      parse(plainRequest, "GET /page HTTP/1.1\r\nHost: example.com\r\nAccept-Encoding: gzip;q=0\r\n\r\n");
+
+      {
+        tnt::ReplyCache::Lookup lookup(&cache, plainRequest);
+        CXXTOOLS_UNIT_ASSERT(lookup.found());
+
+        tnt::HttpReply reply(out);
+        lookup.fill(plainRequest, reply);
+        CXXTOOLS_UNIT_ASSERT(!reply.hasHeader(tnt::httpheader::contentEncoding));
+        CXXTOOLS_UNIT_ASSERT_EQUALS(reply.getContent(), body);
+      }
+    }
+};
+
+cxxtools::unit::RegisterTest<ReplyCacheTest> register_ReplyCacheTest;
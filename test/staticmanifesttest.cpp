@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2026 Tommi Maekitalo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * As a special exception, you may use this file as part of a free
+ * software library without restriction. Specifically, if other files
+ * instantiate templates or use macros or inline functions from this
+ * file, or you compile this file and link it with other files to
+ * produce an executable, this file does not by itself cause the
+ * resulting executable to be covered by the GNU General Public
+ * License. This exception does not however invalidate any other
+ * reasons why the executable file might be covered by the GNU Library
+ * General Public License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <cxxtools/unit/testsuite.h>
+#include <cxxtools/unit/registertest.h>
+#include <tnt/staticmanifest.h>
+#include <sstream>
+#include <stdexcept>
+
+class StaticManifestTest : public cxxtools::unit::TestSuite
+{
+  public:
+    StaticManifestTest()
+      : cxxtools::unit::TestSuite("staticmanifest")
+    {
+      registerMethod("read", *this, &StaticManifestTest::testRead);
+      registerMethod("writeRead", *this, &StaticManifestTest::testWriteRead);
+      registerMethod("syntaxError", *this, &StaticManifestTest::testSyntaxError);
+      registerMethod("suffix", *this, &StaticManifestTest::testSuffix);
+    }
+
+    void testRead()
+    {
+      std::istringstream in(
+        "# comment\n"
+        "\n"
+        "css/site.css\t10240\t1760000000\t00000000deadbeef\tbr:2100:1\tgzip:2500:ABCDEF\n"
+        "robots.txt\t24\t-5\t0123456789abcdef\r\n");
+
+      tnt::StaticManifest manifest;
+      manifest.read(in);
+
+      CXXTOOLS_UNIT_ASSERT_EQUALS(manifest.entries().size(), 2);
+
+      const tnt::StaticManifest::Entry* entry = manifest.find("css/site.css");
+      CXXTOOLS_UNIT_ASSERT(entry != 0);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(entry->size, 10240);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(entry->mtime, 1760000000);
+      CXXTOOLS_UNIT_ASSERT(entry->hash == 0xdeadbeefULL);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(entry->variants.size(), 2);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(entry->variants[0].encoding, "br");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(entry->variants[0].size, 2100);
+      CXXTOOLS_UNIT_ASSERT(entry->variants[0].hash == 1);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(entry->variants[1].encoding, "gzip");
+      CXXTOOLS_UNIT_ASSERT(entry->variants[1].hash == 0xabcdefULL);
+
+      entry = manifest.find("robots.txt");
+      CXXTOOLS_UNIT_ASSERT(entry != 0);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(entry->mtime, -5);
+      CXXTOOLS_UNIT_ASSERT(entry->hash == 0x0123456789abcdefULL);
+      CXXTOOLS_UNIT_ASSERT(entry->variants.empty());
+
+      CXXTOOLS_UNIT_ASSERT(manifest.find("missing.txt") == 0);
+    }
+
+    void testWriteRead()
+    {
+      tnt::StaticManifest manifest;
+      tnt::StaticManifest::Entry& entry = manifest.add("a b/index.html");
+      entry.size = 123456789012ULL;
+      entry.mtime = 1760000000;
+      entry.hash = 0xfedcba9876543210ULL;
+      entry.variants.resize(1);
+      entry.variants[0].encoding = "zstd";
+      entry.variants[0].size = 4711;
+      entry.variants[0].hash = 0x42;
+
+      std::ostringstream out;
+      manifest.write(out);
+
+      std::istringstream in(out.str());
+      tnt::StaticManifest result;
+      result.read(in);
+
+      const tnt::StaticManifest::Entry* e = result.find("a b/index.html");
+      CXXTOOLS_UNIT_ASSERT(e != 0);
+      CXXTOOLS_UNIT_ASSERT(e->size == 123456789012ULL);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e->mtime, 1760000000);
+      CXXTOOLS_UNIT_ASSERT(e->hash == 0xfedcba9876543210ULL);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e->variants.size(), 1);
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e->variants[0].encoding, "zstd");
+      CXXTOOLS_UNIT_ASSERT_EQUALS(e->variants[0].size, 4711);
+      CXXTOOLS_UNIT_ASSERT(e->variants[0].hash == 0x42);
+    }
+
+    static void read(const char* s)
+    {
+      std::istringstream in(s);
+      tnt::StaticManifest manifest;
+      manifest.read(in);
+    }
+
+    void testSyntaxError()
+    {
+      CXXTOOLS_UNIT_ASSERT_THROW(read("a.css\t10\t0\n"), std::runtime_error);
+      CXXTOOLS_UNIT_ASSERT_THROW(read("a.css\tx\t0\t1\n"), std::runtime_error);
+      CXXTOOLS_UNIT_ASSERT_THROW(read("a.css\t10\t0\tghi\n"), std::runtime_error);
+      CXXTOOLS_UNIT_ASSERT_THROW(read("a.css\t10\t0\t1\tgzip:5\n"), std::runtime_error);
+      CXXTOOLS_UNIT_ASSERT_THROW(read("a.css\t10\t0\t1\t:5:1\n"), std::runtime_error);
+      CXXTOOLS_UNIT_ASSERT_THROW(read("a.css\t99999999999999999999\t0\t1\n"), std::runtime_error);
+      CXXTOOLS_UNIT_ASSERT_THROW(read("\t10\t0\t1\n"), std::runtime_error);
+    }
+
+    void testSuffix()
+    {
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::StaticManifest::suffix("gzip"), std::string(".gz"));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::StaticManifest::suffix("br"), std::string(".br"));
+      CXXTOOLS_UNIT_ASSERT_EQUALS(tnt::StaticManifest::suffix("zstd"), std::string(".zst"));
+      CXXTOOLS_UNIT_ASSERT(tnt::StaticManifest::suffix("compress") == 0);
+    }
+};
+
+cxxtools::unit::RegisterTest<StaticManifestTest> register_StaticManifestTest;